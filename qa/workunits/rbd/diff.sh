@@ -8,6 +8,8 @@ function cleanup() {
     rbd rm foo.copy || :
     rbd snap purge foo.copy2 || :
     rbd rm foo.copy2 || :
+    rbd snap purge foo.copy3 || :
+    rbd rm foo.copy3 || :
     rm -f foo.diff foo.out
 }
 
@@ -47,6 +49,25 @@ if [ "$orig" != "$copy" ]; then
     exit 1
 fi
 
+# parallel, compressed diffs
+rbd export-diff foo@three --from-snap two --compression zstd foo.diff && exit 1 || true  # needs diff format 3
+rbd create foo.copy3 --size 1000
+rbd export-diff --diff-format 3 --compression zstd foo@two - | rbd import-diff - foo.copy3
+rbd snap ls foo.copy3 | grep two
+rm -f foo.diff
+rbd export-diff --diff-format 3 foo@three --from-snap two foo.diff
+rbd import-diff foo.diff foo.copy3
+rbd snap ls foo.copy3 | grep three
+
+rm foo.out
+rbd export foo.copy3 foo.out
+copy=`md5sum foo.out | awk '{print $1}'`
+
+if [ "$orig" != "$copy" ]; then
+    echo does not match
+    exit 1
+fi
+
 cleanup
 
 echo OK
@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/AlignedBufferPool.h"
+
+#include <cstdlib>
+
+#include "common/deleter.h"
+#include "common/error_code.h"
+#include "include/intarith.h"
+#include "include/page.h"
+
+AlignedBufferPool::~AlignedBufferPool()
+{
+  for (auto& blocks : free_blocks) {
+    for (auto block : blocks) {
+      ::free(block);
+    }
+  }
+}
+
+ceph::buffer::ptr AlignedBufferPool::get(unsigned head, unsigned len)
+{
+  uint64_t pages = std::max<uint64_t>(
+    1, p2roundup<uint64_t>(uint64_t(head) + len, CEPH_PAGE_SIZE) /
+       CEPH_PAGE_SIZE);
+  unsigned order = pages > 1 ? cbits(pages - 1) : 0;
+  uint64_t size = uint64_t(CEPH_PAGE_SIZE) << order;
+  if (order > MAX_ORDER || size > max_block_size) {
+    ceph::buffer::ptr bp(ceph::buffer::create_aligned(head + len,
+						      CEPH_PAGE_SIZE));
+    bp.set_offset(head);
+    bp.set_length(len);
+    return bp;
+  }
+
+  char *block = nullptr;
+  {
+    std::lock_guard l{lock};
+    auto& blocks = free_blocks[order];
+    if (!blocks.empty()) {
+      block = blocks.back();
+      blocks.pop_back();
+      stats.cached_bytes -= size;
+      ++stats.hits;
+    } else {
+      ++stats.misses;
+    }
+  }
+  if (!block) {
+    void *p = nullptr;
+    if (::posix_memalign(&p, CEPH_PAGE_SIZE, size) != 0) {
+      throw ceph::buffer::bad_alloc();
+    }
+    block = static_cast<char*>(p);
+  }
+
+  ceph::buffer::ptr bp(ceph::buffer::claim_buffer(
+    size, block,
+    make_deleter([pool = shared_from_this(), block, order] {
+      pool->put(block, order);
+    })));
+  bp.set_offset(head);
+  bp.set_length(len);
+  return bp;
+}
+
+void AlignedBufferPool::put(char *block, unsigned order)
+{
+  uint64_t size = uint64_t(CEPH_PAGE_SIZE) << order;
+  std::lock_guard l{lock};
+  if (size > max_bytes ||
+      (stats.cached_bytes + size > max_bytes &&
+       !trim(max_bytes - size, order))) {
+    ::free(block);
+    return;
+  }
+  free_blocks[order].push_back(block);
+  stats.cached_bytes += size;
+}
+
+bool AlignedBufferPool::trim(uint64_t target, unsigned keep_order)
+{
+  while (stats.cached_bytes > target) {
+    // release from the size class holding the most memory
+    unsigned victim = 0;
+    uint64_t victim_bytes = 0;
+    for (unsigned order = 0; order <= MAX_ORDER; ++order) {
+      uint64_t bytes = free_blocks[order].size() *
+	(uint64_t(CEPH_PAGE_SIZE) << order);
+      if (bytes > victim_bytes) {
+	victim = order;
+	victim_bytes = bytes;
+      }
+    }
+    if (victim == keep_order) {
+      return false;
+    }
+    ::free(free_blocks[victim].back());
+    free_blocks[victim].pop_back();
+    stats.cached_bytes -= uint64_t(CEPH_PAGE_SIZE) << victim;
+  }
+  return true;
+}
+
+void AlignedBufferPool::set_max_bytes(uint64_t bytes)
+{
+  std::lock_guard l{lock};
+  max_bytes = bytes;
+  trim(max_bytes);
+}
+
+AlignedBufferPool::Stats AlignedBufferPool::get_stats() const
+{
+  std::lock_guard l{lock};
+  return stats;
+}
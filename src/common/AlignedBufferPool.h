@@ -0,0 +1,78 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_ALIGNEDBUFFERPOOL_H
+#define CEPH_COMMON_ALIGNEDBUFFERPOOL_H
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+
+/*
+ * A pool of page-aligned memory blocks for buffers that are filled and
+ * released at a high rate, such as the payloads of messages received off
+ * the network.  Blocks are a power of two pages long; freed blocks of up
+ * to max_block_size bytes are kept for reuse as long as the pool holds
+ * less than max_bytes.  When it is full, blocks of the size class that
+ * holds the most memory are released to make room for a block of another
+ * size, so the pool follows changes in the request sizes.
+ *
+ * Buffers handed out keep the pool alive, so they may outlive its owner.
+ */
+class AlignedBufferPool
+  : public std::enable_shared_from_this<AlignedBufferPool> {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t cached_bytes = 0;
+  };
+
+  static std::shared_ptr<AlignedBufferPool> create(uint64_t max_bytes,
+						   uint64_t max_block_size) {
+    return std::shared_ptr<AlignedBufferPool>(
+      new AlignedBufferPool(max_bytes, max_block_size));
+  }
+  ~AlignedBufferPool();
+
+  /**
+   * Get a buffer of @a len bytes starting @a head bytes into a page
+   * aligned block.
+   */
+  ceph::buffer::ptr get(unsigned head, unsigned len);
+
+  void set_max_bytes(uint64_t bytes);
+  Stats get_stats() const;
+
+private:
+  static constexpr unsigned MAX_ORDER = 20;
+
+  mutable ceph::mutex lock = ceph::make_mutex("AlignedBufferPool::lock");
+  uint64_t max_bytes;
+  const uint64_t max_block_size;
+  // free blocks by order, a block of order n being 2^n pages long
+  std::array<std::vector<char*>, MAX_ORDER + 1> free_blocks;
+  Stats stats;
+
+  AlignedBufferPool(uint64_t max_bytes, uint64_t max_block_size)
+    : max_bytes(max_bytes), max_block_size(max_block_size) {}
+
+  void put(char *block, unsigned order);
+  // release free blocks until at most target bytes are cached; gives up
+  // if keep_order is the size class holding the most memory
+  bool trim(uint64_t target, unsigned keep_order = MAX_ORDER + 1);
+};
+
+#endif
@@ -21,6 +21,7 @@
 
 #include <fmt/format.h>
 #include <algorithm>
+#include <charconv>
 #include <set>
 #include <limits>
 #include <utility>
@@ -125,6 +126,23 @@ Formatter *Formatter::create(std::string_view type,
 }
 
 
+Formatter *Formatter::create_chunked(std::string_view type,
+				     std::string_view default_type,
+				     std::string_view fallback)
+{
+  std::string_view mytype(type);
+  if (mytype.empty()) {
+    mytype = default_type;
+  }
+
+  if (mytype == "json")
+    return new JSONFormatterChunked(false);
+  else if (mytype == "json-pretty")
+    return new JSONFormatterChunked(true);
+  else
+    return create(type, default_type, fallback);
+}
+
 void Formatter::flush(bufferlist &bl)
 {
   CachedStackStringStream css;
@@ -169,6 +187,18 @@ void JSONFormatter::flush(std::ostream& os)
   m_ss.str("");
 }
 
+void JSONFormatter::flush(bufferlist& bl)
+{
+  finish_pending_string();
+  // take the string out of the stream instead of copying it twice
+  // through Formatter::flush(bufferlist&)
+  bl.append(std::move(m_ss).str());
+  if (m_line_break_enabled)
+    bl.append('\n');
+  m_ss.clear();
+  m_ss.str("");
+}
+
 void JSONFormatter::reset()
 {
   m_stack.clear();
@@ -299,23 +329,30 @@ void JSONFormatter::finish_pending_string()
 }
 
 void JSONFormatter::add_value(std::string_view name, double val) {
-  CachedStackStringStream css;
   if (!std::isfinite(val) || std::isnan(val)) {
-    *css << "null";
-  } else {
-    css->precision(std::numeric_limits<double>::max_digits10);
-    *css << val;
+    add_value(name, "null", false);
+    return;
   }
-  add_value(name, css->strv(), false);
+  // same as an ostream with precision max_digits10, minus the stream
+  char buf[32];
+  int len = snprintf(buf, sizeof(buf), "%.*g",
+		     std::numeric_limits<double>::max_digits10, val);
+  add_value(name, std::string_view(buf, len), false);
 }
 
 template <class T>
 void JSONFormatter::add_value(std::string_view name, T val)
 {
-  CachedStackStringStream css;
-  css->precision(std::numeric_limits<T>::max_digits10);
-  *css << val;
-  add_value(name, css->strv(), false);
+  if constexpr (std::is_integral_v<T>) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), val);
+    add_value(name, std::string_view(buf, end - buf), false);
+  } else {
+    CachedStackStringStream css;
+    css->precision(std::numeric_limits<T>::max_digits10);
+    *css << val;
+    add_value(name, css->strv(), false);
+  }
 }
 
 void JSONFormatter::add_value(std::string_view name, std::string_view val, bool quoted)
@@ -394,6 +431,120 @@ void JSONFormatter::write_raw_data(const char *data)
   get_ss() << data;
 }
 
+class JSONFormatterChunked::chunk_streambuf : public std::streambuf {
+public:
+  chunk_streambuf(sink_t sink, size_t chunk_size)
+    : m_sink(std::move(sink)), m_chunk_size(chunk_size) {}
+
+  /// bytes written since the last take(), including sunk ones
+  size_t length() const {
+    return m_length + (pptr() - pbase());
+  }
+
+  /// move everything that hasn't been sunk yet to the end of @bl
+  void take(bufferlist& bl) {
+    seal();
+    bl.claim_append(m_bl);
+    m_length = 0;
+  }
+
+  void sink_all() {
+    seal();
+    if (m_sink && m_bl.length()) {
+      m_sink(std::move(m_bl));
+      m_bl.clear();
+    }
+  }
+
+  void clear() {
+    setp(nullptr, nullptr);
+    m_cur = ceph::buffer::ptr();
+    m_bl.clear();
+    m_length = 0;
+  }
+
+protected:
+  int_type overflow(int_type c) override {
+    seal();
+    if (m_sink && m_bl.length() >= m_chunk_size) {
+      m_sink(std::move(m_bl));
+      m_bl.clear();
+    }
+    m_cur = ceph::buffer::create(m_chunk_size);
+    setp(m_cur.c_str(), m_cur.c_str() + m_cur.length());
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+private:
+  /// append the filled part of the current chunk to m_bl
+  void seal() {
+    if (!pbase()) {
+      return;
+    }
+    size_t len = pptr() - pbase();
+    m_length += len;
+    if (len) {
+      m_cur.set_length(len);
+      m_bl.append(std::move(m_cur));
+    }
+    m_cur = ceph::buffer::ptr();
+    setp(nullptr, nullptr);
+  }
+
+  sink_t m_sink;
+  const size_t m_chunk_size;
+  ceph::buffer::ptr m_cur; ///< chunk being written
+  bufferlist m_bl;         ///< filled chunks
+  size_t m_length = 0;     ///< bytes sealed into m_bl or sunk
+};
+
+JSONFormatterChunked::JSONFormatterChunked(bool pretty, sink_t sink,
+					   size_t chunk_size)
+  : JSONFormatter(pretty),
+    m_buf(std::make_unique<chunk_streambuf>(std::move(sink), chunk_size)),
+    m_os(m_buf.get())
+{
+}
+
+JSONFormatterChunked::~JSONFormatterChunked() = default;
+
+void JSONFormatterChunked::flush(std::ostream& os)
+{
+  bufferlist bl;
+  flush(bl);
+  bl.write_stream(os);
+}
+
+void JSONFormatterChunked::flush(bufferlist& bl)
+{
+  finish_pending_string();
+  if (m_line_break) {
+    m_os << '\n';
+  }
+  m_buf->take(bl);
+}
+
+void JSONFormatterChunked::flush_to_sink()
+{
+  finish_pending_string();
+  m_buf->sink_all();
+}
+
+void JSONFormatterChunked::reset()
+{
+  JSONFormatter::reset();
+  m_buf->clear();
+}
+
+int JSONFormatterChunked::get_len() const
+{
+  return m_buf->length();
+}
+
 const char *XMLFormatter::XML_1_DTD =
   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
 
@@ -187,13 +187,22 @@ namespace ceph {
       return std::unique_ptr<Formatter>(
 	  Formatter::create(std::forward<Params>(params)...));
     }
+    /// like create(), but json output is rendered straight into
+    /// bufferlist chunks (see JSONFormatterChunked); for potentially
+    /// large dumps that end up in a bufferlist
+    static Formatter *create_chunked(std::string_view type,
+				     std::string_view default_type,
+				     std::string_view fallback);
+    static Formatter *create_chunked(std::string_view type) {
+      return create_chunked(type, "json-pretty", "");
+    }
 
     Formatter() = default;
     virtual ~Formatter() = default;
 
     virtual void enable_line_break() = 0;
     virtual void flush(std::ostream& os) = 0;
-    void flush(bufferlist &bl);
+    virtual void flush(bufferlist &bl);
     virtual void reset() = 0;
 
     virtual void set_status(int status, const char* status_name) = 0;
@@ -299,7 +308,7 @@ namespace ceph {
     void output_footer() override {};
     void enable_line_break() override { m_line_break_enabled = true; }
     void flush(std::ostream& os) override;
-    using Formatter::flush; // don't hide Formatter::flush(bufferlist &bl)
+    void flush(bufferlist& bl) override;
     void reset() override;
     void open_array_section(std::string_view name) override;
     void open_array_section_in_ns(std::string_view name, const char *ns) override;
@@ -377,6 +386,9 @@ public:
     void flush(std::ostream& os) override {
       flush();
     }
+    void flush(bufferlist& bl) override {
+      flush();
+    }
     void flush() {
       JSONFormatter::finish_pending_string();
       file.flush();
@@ -403,6 +415,48 @@ private:
     mutable std::ofstream file; // mutable for get_len
   };
 
+  /**
+   * JSONFormatter that renders into a bufferlist, chunk_size bytes at a
+   * time, instead of a stringstream: flush(bufferlist&) hands over the
+   * chunks without copying the document.  Given a sink, every filled
+   * chunk is passed to it right away, bounding memory use by chunk_size
+   * regardless of the size of the output; flush() then only returns
+   * what has not been sunk yet.
+   */
+  class JSONFormatterChunked : public JSONFormatter {
+  public:
+    using sink_t = std::function<void(bufferlist&&)>;
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 << 10;
+
+    explicit JSONFormatterChunked(bool pretty = false,
+				  sink_t sink = {},
+				  size_t chunk_size = DEFAULT_CHUNK_SIZE);
+    ~JSONFormatterChunked() override;
+
+    void enable_line_break() override {
+      JSONFormatter::enable_line_break();
+      m_line_break = true;
+    }
+    void flush(std::ostream& os) override;
+    void flush(bufferlist& bl) override;
+    /// pass whatever is buffered to the sink
+    void flush_to_sink();
+    void reset() override;
+    int get_len() const override;
+
+  protected:
+    std::ostream& get_ss() override {
+      return m_os;
+    }
+
+  private:
+    class chunk_streambuf;
+
+    std::unique_ptr<chunk_streambuf> m_buf;
+    std::ostream m_os;
+    bool m_line_break = false;
+  };
+
   template <class T>
   void add_value(std::string_view name, T val);
 
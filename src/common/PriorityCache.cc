@@ -12,6 +12,9 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "PriorityCache.h"
 #include "common/dout.h"
 #include "perfglue/heap_profiler.h"
@@ -257,6 +260,7 @@ namespace PriorityCache
     }
     indexes.erase(name);
     caches.erase(name);
+    utilities.erase(name);
   }
 
   void Manager::clear()
@@ -271,8 +275,123 @@ namespace PriorityCache
     caches.clear();
   }
 
+  double Manager::get_effective_ratio(const std::string& name) const
+  {
+    auto it = caches.find(name);
+    ceph_assert(it != caches.end());
+    return get_ratio(name, *it->second);
+  }
+
+  double Manager::get_ratio(const std::string& name, const PriCache& c) const
+  {
+    auto it = utilities.find(name);
+    if (it == utilities.end() || it->second.share < 0) {
+      return c.get_cache_ratio();
+    }
+    return it->second.share * utility_ratio;
+  }
+
+  void Manager::update_utilities()
+  {
+    // Weight of the previous estimate when smoothing marginal utilities.
+    constexpr double UTILITY_DECAY = 0.5;
+    // Never shrink a cache below this share of the utility caches' ratio.
+    constexpr double MIN_SHARE = 0.05;
+
+    utility_ratio = 0;
+    if (utility_step <= 0) {
+      utilities.clear();
+      return;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> reporting;
+    for (auto &c : caches) {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      if (c.second->get_hit_stats(&hits, &misses)) {
+        reporting.emplace_back(c.first, hits);
+        utility_ratio += c.second->get_cache_ratio();
+      } else {
+        utilities.erase(c.first);
+      }
+    }
+    if (reporting.size() < 2 || utility_ratio <= 0) {
+      utilities.clear();
+      utility_ratio = 0;
+      return;
+    }
+
+    // The marginal utility of a cache is estimated from how its hits changed
+    // along with its size between the last two intervals.  Size changes
+    // below the chunk granularity are too small to tell anything.
+    int64_t min_delta = std::max<int64_t>(tuned_mem / 256, 1);
+    utility_t *best = nullptr;
+    utility_t *worst = nullptr;
+    uint64_t total_interval_hits = 0;
+    for (auto &[cache_name, hits] : reporting) {
+      auto &c = caches[cache_name];
+      auto &u = utilities[cache_name];
+      uint64_t interval_hits = hits >= u.hits ? hits - u.hits : 0;
+      int64_t bytes = c->get_cache_bytes();
+
+      if (u.share < 0) {
+        u.share = c->get_cache_ratio() / utility_ratio;
+      } else if (u.samples >= 2 && std::abs(bytes - u.bytes) >= min_delta) {
+        double utility = (static_cast<double>(interval_hits) -
+                          static_cast<double>(u.interval_hits)) /
+                         (bytes - u.bytes);
+        u.utility = UTILITY_DECAY * u.utility +
+                    (1 - UTILITY_DECAY) * std::max(utility, 0.0);
+      } else if (u.samples < 2 && bytes > 0) {
+        // Until there is a size change to compare against, start from the
+        // average hits per byte.
+        u.utility = static_cast<double>(interval_hits) / bytes;
+      }
+      if (u.samples < 2) {
+        ++u.samples;
+      }
+      u.hits = hits;
+      u.interval_hits = interval_hits;
+      u.bytes = bytes;
+      total_interval_hits += interval_hits;
+
+      ldout(cct, 10) << __func__ << " " << cache_name
+                     << " interval hits: " << interval_hits
+                     << " bytes: " << bytes
+                     << " utility: " << u.utility
+                     << " share: " << u.share << dendl;
+
+      if (!best || u.utility > best->utility) {
+        best = &u;
+      }
+      if (u.share > MIN_SHARE && (!worst || u.utility < worst->utility)) {
+        worst = &u;
+      }
+    }
+
+    // Shift memory from the cache that gains the least from it to the one
+    // that gains the most.  Moving on every balance also keeps producing
+    // the size changes the estimates are based on, so without a clear
+    // winner probe by moving memory between the caches in turn.
+    if (total_interval_hits == 0) {
+      return;
+    }
+    if (best == worst) {
+      ++utility_probe;
+      best = &utilities[reporting[utility_probe % reporting.size()].first];
+      worst = &utilities[reporting[(utility_probe + 1) % reporting.size()].first];
+    }
+    if (best && worst && best != worst && worst->share > MIN_SHARE) {
+      double step = std::min(utility_step, worst->share - MIN_SHARE);
+      worst->share -= step;
+      best->share += step;
+    }
+  }
+
   void Manager::balance()
   {
+    update_utilities();
+
     int64_t mem_avail = tuned_mem;
     // Each cache is going to get a little extra from get_chunk, so shrink the
     // available memory here to compensate.
@@ -338,7 +457,7 @@ namespace PriorityCache
     // First, zero this priority's bytes, sum the initial ratios.
     for (auto it = caches.begin(); it != caches.end(); it++) {
       it->second->set_cache_bytes(pri, 0);
-      cur_ratios += it->second->get_cache_ratio();
+      cur_ratios += get_ratio(it->first, *it->second);
     }
 
     // For other priorities, loop until caches are satisified or we run out of
@@ -352,9 +471,10 @@ namespace PriorityCache
         // want memory.  There is a special case where the only caches left are
         // all assigned 0% ratios but still want memory.  In that case, give 
         // them an equal shot at the remaining memory for this priority.
+        double cache_ratio = get_ratio(it->first, *it->second);
         double ratio = 1.0 / tmp_caches.size();
         if (cur_ratios > 0) {
-          ratio = it->second->get_cache_ratio() / cur_ratios;
+          ratio = cache_ratio / cur_ratios;
         }
         int64_t fair_share = static_cast<int64_t>(*mem_avail * ratio);
 
@@ -362,7 +482,7 @@ namespace PriorityCache
                        << " pri: " << (int) pri
                        << " round: " << round
                        << " wanted: " << cache_wants
-                       << " ratio: " << it->second->get_cache_ratio()
+                       << " ratio: " << cache_ratio
                        << " cur_ratios: " << cur_ratios
                        << " fair_share: " << fair_share
                        << " mem_avail: " << *mem_avail
@@ -372,7 +492,7 @@ namespace PriorityCache
           // If we want too much, take what we can get but stick around for more
           it->second->add_cache_bytes(pri, fair_share);
           total_assigned += fair_share;
-          new_ratios += it->second->get_cache_ratio();
+          new_ratios += cache_ratio;
           ++it;
         } else {
           // Otherwise assign only what we want
@@ -397,7 +517,7 @@ namespace PriorityCache
     if (pri == Priority::LAST) {
       uint64_t total_assigned = 0;
       for (auto it = caches.begin(); it != caches.end(); it++) {
-        double ratio = it->second->get_cache_ratio();
+        double ratio = get_ratio(it->first, *it->second);
         int64_t fair_share = static_cast<int64_t>(*mem_avail * ratio);
         it->second->set_cache_bytes(Priority::LAST, fair_share);
         total_assigned += fair_share;
@@ -112,9 +112,27 @@ namespace PriorityCache {
 
     // Get bins
     virtual uint64_t get_bins(PriorityCache::Priority pri) const = 0;
+
+    /* Get the cumulative number of hits and misses of the cache, if it
+     * tracks them.  Caches reporting hits in comparable units (roughly one
+     * lookup) take part in utility based balancing.
+     */
+    virtual bool get_hit_stats(uint64_t *hits, uint64_t *misses) const {
+      return false;
+    }
   };
 
   class Manager {
+    // Marginal utility of a cache as observed across balance() calls.
+    struct utility_t {
+      uint64_t hits = 0;        ///< cumulative hits at the last balance
+      uint64_t interval_hits = 0; ///< hits during the last interval
+      int64_t bytes = 0;        ///< bytes assigned during the last interval
+      double utility = 0;       ///< smoothed hits gained per byte
+      double share = -1;        ///< share of the ratio of the utility caches
+      int samples = 0;          ///< intervals observed so far
+    };
+
     CephContext* cct = nullptr;
     PerfCounters* logger;
     std::unordered_map<std::string, PerfCounters*> loggers;
@@ -130,6 +148,13 @@ namespace PriorityCache {
     uint64_t tuned_mem = 0;
     bool reserve_extra;
     std::string name;
+
+    // Fraction of the utility caches' memory moved per balance() towards
+    // the cache with the highest marginal utility; 0 uses the ratios only.
+    double utility_step = 0;
+    double utility_ratio = 0;   ///< summed ratios of the utility caches
+    unsigned utility_probe = 0; ///< next caches to probe without a winner
+    std::unordered_map<std::string, utility_t> utilities;
   public:
     Manager(CephContext *c, uint64_t min, uint64_t max, uint64_t target,
             bool reserve_extra, const std::string& name = std::string());
@@ -143,9 +168,14 @@ namespace PriorityCache {
     void set_target_memory(uint64_t target) {
       target_mem = target;
     }
+    void set_utility_step(double step) {
+      utility_step = step;
+    }
     uint64_t get_tuned_mem() const {
       return tuned_mem;
     }
+    // Get the ratio a cache is currently balanced with.
+    double get_effective_ratio(const std::string& name) const;
     void insert(const std::string& name, const std::shared_ptr<PriCache> c,
                 bool enable_perf_counters);
     void erase(const std::string& name);
@@ -154,6 +184,8 @@ namespace PriorityCache {
     void balance();
     void shift_bins();
   private:
+    double get_ratio(const std::string& name, const PriCache& c) const;
+    void update_utilities();
     void balance_priority(int64_t *mem_avail, Priority pri);
   };
 }
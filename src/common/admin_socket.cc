@@ -559,7 +559,7 @@ void AdminSocket::execute_command(
     }
     f = jff;
   } else {
-    f = Formatter::create(format, "json-pretty", "json-pretty");
+    f = Formatter::create_chunked(format, "json-pretty", "json-pretty");
   }
 
   auto [retval, hook] = find_matched_hook(prefix, cmdmap);
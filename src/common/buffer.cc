@@ -85,6 +85,84 @@ static ceph::spinlock debug_lock;
     return buffer_missed_crc;
   }
 
+  /*
+   * small per-thread caches of freed ptr_nodes and of the
+   * CEPH_BUFFER_ALLOC_UNIT sized raw_combined allocations that back
+   * appends, so that building and tearing down small bufferlists (message
+   * encoding, onode encoding, ...) mostly stays off the allocator.
+   *
+   * the lists are trivially destructible so that they stay usable during
+   * thread teardown; the reaper returns their contents on thread exit.
+   *
+   * they are left out of ASan (WITH_ASAN) builds, which need to see every
+   * allocation and free to catch use-after-free bugs.
+   */
+#ifndef __has_feature
+#define __has_feature(x) 0
+#endif
+#if __has_feature(address_sanitizer) || defined(__SANITIZE_ADDRESS__)
+#define CEPH_BUFFER_FREE_LISTS 0
+#else
+#define CEPH_BUFFER_FREE_LISTS 1
+#endif
+
+#if CEPH_BUFFER_FREE_LISTS
+  namespace {
+  struct free_list {
+    void *head = nullptr;
+    unsigned count = 0;
+    bool closed = false;
+
+    void *pop() {
+      void *p = head;
+      if (p) {
+	head = *static_cast<void**>(p);
+	--count;
+      }
+      return p;
+    }
+    bool push(void *p, unsigned max);
+  };
+
+  constexpr unsigned MAX_CACHED_NODES = 512;
+  constexpr unsigned MAX_CACHED_BLOCKS = 8;
+
+  // e.g. for memory checkers that should see every free
+  bool buffer_no_cache = get_env_bool("CEPH_BUFFER_NO_CACHE");
+
+  thread_local free_list cached_nodes;
+  thread_local free_list cached_blocks;
+
+  struct free_list_reaper {
+    ~free_list_reaper() {
+      cached_nodes.closed = cached_blocks.closed = true;
+      while (void *p = cached_nodes.pop()) {
+	::operator delete(p);
+      }
+      while (void *p = cached_blocks.pop()) {
+	aligned_free(p);
+      }
+    }
+  };
+  thread_local free_list_reaper reaper;
+
+  bool free_list::push(void *p, unsigned max) {
+    if (closed || count >= max || buffer_no_cache) {
+      return false;
+    }
+    if (count == 0) {
+      // make sure the reaper is constructed, and thus destroyed, on this
+      // thread
+      [[maybe_unused]] auto *r = &reaper;
+    }
+    *static_cast<void**>(p) = head;
+    head = p;
+    ++count;
+    return true;
+  }
+  } // anonymous namespace
+#endif // CEPH_BUFFER_FREE_LISTS
+
   /*
    * raw_combined is always placed within a single allocation along
    * with the data buffer.  the data goes at the beginning, and
@@ -107,16 +185,24 @@ static ceph::spinlock debug_lock;
 				  alignof(buffer::raw_combined));
       size_t datalen = round_up_to(len, alignof(buffer::raw_combined));
 
+      char *ptr = nullptr;
+#if CEPH_BUFFER_FREE_LISTS
+      if (rawlen + datalen == CEPH_BUFFER_ALLOC_UNIT &&
+	  align <= sizeof(void *)) {
+	ptr = static_cast<char*>(cached_blocks.pop());
+      }
+#endif
+      if (!ptr) {
 #ifdef DARWIN
-      char *ptr = (char *) valloc(rawlen + datalen);
+	ptr = (char *) valloc(rawlen + datalen);
 #else
-      char *ptr = 0;
-      int r = ::posix_memalign((void**)(void*)&ptr, align, rawlen + datalen);
-      if (r)
-	throw bad_alloc();
+	int r = ::posix_memalign((void**)(void*)&ptr, align, rawlen + datalen);
+	if (r)
+	  throw bad_alloc();
 #endif /* DARWIN */
-      if (!ptr)
-	throw bad_alloc();
+	if (!ptr)
+	  throw bad_alloc();
+      }
 
       // actual data first, since it has presumably larger alignment restriction
       // then put the raw_combined at the end
@@ -126,6 +212,13 @@ static ceph::spinlock debug_lock;
 
     static void operator delete(void *ptr) {
       raw_combined *raw = (raw_combined *)ptr;
+#if CEPH_BUFFER_FREE_LISTS
+      if ((char *)ptr + sizeof(raw_combined) - raw->data ==
+	    CEPH_BUFFER_ALLOC_UNIT &&
+	  cached_blocks.push(raw->data, MAX_CACHED_BLOCKS)) {
+	return;
+      }
+#endif
       aligned_free((void *)raw->data);
     }
   };
@@ -2220,6 +2313,28 @@ buffer::ptr_node* buffer::ptr_node::cloner::operator()(
   return new ptr_node(clone_this);
 }
 
+void* buffer::ptr_node::operator new(const std::size_t size)
+{
+#if CEPH_BUFFER_FREE_LISTS
+  if (size == sizeof(ptr_node)) {
+    if (void *p = cached_nodes.pop()) {
+      return p;
+    }
+  }
+#endif
+  return ::operator new(size);
+}
+
+void buffer::ptr_node::operator delete(void* const p, const std::size_t size)
+{
+#if CEPH_BUFFER_FREE_LISTS
+  if (size == sizeof(ptr_node) && cached_nodes.push(p, MAX_CACHED_NODES)) {
+    return;
+  }
+#endif
+  ::operator delete(p);
+}
+
 std::ostream& buffer::operator<<(std::ostream& out, const buffer::raw &r) {
   return out << "buffer::raw("
              << (void*)r.get_data() << " len " << r.get_len()
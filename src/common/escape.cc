@@ -251,11 +251,27 @@ void escape_json_attr(const char *buf, size_t src_len, char *out)
 	*o = '\0';
 }
 
+static inline bool json_needs_escape(unsigned char c)
+{
+  return c == '"' || c == '\\' || c < 0x20 || c == 0x7f;
+}
+
 std::ostream& operator<<(std::ostream& out, const json_stream_escaper& e)
 {
   boost::optional<hex_formatter> fmt;
 
-  for (unsigned char c : e.str) {
+  // write runs of characters that need no escaping in one go
+  const char *run = e.str.data();
+  const char *end = run + e.str.size();
+  for (const char *p = run; p != end; ++p) {
+    const unsigned char c = *p;
+    if (!json_needs_escape(c)) {
+      continue;
+    }
+    if (p != run) {
+      out.write(run, p - run);
+    }
+    run = p + 1;
     switch (c) {
     case '"':
       out << DBL_QUOTE_JESCAPE;
@@ -271,16 +287,15 @@ std::ostream& operator<<(std::ostream& out, const json_stream_escaper& e)
       break;
     default:
       // Escape control characters.
-      if ((c < 0x20) || (c == 0x7f)) {
-        if (!fmt) {
-          fmt.emplace(out); // enable hex formatting
-        }
-        out << "\\u" << std::setw(4) << static_cast<unsigned int>(c);
-      } else {
-        out << c;
+      if (!fmt) {
+        fmt.emplace(out); // enable hex formatting
       }
+      out << "\\u" << std::setw(4) << static_cast<unsigned int>(c);
       break;
     }
   }
+  if (run != end) {
+    out.write(run, end - run);
+  }
   return out;
 }
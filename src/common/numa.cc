@@ -110,20 +110,17 @@ std::set<int> cpu_set_to_set(size_t cpu_set_size,
 }
 
 
-int get_numa_node_cpu_set(
-  int node,
+static int read_cpu_set_list(
+  const std::string& fn,
   size_t *cpu_set_size,
   cpu_set_t *cpu_set)
 {
-  std::string fn = "/sys/devices/system/node/node";
-  fn += stringify(node);
-  fn += "/cpulist";
   int fd = ::open(fn.c_str(), O_RDONLY);
   if (fd < 0) {
     return -errno;
   }
   char buf[1024];
-  int r = safe_read(fd, &buf, sizeof(buf));
+  int r = safe_read(fd, &buf, sizeof(buf) - 1);
   if (r < 0) {
     goto out;
   }
@@ -141,6 +138,26 @@ int get_numa_node_cpu_set(
   return r;
 }
 
+int get_numa_node_cpu_set(
+  int node,
+  size_t *cpu_set_size,
+  cpu_set_t *cpu_set)
+{
+  std::string fn = "/sys/devices/system/node/node";
+  fn += stringify(node);
+  fn += "/cpulist";
+  return read_cpu_set_list(fn, cpu_set_size, cpu_set);
+}
+
+int get_numa_online_nodes(
+  size_t *node_set_size,
+  cpu_set_t *node_set)
+{
+  // node ids use the same list format as cpu ids
+  return read_cpu_set_list("/sys/devices/system/node/online",
+			   node_set_size, node_set);
+}
+
 static int easy_readdir(const std::string& dir, std::set<std::string> *out)
 {
   DIR *h = ::opendir(dir.c_str());
@@ -254,6 +271,12 @@ int get_numa_node_cpu_set(int node,
   return -ENOTSUP;
 }
 
+int get_numa_online_nodes(size_t *node_set_size,
+			  cpu_set_t *node_set)
+{
+  return -ENOTSUP;
+}
+
 int set_cpu_affinity_all_threads(size_t cpu_set_size,
 				 cpu_set_t *cpu_set)
 {
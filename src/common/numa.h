@@ -24,5 +24,9 @@ int get_numa_node_cpu_set(int node,
 			  size_t *cpu_set_size,
 			  cpu_set_t *cpu_set);
 
+/// the online NUMA nodes, as a set of node ids
+int get_numa_online_nodes(size_t *node_set_size,
+			  cpu_set_t *node_set);
+
 int set_cpu_affinity_all_threads(size_t cpu_set_size,
 				 cpu_set_t *cpu_set);
@@ -20,7 +20,10 @@
 #include "include/common_fwd.h"
 #include "include/utime.h"
 
+#include <algorithm>
+#include <bit>
 #include <sstream>
+#include <thread>
 
 using std::ostringstream;
 using std::make_pair;
@@ -158,6 +161,68 @@ void PerfCountersCollectionImpl::with_counters(std::function<void(
 
 // ---------------------------
 
+template <typename T>
+static void add_to(T& d, uint64_t amt, bool avg)
+{
+  if (avg) {
+    d.avgcount++;
+    d.u64 += amt;
+    d.avgcount2++;
+  } else {
+    d.u64 += amt;
+  }
+}
+
+unsigned PerfCounters::num_shards()
+{
+  static const unsigned n = std::bit_ceil(
+    std::clamp(std::thread::hardware_concurrency(), 1u, 64u));
+  return n;
+}
+
+static unsigned this_thread_shard()
+{
+  static std::atomic<unsigned> next_shard = 0;
+  thread_local unsigned shard =
+    next_shard++ & (PerfCounters::num_shards() - 1);
+  return shard;
+}
+
+PerfCounters::perf_counter_shard_d *PerfCounters::get_shard(
+  perf_counter_data_any_d& data)
+{
+  if (!data.shards) {
+    return nullptr;
+  }
+  return &data.shards[this_thread_shard() * data.shard_stride].slot[
+    data.shard_slot];
+}
+
+void PerfCounters::init_shards()
+{
+  std::vector<perf_counter_data_any_d*> sharded;
+  for (auto& d : m_data) {
+    if ((d.type & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG)) &&
+	!(d.type & PERFCOUNTER_HISTOGRAM)) {
+      sharded.push_back(&d);
+    }
+  }
+  if (sharded.empty()) {
+    return;
+  }
+
+  // each shard is made of whole, aligned blocks, so that threads
+  // updating different shards never share a cache line
+  constexpr unsigned slots = perf_counter_shard_block_d::SLOTS;
+  const uint32_t stride = (sharded.size() + slots - 1) / slots;
+  m_shards = std::vector<perf_counter_shard_block_d>(stride * num_shards());
+  for (uint32_t i = 0; i < sharded.size(); ++i) {
+    sharded[i]->shards = &m_shards[i / slots];
+    sharded[i]->shard_stride = stride;
+    sharded[i]->shard_slot = i % slots;
+  }
+}
+
 PerfCounters::~PerfCounters()
 {
 }
@@ -174,12 +239,11 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt;
-    data.avgcount2++;
+  bool avg = data.type & PERFCOUNTER_LONGRUNAVG;
+  if (auto shard = get_shard(data)) {
+    add_to(*shard, amt, avg);
   } else {
-    data.u64 += amt;
+    add_to(data, amt, avg);
   }
 }
 
@@ -196,7 +260,11 @@ void PerfCounters::dec(int idx, uint64_t amt)
   ceph_assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  if (auto shard = get_shard(data)) {
+    shard->u64 -= amt;
+  } else {
+    data.u64 -= amt;
+  }
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -214,6 +282,8 @@ void PerfCounters::set(int idx, uint64_t amt)
 
   ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
                              "perf counter atomic");
+  // the base value becomes the whole sum
+  data.for_each_shard([](perf_counter_shard_d& s) { s.u64 = 0; });
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount++;
     data.u64 = amt;
@@ -235,7 +305,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -250,12 +320,11 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.to_nsec();
-    data.avgcount2++;
+  bool avg = data.type & PERFCOUNTER_LONGRUNAVG;
+  if (auto shard = get_shard(data)) {
+    add_to(*shard, amt.to_nsec(), avg);
   } else {
-    data.u64 += amt.to_nsec();
+    add_to(data, amt.to_nsec(), avg);
   }
 }
 
@@ -271,12 +340,11 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.count();
-    data.avgcount2++;
+  bool avg = data.type & PERFCOUNTER_LONGRUNAVG;
+  if (auto shard = get_shard(data)) {
+    add_to(*shard, amt.count(), avg);
   } else {
-    data.u64 += amt.count();
+    add_to(data, amt.count(), avg);
   }
 }
 
@@ -292,6 +360,7 @@ void PerfCounters::tset(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
+  data.for_each_shard([](perf_counter_shard_d& s) { s.u64 = 0; });
   data.u64 = amt.to_nsec();
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     ceph_abort();
@@ -309,6 +378,7 @@ void PerfCounters::tset(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
+  data.for_each_shard([](perf_counter_shard_d& s) { s.u64 = 0; });
   data.u64 = amt.count();
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     ceph_abort();
@@ -326,7 +396,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -507,7 +577,7 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         Formatter::ObjectSection histogram_section{*f, d->name};
         d->histogram->dump_formatted(f);
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -637,6 +707,10 @@ PerfCounters *PerfCountersBuilder::create_perf_counters()
     ceph_assert(d->type & (PERFCOUNTER_U64 | PERFCOUNTER_TIME));
   }
 
+  if (sharded) {
+    m_perf_counters->init_shards();
+  }
+
   PerfCounters *ret = m_perf_counters;
   m_perf_counters = NULL;
   return ret;
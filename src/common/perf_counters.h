@@ -123,6 +123,13 @@ public:
     prio_default = prio_;
   }
 
+  /// spread updates of counters and averages over per-thread shards
+  /// that are only summed up when read; for hot, widely shared loggers
+  void set_sharded(bool s)
+  {
+    sharded = s;
+  }
+
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -134,6 +141,7 @@ private:
   PerfCounters *m_perf_counters;
 
   int prio_default = 0;
+  bool sharded = false;
 };
 
 /*
@@ -160,10 +168,30 @@ private:
  * For the time average, it returns the current value and
  * the "avgcount" member when read off. avgcount is incremented when you call
  * tinc. Calling tset on an average is an error and will assert out.
+ *
+ * A sharded PerfCounters (see PerfCountersBuilder::set_sharded) keeps the
+ * counters and averages in one slot per shard, picked by the calling
+ * thread, so that concurrent inc/tinc do not bounce a shared cache line.
+ * Readers sum the shards; set/tset fold them back into the base value.
+ * Gauges and histograms are never sharded.
  */
 class PerfCounters
 {
 public:
+  /** Per-shard part of a sharded counter. */
+  struct perf_counter_shard_d {
+    std::atomic<uint64_t> u64 = { 0 };
+    std::atomic<uint64_t> avgcount = { 0 };
+    std::atomic<uint64_t> avgcount2 = { 0 };
+  };
+
+  /** Cache line aligned group of shard slots, see init_shards(). */
+  struct alignas(64) perf_counter_shard_block_d {
+    static constexpr unsigned SLOTS = 8;
+    perf_counter_shard_d slot[SLOTS];
+  };
+  static_assert(sizeof(perf_counter_shard_block_d) % 64 == 0);
+
   /** Represents a PerfCounters data element. */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
@@ -200,22 +228,66 @@ public:
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
 
+    /// block holding the slot of this counter in shard 0, or nullptr if
+    /// not sharded; the slot in shard i is at
+    /// shards[i * shard_stride].slot[shard_slot]
+    perf_counter_shard_block_d *shards = nullptr;
+    uint32_t shard_stride = 0;
+    uint8_t shard_slot = 0;
+
     void reset()
     {
       if (type != PERFCOUNTER_U64) {
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	    for_each_shard([](perf_counter_shard_d& s) {
+	      s.u64 = 0;
+	      s.avgcount = 0;
+	      s.avgcount2 = 0;
+	    });
       }
       if (histogram) {
         histogram->reset();
       }
     }
 
+    uint64_t read_u64() const {
+      uint64_t v = u64;
+      for_each_shard([&v](const perf_counter_shard_d& s) {
+	v += s.u64;
+      });
+      return v;
+    }
+
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
-    // without any intervening calls to inc, set, or tinc.
+    // without any intervening calls to inc, set, or tinc.  for sharded
+    // counters each shard is read this way and the results are added.
     std::pair<uint64_t,uint64_t> read_avg() const {
+      auto [sum, count] = read_avg(u64, avgcount, avgcount2);
+      for_each_shard([&sum, &count](const perf_counter_shard_d& s) {
+	auto [ssum, scount] = read_avg(s.u64, s.avgcount, s.avgcount2);
+	sum += ssum;
+	count += scount;
+      });
+      return { sum, count };
+    }
+
+    template <typename F>
+    void for_each_shard(F&& f) const {
+      if (shards) {
+	for (unsigned i = 0; i < PerfCounters::num_shards(); ++i) {
+	  f(shards[i * shard_stride].slot[shard_slot]);
+	}
+      }
+    }
+
+  private:
+    static std::pair<uint64_t,uint64_t> read_avg(
+      const std::atomic<uint64_t>& u64,
+      const std::atomic<uint64_t>& avgcount,
+      const std::atomic<uint64_t>& avgcount2) {
       uint64_t sum, count;
       do {
 	count = avgcount2;
@@ -288,6 +360,9 @@ public:
                     0);
   }
 
+  /// number of shards used by sharded PerfCounters (a power of two)
+  static unsigned num_shards();
+
 private:
   PerfCounters(CephContext *cct, const std::string &name,
 	     int lower_bound, int upper_bound);
@@ -296,6 +371,8 @@ private:
   void dump_formatted_generic(ceph::Formatter *f, bool schema, bool histograms,
                               select_labeled_t dump_labeled,
                               const std::string &counter = "") const;
+  void init_shards();
+  perf_counter_shard_d *get_shard(perf_counter_data_any_d& data);
 
   typedef std::vector<perf_counter_data_any_d> perf_counter_data_vec_t;
 
@@ -314,6 +391,9 @@ private:
 
   perf_counter_data_vec_t m_data;
 
+  /// shard-major storage of sharded counters, see init_shards()
+  std::vector<perf_counter_shard_block_d> m_shards;
+
   friend class PerfCountersBuilder;
   friend class PerfCountersCollectionImpl;
 };
@@ -0,0 +1,224 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef CEPH_DEBUG_MUTEX
+#include "common/mutex_debug.h"
+#endif
+
+namespace ceph {
+/// a shared mutex whose shared side scales with the number of threads
+///
+/// Readers only touch the counter of their own slot, so taking the lock
+/// shared from many cores does not bounce one cache line between all of
+/// them.  In exchange writers are expensive: they block new readers and
+/// wait for the readers in every slot to drain.  Use it for locks that
+/// are almost always taken shared.
+///
+/// Like ceph::shared_mutex in debug builds, it prefers writers and is not
+/// recursive: a thread that takes it shared a second time while a writer
+/// is waiting deadlocks.  Debug builds have lockdep (named after @a name)
+/// catch that.
+class sharded_shared_mutex
+#ifdef CEPH_DEBUG_MUTEX
+  : public ceph::mutex_debug_detail::mutex_debugging_base
+#endif
+{
+public:
+#ifdef CEPH_DEBUG_MUTEX
+  sharded_shared_mutex(const std::string& name = "sharded_shared_mutex")
+    : mutex_debugging_base{name}
+  {}
+#else
+  // the name is only used by the lockdep-checked debug variant
+  sharded_shared_mutex(const std::string& name = {})
+  {}
+#endif
+  ~sharded_shared_mutex() = default;
+  sharded_shared_mutex(const sharded_shared_mutex&) = delete;
+  sharded_shared_mutex& operator=(const sharded_shared_mutex&) = delete;
+
+  void lock_shared()
+  {
+#ifdef CEPH_DEBUG_MUTEX
+    if (_enable_lockdep()) {
+      _will_lock();
+    }
+#endif
+    auto& readers = slots[slot_index()].readers;
+    while (true) {
+      readers.fetch_add(1, std::memory_order_seq_cst);
+      if (!writer.load(std::memory_order_seq_cst)) {
+        break;
+      }
+      reader_exit(readers);
+      writer.wait(true, std::memory_order_acquire);
+    }
+#ifdef CEPH_DEBUG_MUTEX
+    if (_enable_lockdep()) {
+      _locked();
+    }
+    ++nrlock;
+#endif
+  }
+
+  bool try_lock_shared()
+  {
+    auto& readers = slots[slot_index()].readers;
+    readers.fetch_add(1, std::memory_order_seq_cst);
+    if (writer.load(std::memory_order_seq_cst)) {
+      reader_exit(readers);
+      return false;
+    }
+#ifdef CEPH_DEBUG_MUTEX
+    if (_enable_lockdep()) {
+      _locked();
+    }
+    ++nrlock;
+#endif
+    return true;
+  }
+
+  void unlock_shared()
+  {
+#ifdef CEPH_DEBUG_MUTEX
+    ceph_assert(nrlock > 0);
+    --nrlock;
+    if (_enable_lockdep()) {
+      _will_unlock();
+    }
+#endif
+    // the slot may differ from the one lock_shared() used if the lock was
+    // handed to another thread; writers only look at the sum
+    reader_exit(slots[slot_index()].readers);
+  }
+
+  void lock()
+  {
+#ifdef CEPH_DEBUG_MUTEX
+    if (_enable_lockdep()) {
+      _will_lock();
+    }
+#endif
+    writer_lock.lock();
+    writer.store(true, std::memory_order_seq_cst);
+    {
+      std::unique_lock l{drain_lock};
+      drained.wait(l, [this] { return !has_readers(); });
+    }
+    post_lock();
+  }
+
+  bool try_lock()
+  {
+    if (!writer_lock.try_lock()) {
+      return false;
+    }
+    writer.store(true, std::memory_order_seq_cst);
+    if (has_readers()) {
+      release();
+      return false;
+    }
+    post_lock();
+    return true;
+  }
+
+  void unlock()
+  {
+#ifdef CEPH_DEBUG_MUTEX
+    ceph_assert(nlock > 0);
+    ceph_assert(locked_by == std::this_thread::get_id());
+    --nlock;
+    locked_by = std::thread::id();
+    if (_enable_lockdep()) {
+      _will_unlock();
+    }
+#endif
+    release();
+  }
+
+#ifdef CEPH_DEBUG_MUTEX
+  bool is_wlocked() const {
+    return nlock > 0;
+  }
+  bool is_rlocked() const {
+    return nrlock > 0;
+  }
+  bool is_locked() const {
+    return nlock > 0 || nrlock > 0;
+  }
+#endif
+
+private:
+  static constexpr unsigned NUM_SLOTS = 64;
+
+  static unsigned slot_index()
+  {
+    static std::atomic<unsigned> next_slot = 0;
+    thread_local unsigned slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed) % NUM_SLOTS;
+    return slot;
+  }
+
+  bool has_readers() const
+  {
+    // a reader that raced with the writer flag may be counted for a
+    // moment, but a reader holding the lock is never missed
+    long sum = 0;
+    for (auto& s : slots) {
+      sum += s.readers.load(std::memory_order_seq_cst);
+    }
+    return sum != 0;
+  }
+
+  void reader_exit(std::atomic<long>& readers)
+  {
+    readers.fetch_sub(1, std::memory_order_seq_cst);
+    // either the writer sees our decrement when it checks for readers,
+    // or we see its flag here and wake it
+    if (writer.load(std::memory_order_seq_cst)) {
+      std::lock_guard l{drain_lock};
+      drained.notify_one();
+    }
+  }
+
+  void post_lock()
+  {
+#ifdef CEPH_DEBUG_MUTEX
+    if (_enable_lockdep()) {
+      _locked();
+    }
+    ceph_assert(nlock == 0);
+    locked_by = std::this_thread::get_id();
+    ++nlock;
+#endif
+  }
+
+  void release()
+  {
+    writer.store(false, std::memory_order_seq_cst);
+    writer.notify_all();
+    writer_lock.unlock();
+  }
+
+  struct alignas(64) slot_t {
+    std::atomic<long> readers = 0;
+  };
+  std::array<slot_t, NUM_SLOTS> slots;
+  std::atomic<bool> writer = false;
+  std::mutex writer_lock;
+  // a writer sleeps here until the readers have drained
+  std::mutex drain_lock;
+  std::condition_variable drained;
+#ifdef CEPH_DEBUG_MUTEX
+  std::atomic<unsigned> nrlock{0};
+#endif
+};
+} // namespace ceph
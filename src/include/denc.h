@@ -30,6 +30,7 @@
 #include <concepts>
 #include <map>
 #include <optional>
+#include <ranges>
 #include <set>
 #include <string>
 #include <type_traits>
@@ -314,6 +315,7 @@ struct denc_traits<T> {
   static constexpr bool featured = false;
   static constexpr bool bounded = true;
   static constexpr bool need_contiguous = false;
+  static constexpr size_t raw_len = sizeof(T);
   static void bound_encode(const T &o, size_t& p, uint64_t f=0) {
     p += sizeof(T);
   }
@@ -387,6 +389,7 @@ struct denc_traits<T>
   static constexpr bool bounded = true;
   static constexpr bool need_contiguous = false;
   using etype = _denc::ExtType_t<T>;
+  static constexpr size_t raw_len = sizeof(etype);
   static void bound_encode(const T &o, size_t& p, uint64_t f=0) {
     p += sizeof(etype);
   }
@@ -406,6 +409,27 @@ struct denc_traits<T>
   }
 };
 
+// raw layout
+//
+// A type is bulk copyable when its encoding is exactly its in-memory
+// representation: denc_traits<T>::raw_len covers the whole object and
+// the host is little-endian.  Contiguous containers of such types are
+// encoded and decoded with a single memcpy and a single bounds check.
+// bool is excluded, as not every byte on the wire is a valid bool.
+namespace _denc {
+template<typename T>
+concept bulk_copyable =
+  std::endian::native == std::endian::little &&
+  !std::is_same_v<T, bool> &&
+  std::is_trivially_copyable_v<T> &&
+  requires { requires denc_traits<T>::raw_len == sizeof(T); };
+
+template<typename C>
+concept bulk_copyable_container =
+  std::ranges::contiguous_range<C> &&
+  bulk_copyable<std::ranges::range_value_t<C>>;
+} // namespace _denc
+
 // varint
 //
 // high bit of each byte indicates another byte follows.
@@ -994,6 +1018,12 @@ namespace _denc {
     // nohead
     static void encode_nohead(const container& s, ceph::buffer::list::contiguous_appender& p,
 			      uint64_t f = 0) {
+      if constexpr (_denc::bulk_copyable_container<container>) {
+        if (const size_t len = s.size() * sizeof(T); len > 0) {
+          std::memcpy(p.get_pos_add(len), s.data(), len);
+        }
+        return;
+      }
       for (const T& e : s) {
         if constexpr (traits::featured) {
           denc(e, p, f);
@@ -1005,6 +1035,16 @@ namespace _denc {
     static void decode_nohead(size_t num, container& s,
 			      ceph::buffer::ptr::const_iterator& p,
 			      uint64_t f=0) {
+      if constexpr (_denc::bulk_copyable_container<container> &&
+		    requires { s.resize(num); }) {
+        // bounds check before sizing the container for num elements
+        const char* src = p.get_pos_add(num * sizeof(T));
+        s.resize(num);
+        if (num > 0) {
+          std::memcpy(s.data(), src, num * sizeof(T));
+        }
+        return;
+      }
       s.clear();
       Details::reserve(s, num);
       while (num--) {
@@ -1017,6 +1057,17 @@ namespace _denc {
     static std::enable_if_t<!!sizeof(U) && !need_contiguous>
     decode_nohead(size_t num, container& s,
 		  ceph::buffer::list::const_iterator& p) {
+      if constexpr (_denc::bulk_copyable_container<container> &&
+		    requires { s.resize(num); }) {
+        if (num * sizeof(T) > p.get_remaining()) {
+          throw ceph::buffer::end_of_buffer();
+        }
+        s.resize(num);
+        if (num > 0) {
+          p.copy(num * sizeof(T), reinterpret_cast<char*>(s.data()));
+        }
+        return;
+      }
       s.clear();
       Details::reserve(s, num);
       while (num--) {
@@ -1280,6 +1331,10 @@ public:
 
   static void encode(const container& s, ceph::buffer::list::contiguous_appender& p,
 		     uint64_t f = 0) {
+    if constexpr (_denc::bulk_copyable<T> && N > 0) {
+      std::memcpy(p.get_pos_add(sizeof(s)), s.data(), sizeof(s));
+      return;
+    }
     for (const auto& e : s) {
       if constexpr (traits::featured) {
         denc(e, p, f);
@@ -1290,6 +1345,10 @@ public:
   }
   static void decode(container& s, ceph::buffer::ptr::const_iterator& p,
 		     uint64_t f = 0) {
+    if constexpr (_denc::bulk_copyable<T> && N > 0) {
+      std::memcpy(s.data(), p.get_pos_add(sizeof(s)), sizeof(s));
+      return;
+    }
     for (auto& e : s)
       denc(e, p, f);
   }
@@ -1631,6 +1690,45 @@ struct denc_traits<std::nullopt_t> {
     }									\
   };
 
+// Write denc_traits<> for a fixed-layout class whose encoding is the
+// first len bytes of its in-memory representation, e.g. a struct of
+// integers without padding in between.  On little-endian hosts these
+// bytes are copied with a single memcpy and bounds check instead of
+// field by field; elsewhere the class' DENC method is used, which must
+// encode the same bytes.  If len == sizeof(T), containers of T are bulk
+// copied as well.
+
+#define WRITE_CLASS_DENC_RAW(T, len)					\
+  template<> struct denc_traits<T> {					\
+    static_assert(std::is_trivially_copyable_v<T> &&			\
+		  std::is_standard_layout_v<T> && (len) <= sizeof(T));	\
+    static constexpr bool supported = true;				\
+    static constexpr bool featured = false;				\
+    static constexpr bool bounded = true;				\
+    static constexpr bool need_contiguous = !_denc::has_legacy_denc<T>::value;\
+    static constexpr size_t raw_len = (len);				\
+    static void bound_encode(const T& v, size_t& p, uint64_t f=0) {	\
+      p += raw_len;							\
+    }									\
+    template<class It>							\
+    requires (!is_const_iterator<It>)					\
+    static void encode(const T& v, It& p, uint64_t f=0) {		\
+      if constexpr (std::endian::native == std::endian::little) {	\
+        std::memcpy(p.get_pos_add(raw_len), &v, raw_len);		\
+      } else {								\
+        v.encode(p);							\
+      }									\
+    }									\
+    template<is_const_iterator It>					\
+    static void decode(T& v, It& p, uint64_t f=0) {			\
+      if constexpr (std::endian::native == std::endian::little) {	\
+        std::memcpy(&v, p.get_pos_add(raw_len), raw_len);		\
+      } else {								\
+        v.decode(p);							\
+      }									\
+    }									\
+  };
+
 // ----------------------------------------------------------------------
 // encoded_sizeof_wrapper
 
@@ -512,7 +512,7 @@ public:
   }
 };
 WRITE_CLASS_ENCODER(utime_t)
-WRITE_CLASS_DENC(utime_t)
+WRITE_CLASS_DENC_RAW(utime_t, sizeof(__u32) + sizeof(__u32))
 
 // arithmetic operators
 inline utime_t operator+(const utime_t& l, const utime_t& r) {
@@ -10,6 +10,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 #include "include/encoding.h"
 #include "common/Formatter.h"
@@ -131,6 +132,20 @@ public:
       const std::string &end        ///< [in] The start bound of remove keys
       ) = 0;
 
+    /// Remove keys in [start, end) like rm_range_keys(), but drop them with a
+    /// single range tombstone once the range holds range_delete_threshold
+    /// keys or more.  Returns true if a range tombstone was written, in which
+    /// case the caller may want to compact the range once committed.
+    virtual bool rm_range_keys_bulk(
+      const std::string &prefix,    ///< [in] Prefix by which to remove keys
+      const std::string &start,     ///< [in] The start bound of remove keys
+      const std::string &end,       ///< [in] The end bound of remove keys
+      uint64_t range_delete_threshold ///< [in] Keys needed for a range delete
+      ) {
+      rm_range_keys(prefix, start, end);
+      return false;
+    }
+
     /// Merge value into key
     virtual void merge(
       const std::string &prefix,   ///< [in] Prefix/CF ==> MUST match some established merge operator
@@ -359,6 +374,8 @@ protected:
 public:
   typedef uint32_t IteratorOpts;
   static const uint32_t ITERATOR_NOCACHE = 1;
+  /// caller expects a long sequential scan; backend may prefetch ahead
+  static const uint32_t ITERATOR_READAHEAD = 2;
 
   struct IteratorBounds {
     std::optional<std::string> lower_bound;
@@ -21,6 +21,7 @@
 #include "rocksdb/utilities/convenience.h"
 #include "rocksdb/utilities/table_properties_collectors.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/version.h"
 
 #include "common/perf_counters.h"
 #include "common/PriorityCache.h"
@@ -1782,17 +1783,37 @@ void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix
 void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
                                                          const string &start,
                                                          const string &end)
+{
+  _rm_range_keys(prefix, start, end, db->get_delete_range_threshold());
+}
+
+bool RocksDBStore::RocksDBTransactionImpl::rm_range_keys_bulk(
+  const string &prefix,
+  const string &start,
+  const string &end,
+  uint64_t range_delete_threshold)
+{
+  ceph_assert(range_delete_threshold > 0);
+  return _rm_range_keys(prefix, start, end, range_delete_threshold);
+}
+
+bool RocksDBStore::RocksDBTransactionImpl::_rm_range_keys(
+  const string &prefix,
+  const string &start,
+  const string &end,
+  uint64_t range_delete_threshold)
 {
   ldout(db->cct, 10) << __func__
                      << " enter prefix=" << prefix
                      << " start=" << pretty_binary_string(start)
 		     << " end=" << pretty_binary_string(end) << dendl;
+  bool range_deleted = false;
   auto p_iter = db->cf_handles.find(prefix);
-  uint64_t cnt = db->get_delete_range_threshold();
+  uint64_t cnt = range_delete_threshold;
   if (p_iter == db->cf_handles.end()) {
     uint64_t cnt0 = cnt;
     bat.SetSavePoint();
-    auto it = db->get_iterator(prefix);
+    auto it = db->get_iterator(prefix, 0, KeyValueDB::IteratorBounds{start, end});
     for (it->lower_bound(start);
 	 it->valid() && db->comparator->Compare(it->key(), end) < 0 && (--cnt) != 0;
 	 it->next()) {
@@ -1805,6 +1826,7 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
       ldout(db->cct, 10) << __func__ << " p_iter == end(), resorting to DeleteRange"
 			 << dendl;
       bat.RollbackToSavePoint();
+      range_deleted = true;
       bat.DeleteRange(db->default_cf,
 		      rocksdb::Slice(combine_strings(prefix, start)),
 		      rocksdb::Slice(combine_strings(prefix, end)));
@@ -1818,13 +1840,14 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
 			   << dendl;
 	bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
     }
+    range_deleted = true;
   } else {
     auto bounds = KeyValueDB::IteratorBounds();
     bounds.lower_bound = start;
     bounds.upper_bound = end;
     ceph_assert(p_iter->second.handles.size() >= 1);
     for (auto cf : p_iter->second.handles) {
-      cnt = db->get_delete_range_threshold();
+      cnt = range_delete_threshold;
       uint64_t cnt0 = cnt;
       bat.SetSavePoint();
       auto it = db->new_shard_iterator(cf, prefix, bounds);
@@ -1840,6 +1863,7 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
         ldout(db->cct, 10) << __func__ << " p_iter != end(), resorting to DeleteRange"
 			   << dendl;
 	bat.RollbackToSavePoint();
+	range_deleted = true;
 	bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
       } else {
 	bat.PopSavePoint();
@@ -1847,6 +1871,7 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
     }
   }
   ldout(db->cct, 10) << __func__ << " end" << dendl;
+  return range_deleted;
 }
 
 void RocksDBStore::RocksDBTransactionImpl::merge(
@@ -1894,36 +1919,45 @@ int RocksDBStore::get(
     const std::set<string> &keys,
     std::map<string, bufferlist> *out)
 {
-  rocksdb::PinnableSlice value;
   utime_t start = ceph_clock_now();
+  const size_t n = keys.size();
+  if (n == 0) {
+    return 0;
+  }
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs(n);
+  std::vector<rocksdb::Slice> slices(n);
+  std::vector<string> combined;  // backs slices when prefix is not a CF
+  size_t i = 0;
   if (cf_handles.count(prefix) > 0) {
     for (auto& key : keys) {
-      auto cf_handle = get_cf_handle(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    cf_handle,
-			    rocksdb::Slice(key),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+      // keys of a sharded prefix may land in different CFs
+      cfs[i] = get_cf_handle(prefix, key);
+      slices[i] = rocksdb::Slice(key);
+      ++i;
     }
   } else {
+    combined.reserve(n);
     for (auto& key : keys) {
-      string k = combine_strings(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    default_cf,
-			    rocksdb::Slice(k),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
-    }
+      combined.push_back(combine_strings(prefix, key));
+      cfs[i] = default_cf;
+      slices[i] = rocksdb::Slice(combined.back());
+      ++i;
+    }
+  }
+  // the batched MultiGet shares memtable/SST lookups between keys that fall
+  // into the same blocks and issues the block reads of one file together
+  std::vector<rocksdb::PinnableSlice> values(n);
+  std::vector<rocksdb::Status> statuses(n);
+  db->MultiGet(rocksdb::ReadOptions(), n, cfs.data(), slices.data(),
+	       values.data(), statuses.data());
+  i = 0;
+  for (auto& key : keys) {
+    if (statuses[i].ok()) {
+      (*out)[key].append(values[i].data(), values[i].size());
+    } else if (statuses[i].IsIOError()) {
+      ceph_abort_msg(statuses[i].getState());
+    }
+    ++i;
   }
   utime_t lat = ceph_clock_now() - start;
   logger->tinc(l_rocksdb_get_latency, lat);
@@ -2345,12 +2379,13 @@ public:
   explicit CFIteratorImpl(const RocksDBStore* db,
                           const std::string& p,
                           rocksdb::ColumnFamilyHandle* cf,
+                          KeyValueDB::IteratorOpts opts,
                           KeyValueDB::IteratorBounds bounds_)
     : prefix(p), bounds(std::move(bounds_)),
       iterate_lower_bound(make_slice(bounds.lower_bound)),
       iterate_upper_bound(make_slice(bounds.upper_bound))
       {
-      auto options = rocksdb::ReadOptions();
+      auto options = db->get_iterator_read_options(opts);
       if (db->cct->_conf->osd_rocksdb_iterator_bounds_enabled) {
         if (bounds.lower_bound) {
           options.iterate_lower_bound = &iterate_lower_bound;
@@ -2937,13 +2972,14 @@ public:
   explicit ShardMergeIteratorImpl(const RocksDBStore* db,
 				  const std::string& prefix,
 				  const std::vector<rocksdb::ColumnFamilyHandle*>& shards,
+                  KeyValueDB::IteratorOpts opts,
                   KeyValueDB::IteratorBounds bounds_)
     : db(db), keyless(db->comparator), prefix(prefix), bounds(std::move(bounds_)),
       iterate_lower_bound(make_slice(bounds.lower_bound)),
       iterate_upper_bound(make_slice(bounds.upper_bound))
   {
     iters.reserve(shards.size());
-    auto options = rocksdb::ReadOptions();
+    auto options = db->get_iterator_read_options(opts);
     if (db->cct->_conf->osd_rocksdb_iterator_bounds_enabled) {
       if (bounds.lower_bound) {
         options.iterate_lower_bound = &iterate_lower_bound;
@@ -3149,23 +3185,53 @@ KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix, Itera
               this,
               prefix,
               cf,
+              opts,
               std::move(bounds));
     } else {
       return std::make_shared<ShardMergeIteratorImpl>(
         this,
         prefix,
         cf_it->second.handles,
+        opts,
         std::move(bounds));
     }
+  } else if (prefix.empty()) {
+    return KeyValueDB::make_iterator(prefix, get_wholespace_iterator(opts));
   } else {
-    // use wholespace engine if no cfs are configured
-    // or use default cf otherwise as there is no
-    // matching cf for the specified prefix.
-    auto w_it = cf_handles.size() == 0 || prefix.empty() ?
-      get_wholespace_iterator(opts) :
-      get_default_cf_iterator();
-    return KeyValueDB::make_iterator(prefix, w_it);
+    // the prefix lives in the default cf, whether or not other cfs are
+    // configured. Translate the bounds to raw keys so rocksdb stops at them
+    // instead of walking on through tombstones past the end of the range.
+    IteratorBounds raw_bounds;
+    if (bounds.lower_bound) {
+      raw_bounds.lower_bound = combine_strings(prefix, *bounds.lower_bound);
+    }
+    if (bounds.upper_bound) {
+      raw_bounds.upper_bound = combine_strings(prefix, *bounds.upper_bound);
+    }
+    return KeyValueDB::make_iterator(
+      prefix,
+      std::make_shared<RocksDBWholeSpaceIteratorImpl>(
+	this, default_cf, opts, std::move(raw_bounds)));
+  }
+}
+
+rocksdb::ReadOptions RocksDBStore::get_iterator_read_options(
+  IteratorOpts opts) const
+{
+  rocksdb::ReadOptions options;
+  if (opts & ITERATOR_NOCACHE) {
+    options.fill_cache = false;
+  }
+  if (opts & ITERATOR_READAHEAD) {
+    // 0 keeps rocksdb's automatic readahead, which starts at 8K after a
+    // couple of sequential block reads and doubles up to 256K
+    options.readahead_size = cct->_conf->rocksdb_iterator_readahead_size;
+#if (ROCKSDB_MAJOR >= 7)
+    // carry the grown readahead over to the next file of a long scan
+    options.adaptive_readahead = true;
+#endif
   }
+  return options;
 }
 
 RocksDBStore::WholeSpaceIterator RocksDBStore::new_shard_iterator(rocksdb::ColumnFamilyHandle* cf)
@@ -3184,6 +3250,7 @@ KeyValueDB::Iterator RocksDBStore::new_shard_iterator(rocksdb::ColumnFamilyHandl
     this,
     prefix,
     cf,
+    0,
     std::move(bounds));
 }
 
@@ -331,6 +331,18 @@ public:
       const std::string &prefix,
       const std::string &start,
       const std::string &end) override;
+    bool rm_range_keys_bulk(
+      const std::string &prefix,
+      const std::string &start,
+      const std::string &end,
+      uint64_t range_delete_threshold) override;
+  private:
+    bool _rm_range_keys(
+      const std::string &prefix,
+      const std::string &start,
+      const std::string &end,
+      uint64_t range_delete_threshold);
+  public:
     void merge(
       const std::string& prefix,
       const std::string& k,
@@ -364,14 +376,28 @@ public:
     public KeyValueDB::WholeSpaceIteratorImpl {
   protected:
     rocksdb::Iterator *dbiter;
+    // bounds on raw (prefix-combined) keys
+    const KeyValueDB::IteratorBounds bounds;
+    const rocksdb::Slice iterate_lower_bound;
+    const rocksdb::Slice iterate_upper_bound;
   public:
     explicit RocksDBWholeSpaceIteratorImpl(const RocksDBStore* db,
                                            rocksdb::ColumnFamilyHandle* cf,
-                                           const KeyValueDB::IteratorOpts opts)
+                                           const KeyValueDB::IteratorOpts opts,
+                                           KeyValueDB::IteratorBounds bounds_ = {})
+      : bounds(std::move(bounds_)),
+        iterate_lower_bound(make_slice(bounds.lower_bound)),
+        iterate_upper_bound(make_slice(bounds.upper_bound))
       {
-        rocksdb::ReadOptions options = rocksdb::ReadOptions();
-        if (opts & ITERATOR_NOCACHE)
-          options.fill_cache=false;
+        rocksdb::ReadOptions options = db->get_iterator_read_options(opts);
+        if (db->cct->_conf->osd_rocksdb_iterator_bounds_enabled) {
+          if (bounds.lower_bound) {
+            options.iterate_lower_bound = &iterate_lower_bound;
+          }
+          if (bounds.upper_bound) {
+            options.iterate_upper_bound = &iterate_upper_bound;
+          }
+        }
         dbiter = db->db->NewIterator(options, cf);
     }
     ~RocksDBWholeSpaceIteratorImpl() override;
@@ -400,6 +426,7 @@ public:
 
   Iterator get_iterator(const std::string& prefix, IteratorOpts opts = 0, IteratorBounds = IteratorBounds()) override;
 private:
+  rocksdb::ReadOptions get_iterator_read_options(IteratorOpts opts) const;
   /// this iterator spans single cf
   WholeSpaceIterator new_shard_iterator(rocksdb::ColumnFamilyHandle* cf);
   Iterator new_shard_iterator(rocksdb::ColumnFamilyHandle* cf,
@@ -34,6 +34,14 @@ AsioEngine::AsioEngine(std::shared_ptr<librados::Rados> rados)
                                 std::to_string(rbd_threads));
     m_cct->_conf.apply_changes(nullptr);
   }
+
+  if (m_cct->_conf.get_val<bool>("rbd_op_threads_numa_affinity")) {
+    m_numa_pool = &m_cct->lookup_or_create_singleton_object<asio::NumaPool>(
+      "librbd::asio::NumaPool", false, m_cct, rbd_threads);
+    if (m_numa_pool->get_node_count() == 0) {
+      m_numa_pool = nullptr;
+    }
+  }
 }
 
 AsioEngine::AsioEngine(librados::IoCtx& io_ctx)
@@ -53,4 +61,8 @@ void AsioEngine::post(Context* ctx, int r) {
   post([ctx, r]() { ctx->complete(r); });
 }
 
+void AsioEngine::post_local(Context* ctx, int r) {
+  post_local([ctx, r]() { ctx->complete(r); });
+}
+
 } // namespace librbd
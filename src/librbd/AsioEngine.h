@@ -6,6 +6,7 @@
 
 #include "include/common_fwd.h"
 #include "include/rados/librados_fwd.hpp"
+#include "librbd/asio/NumaPool.h"
 #include <memory>
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/io_context.hpp>
@@ -66,6 +67,17 @@ public:
   }
   void post(Context* ctx, int r);
 
+  /// like post(), but runs t on the NUMA node of the calling thread if
+  /// rbd_op_threads_numa_affinity is enabled
+  template <typename T>
+  void post_local(T&& t) {
+    if (m_numa_pool != nullptr && m_numa_pool->post(t)) {
+      return;
+    }
+    post(std::forward<T>(t));
+  }
+  void post_local(Context* ctx, int r);
+
 private:
   std::shared_ptr<neorados::RADOS> m_rados_api;
   CephContext* m_cct;
@@ -73,6 +85,7 @@ private:
   boost::asio::io_context& m_io_context;
   std::unique_ptr<boost::asio::strand<executor_type>> m_api_strand;
   std::unique_ptr<asio::ContextWQ> m_context_wq;
+  asio::NumaPool* m_numa_pool = nullptr;
 };
 
 } // namespace librbd
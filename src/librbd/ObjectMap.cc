@@ -6,6 +6,7 @@
 #include "librbd/ExclusiveLock.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/asio/ContextWQ.h"
+#include "librbd/object_map/BatchUpdateRequest.h"
 #include "librbd/object_map/RefreshRequest.h"
 #include "librbd/object_map/ResizeRequest.h"
 #include "librbd/object_map/SnapshotCreateRequest.h"
@@ -37,12 +38,23 @@ namespace librbd {
 
 using librbd::util::create_context_callback;
 
+namespace {
+
+// limits of a single batched update, matching the size of the batches
+// UpdateRequest splits very large updates into
+const uint64_t MAX_BATCH_OBJECTS = 256 * (1 << 10);
+const size_t MAX_BATCH_RANGES = 256;
+
+} // anonymous namespace
+
 template <typename I>
 ObjectMap<I>::ObjectMap(I &image_ctx, uint64_t snap_id)
   : RefCountedObject(image_ctx.cct),
     m_image_ctx(image_ctx), m_snap_id(snap_id),
     m_lock(ceph::make_shared_mutex(util::unique_lock_name("librbd::ObjectMap::lock", this))),
-    m_update_guard(new UpdateGuard(m_image_ctx.cct)) {
+    m_update_guard(new UpdateGuard(m_image_ctx.cct)),
+    m_max_inflight_updates(m_image_ctx.config.template get_val<uint64_t>(
+      "rbd_object_map_max_inflight_updates")) {
 }
 
 template <typename I>
@@ -273,6 +285,24 @@ void ObjectMap<I>::detained_aio_update(UpdateOperation &&op) {
   }
 
   ldout(cct, 20) << "in-flight update cell: " << cell << dendl;
+  if (m_max_inflight_updates > 0 &&
+      m_inflight_updates >= m_max_inflight_updates) {
+    ldout(cct, 20) << "queueing object map update for batching: "
+                   << "start=" << op.start_object_no << ", "
+                   << "end=" << op.end_object_no << dendl;
+    m_pending_updates.emplace_back(std::move(op), cell);
+    return;
+  }
+
+  send_detained_aio_update(std::move(op), cell);
+}
+
+template <typename I>
+void ObjectMap<I>::send_detained_aio_update(UpdateOperation &&op,
+                                            BlockGuardCell *cell) {
+  ceph_assert(ceph_mutex_is_wlocked(m_lock));
+
+  ++m_inflight_updates;
   Context *on_finish = op.on_finish;
   Context *ctx = new LambdaContext([this, cell, on_finish](int r) {
       handle_detained_aio_update(cell, r, on_finish);
@@ -293,15 +323,124 @@ void ObjectMap<I>::handle_detained_aio_update(BlockGuardCell *cell, int r,
   {
     std::shared_lock image_locker{m_image_ctx.image_lock};
     std::unique_lock locker{m_lock};
+    ceph_assert(m_inflight_updates > 0);
+    --m_inflight_updates;
     for (auto &op : block_ops) {
       detained_aio_update(std::move(op));
     }
+    send_pending_aio_updates();
   }
 
   on_finish->complete(r);
   m_async_op_tracker.finish_op();
 }
 
+template <typename I>
+void ObjectMap<I>::send_pending_aio_updates() {
+  ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
+  ceph_assert(ceph_mutex_is_wlocked(m_lock));
+  CephContext *cct = m_image_ctx.cct;
+
+  while (!m_pending_updates.empty() &&
+         (m_max_inflight_updates == 0 ||
+          m_inflight_updates < m_max_inflight_updates)) {
+    auto [op, cell] = std::move(m_pending_updates.front());
+    m_pending_updates.pop_front();
+
+    // the cells of all pending updates are disjoint, so every pending
+    // update with the same transition can ride along
+    BatchedUpdates batched_updates{{cell, op.on_finish}};
+    typename object_map::BatchUpdateRequest<I>::Ranges ranges{
+      {op.start_object_no, op.end_object_no}};
+    uint64_t objects = op.end_object_no - op.start_object_no;
+    for (auto it = m_pending_updates.begin();
+         it != m_pending_updates.end() &&
+           batched_updates.size() < MAX_BATCH_RANGES; ) {
+      auto& other = it->first;
+      uint64_t other_objects = other.end_object_no - other.start_object_no;
+      if (other.new_state != op.new_state ||
+          other.current_state != op.current_state ||
+          other.ignore_enoent != op.ignore_enoent ||
+          objects + other_objects > MAX_BATCH_OBJECTS) {
+        ++it;
+        continue;
+      }
+      objects += other_objects;
+      ranges.emplace_back(other.start_object_no, other.end_object_no);
+      batched_updates.emplace_back(it->second, other.on_finish);
+      it = m_pending_updates.erase(it);
+    }
+
+    if (batched_updates.size() == 1) {
+      send_detained_aio_update(std::move(op), cell);
+      continue;
+    }
+
+    // drop ranges that are no-ops against the current in-memory state
+    typename object_map::BatchUpdateRequest<I>::Ranges required_ranges;
+    for (auto [start_object_no, end_object_no] : ranges) {
+      end_object_no = std::min(end_object_no, m_object_map.size());
+      auto it = m_object_map.begin() + std::min(start_object_no,
+                                                end_object_no);
+      auto end_it = m_object_map.begin() + end_object_no;
+      for (; it != end_it; ++it) {
+        if (update_required(it, op.new_state)) {
+          required_ranges.emplace_back(start_object_no, end_object_no);
+          break;
+        }
+      }
+    }
+
+    ldout(cct, 20) << "batching " << batched_updates.size() << " updates, "
+                   << required_ranges.size() << " ranges required" << dendl;
+    ++m_inflight_updates;
+    Context *ctx = new LambdaContext(
+      [this, batched_updates=std::move(batched_updates)](int r) mutable {
+        handle_batched_aio_update(std::move(batched_updates), r);
+      });
+    if (required_ranges.empty()) {
+      m_image_ctx.op_work_queue->queue(ctx, 0);
+      continue;
+    }
+
+    auto req = object_map::BatchUpdateRequest<I>::create(
+      m_image_ctx, &m_lock, &m_object_map, std::move(required_ranges),
+      op.new_state, op.current_state, op.parent_trace, op.ignore_enoent, ctx);
+    req->send();
+  }
+}
+
+template <typename I>
+void ObjectMap<I>::handle_batched_aio_update(BatchedUpdates &&batched_updates,
+                                             int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "updates=" << batched_updates.size() << ", r=" << r
+                 << dendl;
+
+  typename UpdateGuard::BlockOperations block_ops;
+  for (auto& [cell, on_finish] : batched_updates) {
+    typename UpdateGuard::BlockOperations cell_block_ops;
+    m_update_guard->release(cell, &cell_block_ops);
+    block_ops.splice(block_ops.end(), cell_block_ops);
+  }
+
+  {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    std::unique_lock locker{m_lock};
+    ceph_assert(m_inflight_updates > 0);
+    --m_inflight_updates;
+    for (auto &op : block_ops) {
+      detained_aio_update(std::move(op));
+    }
+    send_pending_aio_updates();
+  }
+
+  for (auto& [cell, on_finish] : batched_updates) {
+    on_finish->complete(r);
+    m_async_op_tracker.finish_op();
+  }
+}
+
 template <typename I>
 void ObjectMap<I>::aio_update(uint64_t snap_id, uint64_t start_object_no,
                               uint64_t end_object_no, uint8_t new_state,
@@ -14,7 +14,10 @@
 #include "librbd/Utils.h"
 #include <boost/optional.hpp>
 
+#include <list>
 #include <shared_mutex> // for std::shared_lock
+#include <utility>
+#include <vector>
 
 class Context;
 namespace ZTracer { struct Trace; }
@@ -151,6 +154,9 @@ private:
   };
 
   typedef BlockGuard<UpdateOperation> UpdateGuard;
+  typedef std::list<std::pair<UpdateOperation, BlockGuardCell*>>
+    PendingUpdates;
+  typedef std::vector<std::pair<BlockGuardCell*, Context*>> BatchedUpdates;
 
   ImageCtxT &m_image_ctx;
   uint64_t m_snap_id;
@@ -161,9 +167,19 @@ private:
   AsyncOpTracker m_async_op_tracker;
   UpdateGuard *m_update_guard = nullptr;
 
+  // HEAD updates beyond the in-flight limit wait here, already holding
+  // their cells, and are sent in batches as in-flight updates complete
+  uint64_t m_max_inflight_updates;
+  uint64_t m_inflight_updates = 0;
+  PendingUpdates m_pending_updates;
+
   void detained_aio_update(UpdateOperation &&update_operation);
+  void send_detained_aio_update(UpdateOperation &&update_operation,
+                                BlockGuardCell *cell);
   void handle_detained_aio_update(BlockGuardCell *cell, int r,
                                   Context *on_finish);
+  void send_pending_aio_updates();
+  void handle_batched_aio_update(BatchedUpdates &&batched_updates, int r);
 
   void aio_update(uint64_t snap_id, uint64_t start_object_no,
                   uint64_t end_object_no, uint8_t new_state,
@@ -49,6 +49,7 @@ enum {
 
   l_librbd_readahead,
   l_librbd_readahead_bytes,
+  l_librbd_readahead_used_bytes,
 
   l_librbd_invalidate_cache,
 
@@ -0,0 +1,129 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/asio/NumaPool.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/numa.h"
+#include "common/Thread.h"
+#include <sched.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::asio::NumaPool: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace asio {
+
+std::vector<NumaPool::NodeCpus> NumaPool::discover_nodes(
+    const std::set<int>& node_ids,
+    const get_node_cpu_set_t& get_node_cpu_set) {
+  std::vector<NodeCpus> nodes;
+  for (auto id : node_ids) {
+    NodeCpus node{id};
+    int r = get_node_cpu_set(id, &node.cpu_set_size, &node.cpu_set);
+    if (r < 0 || CPU_COUNT_S(node.cpu_set_size, &node.cpu_set) == 0) {
+      // gone or memory-only node
+      continue;
+    }
+    nodes.push_back(node);
+  }
+  return nodes;
+}
+
+static std::set<int> get_online_nodes() {
+  size_t node_set_size;
+  cpu_set_t node_set;
+  if (get_numa_online_nodes(&node_set_size, &node_set) < 0) {
+    return {};
+  }
+  return cpu_set_to_set(node_set_size, &node_set);
+}
+
+NumaPool::NumaPool(CephContext* cct, uint64_t threads_per_node)
+  : NumaPool(cct, threads_per_node,
+	     discover_nodes(get_online_nodes(), get_numa_node_cpu_set)) {
+}
+
+NumaPool::NumaPool(CephContext* cct, uint64_t threads_per_node,
+		   const std::vector<NodeCpus>& nodes)
+  : m_cct(cct) {
+  for (auto& node_cpus : nodes) {
+    for (auto cpu : cpu_set_to_set(node_cpus.cpu_set_size,
+				   &node_cpus.cpu_set)) {
+      if (m_cpu_nodes.size() <= static_cast<size_t>(cpu)) {
+	m_cpu_nodes.resize(cpu + 1, -1);
+      }
+      m_cpu_nodes[cpu] = m_nodes.size();
+    }
+
+    m_nodes.push_back(std::make_unique<Node>(node_cpus.id));
+    start_node(m_nodes.back().get(), node_cpus.cpu_set_size,
+	       &node_cpus.cpu_set, threads_per_node);
+    ldout(m_cct, 5) << "node " << node_cpus.id << ": cpus "
+		    << cpu_set_to_str_list(node_cpus.cpu_set_size,
+					   &node_cpus.cpu_set) << ", "
+		    << threads_per_node << " threads" << dendl;
+  }
+
+  if (m_nodes.empty()) {
+    lderr(m_cct) << "no NUMA topology found, dispatching on the shared "
+		 << "thread pool" << dendl;
+  }
+}
+
+NumaPool::~NumaPool() {
+  for (auto& node : m_nodes) {
+    node->work_guard.reset();
+  }
+  for (auto& node : m_nodes) {
+    for (auto& thread : node->threads) {
+      thread.join();
+    }
+    m_cct->get_perfcounters_collection()->remove(node->perf_counters);
+    delete node->perf_counters;
+  }
+}
+
+void NumaPool::start_node(Node* node, size_t cpu_set_size,
+			  const cpu_set_t* cpu_set, uint64_t threads) {
+  std::string name = "librbd-numa-node" + std::to_string(node->id);
+  PerfCountersBuilder plb(m_cct, name, l_librbd_numa_first,
+			  l_librbd_numa_last);
+  // posted from every submitting thread
+  plb.set_sharded(m_cct->_conf->perf_counters_sharded);
+  plb.add_u64_counter(l_librbd_numa_queued, "queued",
+		      "Operations queued to the node");
+  plb.add_u64(l_librbd_numa_queue_depth, "queue_depth",
+	      "Operations waiting for a thread of the node");
+  node->perf_counters = plb.create_perf_counters();
+  m_cct->get_perfcounters_collection()->add(node->perf_counters);
+
+  node->work_guard.emplace(boost::asio::make_work_guard(node->io_context));
+  cpu_set_t node_cpus = *cpu_set;
+  for (uint64_t i = 0; i < std::max<uint64_t>(threads, 1); ++i) {
+    node->threads.push_back(make_named_thread(
+      "rbd_numa" + std::to_string(node->id),
+      [this, node, cpu_set_size, node_cpus]() mutable {
+	// pid 0 is the calling thread
+	if (sched_setaffinity(0, cpu_set_size, &node_cpus) < 0) {
+	  int r = -errno;
+	  lderr(m_cct) << "failed to pin thread to node " << node->id << ": "
+		       << cpp_strerror(r) << dendl;
+	}
+	node->io_context.run();
+      }));
+  }
+}
+
+NumaPool::Node* NumaPool::get_node(int cpu) const {
+  if (cpu < 0 || static_cast<size_t>(cpu) >= m_cpu_nodes.size() ||
+      m_cpu_nodes[cpu] < 0) {
+    return nullptr;
+  }
+  return m_nodes[m_cpu_nodes[cpu]].get();
+}
+
+} // namespace asio
+} // namespace librbd
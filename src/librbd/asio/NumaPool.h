@@ -0,0 +1,120 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_ASIO_NUMA_POOL_H
+#define CEPH_LIBRBD_ASIO_NUMA_POOL_H
+
+#include "include/common_fwd.h"
+#include "common/perf_counters.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sched.h>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+namespace librbd {
+namespace asio {
+
+enum {
+  l_librbd_numa_first = 26900,
+  l_librbd_numa_queued,
+  l_librbd_numa_queue_depth,
+  l_librbd_numa_last,
+};
+
+/**
+ * One io_context per NUMA node, run by threads pinned to the CPUs of
+ * that node.  Work posted through post() runs on the node of the CPU
+ * the posting thread is currently scheduled on, so dispatch that follows
+ * an API call stays on the socket of the caller.  Shared by all images
+ * of a CephContext.
+ */
+class NumaPool {
+public:
+  struct NodeCpus {
+    int id;
+    size_t cpu_set_size;
+    cpu_set_t cpu_set;
+  };
+  using get_node_cpu_set_t = std::function<int(int, size_t*, cpu_set_t*)>;
+
+  /// the nodes among node_ids that have CPUs; node ids need not be dense
+  static std::vector<NodeCpus> discover_nodes(
+    const std::set<int>& node_ids,
+    const get_node_cpu_set_t& get_node_cpu_set);
+
+  /// a pool for each online node of the host
+  NumaPool(CephContext* cct, uint64_t threads_per_node);
+  NumaPool(CephContext* cct, uint64_t threads_per_node,
+	   const std::vector<NodeCpus>& nodes);
+  ~NumaPool();
+
+  NumaPool(const NumaPool&) = delete;
+  NumaPool& operator=(const NumaPool&) = delete;
+
+  size_t get_node_count() const {
+    return m_nodes.size();
+  }
+
+  /// id of the node cpu belongs to, or -1
+  int get_cpu_node(int cpu) const {
+    auto node = get_node(cpu);
+    return node ? node->id : -1;
+  }
+
+  /// queue t on the node of the calling thread; t is left untouched and
+  /// false is returned if the current CPU does not belong to a known node
+  template <typename T>
+  bool post(T& t) {
+    auto node = get_local_node();
+    if (node == nullptr) {
+      return false;
+    }
+    node->perf_counters->inc(l_librbd_numa_queued);
+    node->perf_counters->inc(l_librbd_numa_queue_depth);
+    boost::asio::post(node->io_context,
+		      [node, t=std::move(t)]() mutable {
+	node->perf_counters->dec(l_librbd_numa_queue_depth);
+	std::move(t)();
+      });
+    return true;
+  }
+
+private:
+  using work_guard_t =
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+  struct Node {
+    int id;
+    boost::asio::io_context io_context;
+    std::optional<work_guard_t> work_guard;
+    std::vector<std::thread> threads;
+    PerfCounters* perf_counters = nullptr;
+
+    explicit Node(int id) : id(id) {}
+  };
+
+  CephContext* m_cct;
+  std::vector<std::unique_ptr<Node>> m_nodes;
+  // cpu -> index into m_nodes, -1 if the cpu is not in any node
+  std::vector<int> m_cpu_nodes;
+
+  Node* get_node(int cpu) const;
+  Node* get_local_node() {
+    return get_node(sched_getcpu());
+  }
+  void start_node(Node* node, size_t cpu_set_size, const cpu_set_t* cpu_set,
+		  uint64_t threads);
+};
+
+} // namespace asio
+} // namespace librbd
+
+#endif // CEPH_LIBRBD_ASIO_NUMA_POOL_H
@@ -37,6 +37,13 @@ ParentCacheObjectDispatch<I>::ParentCacheObjectDispatch(
   auto controller_path = image_ctx->cct->_conf.template get_val<std::string>(
     "immutable_object_cache_sock");
   m_cache_client = new CacheClient(controller_path.c_str(), m_image_ctx->cct);
+
+  auto mmap_max_size = image_ctx->cct->_conf.template get_val<Option::size_t>(
+    "immutable_object_cache_client_mmap_max_size");
+  if (mmap_max_size > 0) {
+    m_mapped_file_cache = std::make_unique<MappedFileCache>(
+      m_image_ctx->cct, mmap_max_size);
+  }
 }
 
 template <typename I>
@@ -244,6 +251,11 @@ int ParentCacheObjectDispatch<I>::read_object(
   auto *cct = m_image_ctx->cct;
   ldout(cct, 20) << "file path: " << file_path << dendl;
 
+  if (m_mapped_file_cache) {
+    // zero-copy read from the mapped cache file
+    return m_mapped_file_cache->read(file_path, offset, length, read_data);
+  }
+
   std::string error;
   int ret = read_data->pread_file(file_path.c_str(), offset, length, &error);
   if (ret < 0) {
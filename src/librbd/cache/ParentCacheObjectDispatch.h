@@ -8,6 +8,7 @@
 #include "common/ceph_mutex.h"
 #include "librbd/cache/TypeTraits.h"
 #include "tools/immutable_object_cache/CacheClient.h"
+#include "tools/immutable_object_cache/MappedFileCache.h"
 #include "tools/immutable_object_cache/Types.h"
 
 namespace librbd {
@@ -151,6 +152,9 @@ private:
   ceph::mutex m_lock;
   CacheClient *m_cache_client = nullptr;
   bool m_connecting = false;
+
+  std::unique_ptr<ceph::immutable_obj_cache::MappedFileCache>
+    m_mapped_file_cache;
 };
 
 } // namespace cache
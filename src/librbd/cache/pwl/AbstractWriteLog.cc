@@ -70,7 +70,9 @@ AbstractWriteLog<I>::AbstractWriteLog(
       "librbd::cache::pwl::AbstractWriteLog::m_log_append_lock", this))),
     m_lock(ceph::make_mutex(pwl::unique_lock_name(
       "librbd::cache::pwl::AbstractWriteLog::m_lock", this))),
-    m_blocks_to_log_entries(image_ctx.cct),
+    m_blocks_to_log_entries(image_ctx.cct,
+      image_ctx.config.template get_val<uint64_t>(
+        "rbd_persistent_cache_log_map_shards")),
     m_work_queue("librbd::cache::pwl::ReplicatedWriteLog::work_queue",
                  ceph::make_timespan(
                    image_ctx.config.template get_val<uint64_t>(
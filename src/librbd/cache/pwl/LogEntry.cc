@@ -59,7 +59,7 @@ std::ostream& GenericWriteLogEntry::format(std::ostream &os) const {
   } else {
     os << "nullptr";
   }
-  os << "], referring_map_entries=" << referring_map_entries;
+  os << "], referring_map_entries=" << referring_map_entries.load();
   return os;
 }
 
@@ -111,7 +111,9 @@ public:
 
 class GenericWriteLogEntry : public GenericLogEntry {
 public:
-  uint32_t referring_map_entries = 0;
+  // map entries of one log entry may live in different LogMap shards,
+  // which are updated under different locks
+  std::atomic<uint32_t> referring_map_entries = 0;
   std::shared_ptr<SyncPointLogEntry> sync_point_entry;
   GenericWriteLogEntry(std::shared_ptr<SyncPointLogEntry> sync_point_entry,
                        uint64_t image_offset_bytes, uint64_t write_bytes)
@@ -133,7 +135,7 @@ public:
     return ram_entry.block_extent();
   }
   uint32_t get_map_ref() {
-    return(referring_map_entries);
+    return referring_map_entries.load();
   }
   void inc_map_ref() { referring_map_entries++; }
   void dec_map_ref() { referring_map_entries--; }
@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "LogMap.h"
+#include <algorithm>
 #include "include/ceph_assert.h"
 #include "librbd/Utils.h"
 #include "librbd/cache/pwl/LogEntry.h"
@@ -34,10 +35,54 @@ LogMapEntry<T>::LogMapEntry(std::shared_ptr<T> log_entry)
 }
 
 template <typename T>
-LogMap<T>::LogMap(CephContext *cct)
-  : m_cct(cct),
-    m_lock(ceph::make_mutex(pwl::unique_lock_name(
-           "librbd::cache::pwl::LogMap::m_lock", this))) {
+LogMap<T>::Shard::Shard()
+  : lock(ceph::make_mutex(pwl::unique_lock_name(
+         "librbd::cache::pwl::LogMap::m_lock", this))) {
+}
+
+template <typename T>
+LogMap<T>::LogMap(CephContext *cct, uint32_t num_shards)
+  : m_cct(cct) {
+  ceph_assert(num_shards > 0);
+  for (uint32_t i = 0; i < num_shards; ++i) {
+    m_shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+template <typename T>
+template <typename F>
+void LogMap<T>::for_each_stripe(const BlockExtent &block_extent, F &&f) {
+  uint64_t start = block_extent.block_start;
+  while (start < block_extent.block_end) {
+    uint64_t stripe = start / STRIPE_SIZE;
+    uint64_t end = std::min<uint64_t>(block_extent.block_end,
+                                      (stripe + 1) * STRIPE_SIZE);
+    f(*m_shards[stripe % m_shards.size()], BlockExtent(start, end));
+    start = end;
+  }
+}
+
+template <typename T>
+void LogMap<T>::mark_shards(const BlockExtent &block_extent,
+                            std::vector<bool> &shards) const {
+  uint64_t first = block_extent.block_start / STRIPE_SIZE;
+  uint64_t last = (block_extent.block_end + STRIPE_SIZE - 1) / STRIPE_SIZE;
+  uint64_t count = std::min<uint64_t>(last - first, m_shards.size());
+  for (uint64_t i = 0; i < count; ++i) {
+    shards[(first + i) % m_shards.size()] = true;
+  }
+}
+
+template <typename T>
+std::vector<std::unique_lock<ceph::mutex>> LogMap<T>::lock_shards(
+    const std::vector<bool> &shards) {
+  std::vector<std::unique_lock<ceph::mutex>> locks;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    if (shards[i]) {
+      locks.emplace_back(m_shards[i]->lock);
+    }
+  }
+  return locks;
 }
 
 /**
@@ -55,16 +100,30 @@ LogMap<T>::LogMap(CephContext *cct)
  */
 template <typename T>
 void LogMap<T>::add_log_entry(std::shared_ptr<T> log_entry) {
-  std::lock_guard locker(m_lock);
-  add_log_entry_locked(log_entry);
+  add_log_entries(&log_entry, &log_entry + 1);
 }
 
 template <typename T>
 void LogMap<T>::add_log_entries(std::list<std::shared_ptr<T>> &log_entries) {
-  std::lock_guard locker(m_lock);
   ldout(m_cct, 20) << dendl;
-  for (auto &log_entry : log_entries) {
-    add_log_entry_locked(log_entry);
+  add_log_entries(log_entries.begin(), log_entries.end());
+}
+
+template <typename T>
+template <typename It>
+void LogMap<T>::add_log_entries(It first, It last) {
+  std::vector<bool> shards(m_shards.size());
+  for (auto it = first; it != last; ++it) {
+    mark_shards((*it)->block_extent(), shards);
+  }
+  auto locks = lock_shards(shards);
+  for (auto it = first; it != last; ++it) {
+    auto &log_entry = *it;
+    for_each_stripe(log_entry->block_extent(),
+                    [this, &log_entry](Shard &shard, const BlockExtent &piece) {
+      LogMapEntry<T> map_entry(piece, log_entry);
+      add_log_entry_locked(shard, map_entry);
+    });
   }
 }
 
@@ -74,16 +133,30 @@ void LogMap<T>::add_log_entries(std::list<std::shared_ptr<T>> &log_entries) {
  */
 template <typename T>
 void LogMap<T>::remove_log_entry(std::shared_ptr<T> log_entry) {
-  std::lock_guard locker(m_lock);
-  remove_log_entry_locked(log_entry);
+  ldout(m_cct, 20) << "*log_entry=" << *log_entry << dendl;
+  remove_log_entries(&log_entry, &log_entry + 1);
 }
 
 template <typename T>
 void LogMap<T>::remove_log_entries(std::list<std::shared_ptr<T>> &log_entries) {
-  std::lock_guard locker(m_lock);
   ldout(m_cct, 20) << dendl;
-  for (auto &log_entry : log_entries) {
-    remove_log_entry_locked(log_entry);
+  remove_log_entries(log_entries.begin(), log_entries.end());
+}
+
+template <typename T>
+template <typename It>
+void LogMap<T>::remove_log_entries(It first, It last) {
+  std::vector<bool> shards(m_shards.size());
+  for (auto it = first; it != last; ++it) {
+    mark_shards((*it)->block_extent(), shards);
+  }
+  auto locks = lock_shards(shards);
+  for (auto it = first; it != last; ++it) {
+    auto &log_entry = *it;
+    for_each_stripe(log_entry->block_extent(),
+                    [this, &log_entry](Shard &shard, const BlockExtent &piece) {
+      remove_log_entry_locked(shard, log_entry, piece);
+    });
   }
 }
 
@@ -96,85 +169,98 @@ void LogMap<T>::remove_log_entries(std::list<std::shared_ptr<T>> &log_entries) {
  */
 template <typename T>
 std::list<std::shared_ptr<T>> LogMap<T>::find_log_entries(BlockExtent block_extent) {
-  std::lock_guard locker(m_lock);
-  ldout(m_cct, 20) << dendl;
-  return find_log_entries_locked(block_extent);
+  ldout(m_cct, 20) << "block_extent=" << block_extent << dendl;
+  std::list<std::shared_ptr<T>> overlaps;
+  for (auto &map_entry : find_map_entries(block_extent)) {
+    overlaps.emplace_back(map_entry.log_entry);
+  }
+  return overlaps;
 }
 
 /**
  * Returns the list of all write log map entries that overlap the
- * specified block extent.
+ * specified block extent, in address order.
  */
 template <typename T>
 LogMapEntries<T> LogMap<T>::find_map_entries(BlockExtent block_extent) {
-  std::lock_guard locker(m_lock);
   ldout(m_cct, 20) << dendl;
-  return find_map_entries_locked(block_extent);
+  LogMapEntries<T> overlaps;
+  std::vector<bool> shards(m_shards.size());
+  mark_shards(block_extent, shards);
+  auto locks = lock_shards(shards);
+  for_each_stripe(block_extent,
+                  [this, &overlaps](Shard &shard, const BlockExtent &piece) {
+    find_map_entries_locked(shard, piece, &overlaps);
+  });
+  return overlaps;
 }
 
 template <typename T>
-void LogMap<T>::add_log_entry_locked(std::shared_ptr<T> log_entry) {
-  LogMapEntry<T> map_entry(log_entry);
+void LogMap<T>::add_log_entry_locked(Shard &shard, LogMapEntry<T> &map_entry) {
   ldout(m_cct, 20) << "block_extent=" << map_entry.block_extent
                    << dendl;
-  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
-  LogMapEntries<T> overlap_entries = find_map_entries_locked(map_entry.block_extent);
+  ceph_assert(ceph_mutex_is_locked_by_me(shard.lock));
+  LogMapEntries<T> overlap_entries;
+  find_map_entries_locked(shard, map_entry.block_extent, &overlap_entries);
   for (auto &entry : overlap_entries) {
     ldout(m_cct, 20) << entry << dendl;
     if (map_entry.block_extent.block_start <= entry.block_extent.block_start) {
       if (map_entry.block_extent.block_end >= entry.block_extent.block_end) {
         ldout(m_cct, 20) << "map entry completely occluded by new log entry" << dendl;
-        remove_map_entry_locked(entry);
+        remove_map_entry_locked(shard, entry);
       } else {
         ceph_assert(map_entry.block_extent.block_end < entry.block_extent.block_end);
         /* The new entry occludes the beginning of the old entry */
         BlockExtent adjusted_extent(map_entry.block_extent.block_end,
                                     entry.block_extent.block_end);
-        adjust_map_entry_locked(entry, adjusted_extent);
+        adjust_map_entry_locked(shard, entry, adjusted_extent);
       }
     } else {
       if (map_entry.block_extent.block_end >= entry.block_extent.block_end) {
         /* The new entry occludes the end of the old entry */
         BlockExtent adjusted_extent(entry.block_extent.block_start,
                                     map_entry.block_extent.block_start);
-        adjust_map_entry_locked(entry, adjusted_extent);
+        adjust_map_entry_locked(shard, entry, adjusted_extent);
       } else {
         /* The new entry splits the old entry */
-        split_map_entry_locked(entry, map_entry.block_extent);
+        split_map_entry_locked(shard, entry, map_entry.block_extent);
       }
     }
   }
-  add_map_entry_locked(map_entry);
+  add_map_entry_locked(shard, map_entry);
 }
 
 template <typename T>
-void LogMap<T>::remove_log_entry_locked(std::shared_ptr<T> log_entry) {
-  ldout(m_cct, 20) << "*log_entry=" << *log_entry << dendl;
-  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+void LogMap<T>::remove_log_entry_locked(Shard &shard,
+                                        std::shared_ptr<T> log_entry,
+                                        const BlockExtent &block_extent) {
+  ceph_assert(ceph_mutex_is_locked_by_me(shard.lock));
 
-  LogMapEntries<T> possible_hits = find_map_entries_locked(log_entry->block_extent());
+  LogMapEntries<T> possible_hits;
+  find_map_entries_locked(shard, block_extent, &possible_hits);
   for (auto &possible_hit : possible_hits) {
     if (possible_hit.log_entry == log_entry) {
       /* This map entry refers to the specified log entry */
-      remove_map_entry_locked(possible_hit);
+      remove_map_entry_locked(shard, possible_hit);
     }
   }
 }
 
 template <typename T>
-void LogMap<T>::add_map_entry_locked(LogMapEntry<T> &map_entry) {
+void LogMap<T>::add_map_entry_locked(Shard &shard, LogMapEntry<T> &map_entry) {
   ceph_assert(map_entry.log_entry);
-  m_block_to_log_entry_map.insert(map_entry);
+  shard.block_to_log_entry_map.insert(map_entry);
   map_entry.log_entry->inc_map_ref();
 }
 
 template <typename T>
-void LogMap<T>::remove_map_entry_locked(LogMapEntry<T> &map_entry) {
-  auto it = m_block_to_log_entry_map.find(map_entry);
-  ceph_assert(it != m_block_to_log_entry_map.end());
+void LogMap<T>::remove_map_entry_locked(Shard &shard,
+                                        LogMapEntry<T> &map_entry) {
+  auto it = shard.block_to_log_entry_map.find(map_entry);
+  ceph_assert(it != shard.block_to_log_entry_map.end());
 
   LogMapEntry<T> erased = *it;
-  m_block_to_log_entry_map.erase(it);
+  shard.block_to_log_entry_map.erase(it);
   erased.log_entry->dec_map_ref();
   if (0 == erased.log_entry->get_map_ref()) {
     ldout(m_cct, 20) << "log entry has zero map entries: " << erased.log_entry << dendl;
@@ -182,66 +268,60 @@ void LogMap<T>::remove_map_entry_locked(LogMapEntry<T> &map_entry) {
 }
 
 template <typename T>
-void LogMap<T>::adjust_map_entry_locked(LogMapEntry<T> &map_entry, BlockExtent &new_extent) {
-  auto it = m_block_to_log_entry_map.find(map_entry);
-  ceph_assert(it != m_block_to_log_entry_map.end());
+void LogMap<T>::adjust_map_entry_locked(Shard &shard,
+                                        LogMapEntry<T> &map_entry,
+                                        BlockExtent &new_extent) {
+  auto it = shard.block_to_log_entry_map.find(map_entry);
+  ceph_assert(it != shard.block_to_log_entry_map.end());
 
   LogMapEntry<T> adjusted = *it;
-  m_block_to_log_entry_map.erase(it);
+  shard.block_to_log_entry_map.erase(it);
 
-  m_block_to_log_entry_map.insert(LogMapEntry<T>(new_extent, adjusted.log_entry));
+  shard.block_to_log_entry_map.insert(
+    LogMapEntry<T>(new_extent, adjusted.log_entry));
 }
 
 template <typename T>
-void LogMap<T>::split_map_entry_locked(LogMapEntry<T> &map_entry, BlockExtent &removed_extent) {
-  auto it = m_block_to_log_entry_map.find(map_entry);
-  ceph_assert(it != m_block_to_log_entry_map.end());
+void LogMap<T>::split_map_entry_locked(Shard &shard,
+                                       LogMapEntry<T> &map_entry,
+                                       BlockExtent &removed_extent) {
+  auto it = shard.block_to_log_entry_map.find(map_entry);
+  ceph_assert(it != shard.block_to_log_entry_map.end());
 
   LogMapEntry<T> split = *it;
-  m_block_to_log_entry_map.erase(it);
+  shard.block_to_log_entry_map.erase(it);
 
   BlockExtent left_extent(split.block_extent.block_start,
                           removed_extent.block_start);
-  m_block_to_log_entry_map.insert(LogMapEntry<T>(left_extent, split.log_entry));
+  shard.block_to_log_entry_map.insert(
+    LogMapEntry<T>(left_extent, split.log_entry));
 
   BlockExtent right_extent(removed_extent.block_end,
                            split.block_extent.block_end);
-  m_block_to_log_entry_map.insert(LogMapEntry<T>(right_extent, split.log_entry));
+  shard.block_to_log_entry_map.insert(
+    LogMapEntry<T>(right_extent, split.log_entry));
 
   split.log_entry->inc_map_ref();
 }
 
-template <typename T>
-std::list<std::shared_ptr<T>> LogMap<T>::find_log_entries_locked(const BlockExtent &block_extent) {
-  std::list<std::shared_ptr<T>> overlaps;
-  ldout(m_cct, 20) << "block_extent=" << block_extent << dendl;
-
-  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
-  LogMapEntries<T> map_entries = find_map_entries_locked(block_extent);
-  for (auto &map_entry : map_entries) {
-    overlaps.emplace_back(map_entry.log_entry);
-  }
-  return overlaps;
-}
-
 /**
  * TODO: Generalize this to do some arbitrary thing to each map
  * extent, instead of returning a list.
  */
 template <typename T>
-LogMapEntries<T> LogMap<T>::find_map_entries_locked(const BlockExtent &block_extent) {
-  LogMapEntries<T> overlaps;
-
+void LogMap<T>::find_map_entries_locked(Shard &shard,
+                                        const BlockExtent &block_extent,
+                                        LogMapEntries<T> *overlaps) {
   ldout(m_cct, 20) << "block_extent=" << block_extent << dendl;
-  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
-  auto p = m_block_to_log_entry_map.equal_range(LogMapEntry<T>(block_extent));
+  ceph_assert(ceph_mutex_is_locked_by_me(shard.lock));
+  auto p = shard.block_to_log_entry_map.equal_range(
+    LogMapEntry<T>(block_extent));
   ldout(m_cct, 20) << "count=" << std::distance(p.first, p.second) << dendl;
   for ( auto i = p.first; i != p.second; ++i ) {
     LogMapEntry<T> entry = *i;
-    overlaps.emplace_back(entry);
+    overlaps->emplace_back(entry);
     ldout(m_cct, 20) << entry << dendl;
   }
-  return overlaps;
 }
 
 /* We map block extents to write log entries, or portions of write log
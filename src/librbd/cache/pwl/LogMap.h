@@ -6,6 +6,9 @@
 
 #include "librbd/BlockGuard.h"
 #include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace librbd {
 namespace cache {
@@ -15,6 +18,14 @@ namespace pwl {
  * WriteLogMap: maps block extents to GenericWriteLogEntries
  *
  * A WriteLogMapEntry (based on LogMapEntry) refers to a portion of a GenericWriteLogEntry
+ *
+ * The block address space is cut into stripes of STRIPE_SIZE bytes that
+ * are dealt round-robin to a number of shards, each with its own lock, so
+ * that reads and writes to different regions of the image do not contend.
+ * Map entries never cross a stripe boundary; a log entry spanning several
+ * stripes is referred to by one map entry per stripe.  Every operation
+ * holds the locks of all the shards it touches, taken in index order, so
+ * a batch of log entries is added or removed at once.
  */
 template <typename T>
 class LogMapEntry {
@@ -37,7 +48,9 @@ using LogMapEntries = std::list<LogMapEntry<T>>;
 template <typename T>
 class LogMap {
 public:
-  LogMap(CephContext *cct);
+  static const uint64_t STRIPE_SIZE = 1 << 20;
+
+  LogMap(CephContext *cct, uint32_t num_shards = 1);
   LogMap(const LogMap&) = delete;
   LogMap &operator=(const LogMap&) = delete;
 
@@ -49,15 +62,6 @@ public:
   LogMapEntries<T> find_map_entries(BlockExtent block_extent);
 
 private:
-  void add_log_entry_locked(std::shared_ptr<T> log_entry);
-  void remove_log_entry_locked(std::shared_ptr<T> log_entry);
-  void add_map_entry_locked(LogMapEntry<T> &map_entry);
-  void remove_map_entry_locked(LogMapEntry<T> &map_entry);
-  void adjust_map_entry_locked(LogMapEntry<T> &map_entry, BlockExtent &new_extent);
-  void split_map_entry_locked(LogMapEntry<T> &map_entry, BlockExtent &removed_extent);
-  std::list<std::shared_ptr<T>> find_log_entries_locked(const BlockExtent &block_extent);
-  LogMapEntries<T> find_map_entries_locked(const BlockExtent &block_extent);
-
   using LogMapEntryT = LogMapEntry<T>;
 
   class LogMapEntryCompare {
@@ -69,9 +73,41 @@ private:
   using BlockExtentToLogMapEntries = std::set<LogMapEntryT,
                                               LogMapEntryCompare>;
 
+  struct Shard {
+    ceph::mutex lock;
+    BlockExtentToLogMapEntries block_to_log_entry_map;
+
+    Shard();
+  };
+
   CephContext *m_cct;
-  ceph::mutex m_lock;
-  BlockExtentToLogMapEntries m_block_to_log_entry_map;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+
+  /// call f(shard, piece) for the part of block_extent in each stripe,
+  /// in address order
+  template <typename F>
+  void for_each_stripe(const BlockExtent &block_extent, F &&f);
+  /// set shards[i] for each shard i that block_extent touches
+  void mark_shards(const BlockExtent &block_extent,
+                   std::vector<bool> &shards) const;
+  std::vector<std::unique_lock<ceph::mutex>> lock_shards(
+    const std::vector<bool> &shards);
+  template <typename It>
+  void add_log_entries(It first, It last);
+  template <typename It>
+  void remove_log_entries(It first, It last);
+
+  void add_log_entry_locked(Shard &shard, LogMapEntry<T> &map_entry);
+  void remove_log_entry_locked(Shard &shard, std::shared_ptr<T> log_entry,
+                               const BlockExtent &block_extent);
+  void add_map_entry_locked(Shard &shard, LogMapEntry<T> &map_entry);
+  void remove_map_entry_locked(Shard &shard, LogMapEntry<T> &map_entry);
+  void adjust_map_entry_locked(Shard &shard, LogMapEntry<T> &map_entry,
+                               BlockExtent &new_extent);
+  void split_map_entry_locked(Shard &shard, LogMapEntry<T> &map_entry,
+                              BlockExtent &removed_extent);
+  void find_map_entries_locked(Shard &shard, const BlockExtent &block_extent,
+                               LogMapEntries<T> *overlaps);
 };
 
 } //namespace pwl
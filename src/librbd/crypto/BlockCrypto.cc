@@ -2,9 +2,9 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "librbd/crypto/BlockCrypto.h"
-#include "include/byteorder.h"
 #include "include/ceph_assert.h"
 #include "include/scope_guard.h"
+#include "common/errno.h"
 
 #include <bit>
 #include <stdlib.h>
@@ -16,7 +16,7 @@ template <typename T>
 BlockCrypto<T>::BlockCrypto(CephContext* cct, DataCryptor<T>* data_cryptor,
                             uint64_t block_size, uint64_t data_offset)
      : m_cct(cct), m_data_cryptor(data_cryptor), m_block_size(block_size),
-       m_data_offset(data_offset), m_iv_size(data_cryptor->get_iv_size()) {
+       m_data_offset(data_offset) {
   ceph_assert(std::has_single_bit(block_size));
   ceph_assert((block_size % data_cryptor->get_block_size()) == 0);
   ceph_assert((block_size % 512) == 0);
@@ -44,9 +44,6 @@ int BlockCrypto<T>::crypt(ceph::bufferlist* data, uint64_t image_offset,
     return -EINVAL;
   }
 
-  unsigned char* iv = (unsigned char*)alloca(m_iv_size);
-  memset(iv, 0, m_iv_size);
-
   bufferlist src = *data;
   data->clear();
 
@@ -61,55 +58,47 @@ int BlockCrypto<T>::crypt(ceph::bufferlist* data, uint64_t image_offset,
 
   auto sector_number = image_offset / 512;
   auto appender = data->get_contiguous_appender(src.length());
-  unsigned char* out_buf_ptr = nullptr;
   unsigned char* leftover_block = (unsigned char*)alloca(m_block_size);
   uint32_t leftover_size = 0;
+  auto crypt_blocks = [&](const unsigned char* in, uint32_t block_count) {
+    auto length = block_count * m_block_size;
+    auto out = reinterpret_cast<unsigned char*>(appender.get_pos_add(length));
+    auto r = m_data_cryptor->crypt_blocks(ctx, in, out, m_block_size,
+                                          block_count, sector_number);
+    sector_number += block_count * (m_block_size / 512);
+    return r;
+  };
   for (auto buf = src.buffers().begin(); buf != src.buffers().end(); ++buf) {
     auto in_buf_ptr = reinterpret_cast<const unsigned char*>(buf->c_str());
     auto remaining_buf_bytes = buf->length();
     while (remaining_buf_bytes > 0) {
-      if (leftover_size == 0) {
-        auto block_offset_le = ceph_le64(sector_number);
-        memcpy(iv, &block_offset_le, sizeof(block_offset_le));
-        auto r = m_data_cryptor->init_context(ctx, iv, m_iv_size);
-        if (r != 0) {
-          lderr(m_cct) << "unable to init cipher's IV" << dendl;
-          return r;
-        }
-
-        out_buf_ptr = reinterpret_cast<unsigned char*>(
-                appender.get_pos_add(m_block_size));
-        sector_number += m_block_size / 512;
-      }
-
+      int r;
       if (leftover_size > 0 || remaining_buf_bytes < m_block_size) {
+        // block straddles two buffers
         auto copy_size = std::min(
                 (uint32_t)m_block_size - leftover_size, remaining_buf_bytes);
         memcpy(leftover_block + leftover_size, in_buf_ptr, copy_size);
         in_buf_ptr += copy_size;
         leftover_size += copy_size;
         remaining_buf_bytes -= copy_size;
-      }
-
-      int crypto_output_length = 0;
-      if (leftover_size == 0) {
-        crypto_output_length = m_data_cryptor->update_context(
-              ctx, in_buf_ptr, out_buf_ptr, m_block_size);
+        if (leftover_size < m_block_size) {
+          continue;
+        }
 
-        in_buf_ptr += m_block_size;
-        remaining_buf_bytes -= m_block_size;
-      } else if (leftover_size == m_block_size) {
-        crypto_output_length = m_data_cryptor->update_context(
-              ctx, leftover_block, out_buf_ptr, m_block_size);
+        r = crypt_blocks(leftover_block, 1);
         leftover_size = 0;
+      } else {
+        // all whole blocks of the buffer are handed over in one call
+        uint32_t block_count = remaining_buf_bytes / m_block_size;
+        r = crypt_blocks(in_buf_ptr, block_count);
+        in_buf_ptr += block_count * m_block_size;
+        remaining_buf_bytes -= block_count * m_block_size;
       }
 
-      if (crypto_output_length < 0) {
-        lderr(m_cct) << "crypt update failed" << dendl;
-        return crypto_output_length;
+      if (r < 0) {
+        lderr(m_cct) << "crypt failed: " << cpp_strerror(r) << dendl;
+        return r;
       }
-
-      out_buf_ptr += crypto_output_length;
     }
   }
 
@@ -47,7 +47,6 @@ private:
     DataCryptor<T>* m_data_cryptor;
     uint64_t m_block_size;
     uint64_t m_data_offset;
-    uint32_t m_iv_size;
 
     int crypt(ceph::bufferlist* data, uint64_t image_offset, CipherMode mode);
 };
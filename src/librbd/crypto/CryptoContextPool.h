@@ -7,6 +7,7 @@
 #include "librbd/crypto/DataCryptor.h"
 #include "include/ceph_assert.h"
 #include <boost/lockfree/queue.hpp>
+#include <openssl/evp.h>
 
 namespace librbd {
 namespace crypto {
@@ -15,7 +16,8 @@ template <typename T>
 class CryptoContextPool : public DataCryptor<T>  {
 
 public:
-    CryptoContextPool(DataCryptor<T>* data_cryptor, uint32_t pool_size);
+    CryptoContextPool(DataCryptor<T>* data_cryptor, uint32_t pool_size,
+                      bool owns_data_cryptor = false);
     ~CryptoContextPool();
 
     T* get_context(CipherMode mode) override;
@@ -42,11 +44,19 @@ public:
                               uint32_t len) const override {
       return m_data_cryptor->update_context(ctx, in, out, len);
     }
+    inline int crypt_blocks(T* ctx, const unsigned char* in,
+                            unsigned char* out, uint32_t block_size,
+                            uint32_t block_count,
+                            uint64_t sector_number) const override {
+      return m_data_cryptor->crypt_blocks(ctx, in, out, block_size,
+                                          block_count, sector_number);
+    }
 
     using ContextQueue = boost::lockfree::queue<T*>;
 
 private:
     DataCryptor<T>* m_data_cryptor;
+    bool m_owns_data_cryptor;
     ContextQueue m_encrypt_contexts;
     ContextQueue m_decrypt_contexts;
 
@@ -65,4 +75,6 @@ private:
 } // namespace crypto
 } // namespace librbd
 
+extern template class librbd::crypto::CryptoContextPool<EVP_CIPHER_CTX>;
+
 #endif // CEPH_LIBRBD_CRYPTO_CRYPTO_CONTEXT_POOL_H
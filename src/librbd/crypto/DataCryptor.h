@@ -4,8 +4,11 @@
 #ifndef CEPH_LIBRBD_CRYPTO_DATA_CRYPTOR_H
 #define CEPH_LIBRBD_CRYPTO_DATA_CRYPTOR_H
 
+#include "include/byteorder.h"
 #include "include/int_types.h"
 #include "librbd/crypto/Types.h"
+#include <string.h>
+#include <vector>
 
 namespace librbd {
 namespace crypto {
@@ -29,6 +32,38 @@ public:
                            uint32_t iv_length) const = 0;
   virtual int update_context(T* ctx, const unsigned char* in,
                              unsigned char* out, uint32_t len) const = 0;
+
+  /**
+   * Encrypts or decrypts block_count contiguous blocks of block_size bytes.
+   * The IV of each block is the little-endian number of its first 512-byte
+   * sector (starting at sector_number), zero padded to the IV size.
+   *
+   * Returns the number of output bytes or a negative error code.
+   */
+  virtual int crypt_blocks(T* ctx, const unsigned char* in,
+                           unsigned char* out, uint32_t block_size,
+                           uint32_t block_count,
+                           uint64_t sector_number) const {
+    std::vector<unsigned char> iv(get_iv_size());
+    int out_length = 0;
+    for (uint32_t i = 0; i < block_count; ++i) {
+      auto sector_le = ceph_le64(sector_number);
+      memcpy(iv.data(), &sector_le, sizeof(sector_le));
+      auto r = init_context(ctx, iv.data(), iv.size());
+      if (r != 0) {
+        return r;
+      }
+      r = update_context(ctx, in, out, block_size);
+      if (r < 0) {
+        return r;
+      }
+      in += block_size;
+      out += r;
+      out_length += r;
+      sector_number += block_size / 512;
+    }
+    return out_length;
+  }
 };
 
 } // namespace crypto
@@ -7,6 +7,7 @@
 #include "common/errno.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/crypto/BlockCrypto.h"
+#include "librbd/crypto/CryptoContextPool.h"
 #include "librbd/crypto/CryptoInterface.h"
 #include "librbd/crypto/CryptoObjectDispatch.h"
 #include "librbd/crypto/EncryptionFormat.h"
@@ -22,6 +23,14 @@ namespace librbd {
 namespace crypto {
 namespace util {
 
+namespace {
+
+// initial number of cipher contexts kept per direction, the pool grows
+// with the number of concurrent requests
+const uint32_t CONTEXT_POOL_SIZE = 32;
+
+} // anonymous namespace
+
 template <typename I>
 void set_crypto(I *image_ctx,
                 decltype(I::encryption_format) encryption_format) {
@@ -62,8 +71,11 @@ int build_crypto(
     return r;
   }
 
+  // reuse cipher contexts (and their expanded keys) across requests
+  auto context_pool = new CryptoContextPool<EVP_CIPHER_CTX>(
+          data_cryptor, CONTEXT_POOL_SIZE, true);
   result_crypto->reset(BlockCrypto<EVP_CIPHER_CTX>::create(
-          cct, data_cryptor, block_size, data_offset));
+          cct, context_pool, block_size, data_offset));
   return 0;
 }
 
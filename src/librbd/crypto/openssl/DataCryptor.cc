@@ -137,6 +137,39 @@ int DataCryptor::update_context(EVP_CIPHER_CTX* ctx, const unsigned char* in,
   return out_length;
 }
 
+int DataCryptor::crypt_blocks(EVP_CIPHER_CTX* ctx, const unsigned char* in,
+                              unsigned char* out, uint32_t block_size,
+                              uint32_t block_count,
+                              uint64_t sector_number) const {
+  // stays in one tight loop over the blocks: only the sector part of the
+  // IV (the XTS tweak) is rewritten between two blocks
+  unsigned char iv[EVP_MAX_IV_LENGTH] = {};
+  ceph_assert(m_iv_size >= sizeof(ceph_le64) &&
+              m_iv_size <= EVP_MAX_IV_LENGTH);
+  uint64_t sectors_per_block = block_size / 512;
+  int total_length = 0;
+  for (uint32_t i = 0; i < block_count; ++i) {
+    auto sector_le = ceph_le64(sector_number);
+    memcpy(iv, &sector_le, sizeof(sector_le));
+    if (1 != EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, iv, -1)) {
+      lderr(m_cct) << "EVP_CipherInit_ex failed" << dendl;
+      log_errors();
+      return -EIO;
+    }
+    int out_length;
+    if (1 != EVP_CipherUpdate(ctx, out, &out_length, in, block_size)) {
+      lderr(m_cct) << "EVP_CipherUpdate failed. len=" << block_size << dendl;
+      log_errors();
+      return -EIO;
+    }
+    in += block_size;
+    out += out_length;
+    total_length += out_length;
+    sector_number += sectors_per_block;
+  }
+  return total_length;
+}
+
 void DataCryptor::log_errors() const {
   while (true) {
     auto error = ERR_get_error();
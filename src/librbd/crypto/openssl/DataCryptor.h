@@ -31,6 +31,10 @@ public:
                      uint32_t iv_length) const override;
     int update_context(EVP_CIPHER_CTX* ctx, const unsigned char* in,
                        unsigned char* out, uint32_t len) const override;
+    int crypt_blocks(EVP_CIPHER_CTX* ctx, const unsigned char* in,
+                     unsigned char* out, uint32_t block_size,
+                     uint32_t block_count,
+                     uint64_t sector_number) const override;
 
 private:
     CephContext* m_cct;
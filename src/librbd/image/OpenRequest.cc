@@ -14,6 +14,8 @@
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/RefreshRequest.h"
 #include "librbd/image/SetSnapRequest.h"
+#include "librbd/io/ImageDispatcherInterface.h"
+#include "librbd/io/ReadaheadImageDispatch.h"
 #include "librbd/io/SimpleSchedulerObjectDispatch.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include "include/ceph_assert.h"
@@ -559,12 +561,25 @@ Context* OpenRequest<I>::handle_init_plugin_registry(int *result) {
 
 template <typename I>
 Context *OpenRequest<I>::send_init_cache(int *result) {
-  if (!m_image_ctx->cache || m_image_ctx->child != nullptr ||
-      !m_image_ctx->data_ctx.is_valid()) {
+  if (m_image_ctx->child != nullptr || !m_image_ctx->data_ctx.is_valid()) {
     return send_register_watch(result);
   }
 
   CephContext *cct = m_image_ctx->cct;
+  if (!m_image_ctx->cache) {
+    // without the object cacher cache, readahead is handled by an
+    // image dispatch layer with its own (small) buffer
+    auto buffer_bytes = m_image_ctx->config.template get_val<Option::size_t>(
+      "rbd_readahead_buffer_bytes");
+    if (buffer_bytes > 0) {
+      ldout(cct, 10) << this << " " << __func__ << ": "
+                     << "readahead_buffer_bytes=" << buffer_bytes << dendl;
+      auto readahead = io::ReadaheadImageDispatch<I>::create(m_image_ctx);
+      m_image_ctx->io_image_dispatcher->register_dispatch(readahead);
+    }
+    return send_register_watch(result);
+  }
+
   ldout(cct, 10) << this << " " << __func__ << dendl;
 
   size_t max_dirty = m_image_ctx->config.template get_val<Option::size_t>(
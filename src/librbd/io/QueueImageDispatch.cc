@@ -144,7 +144,7 @@ bool QueueImageDispatch<I>::enqueue(
   }
 
   *dispatch_result = DISPATCH_RESULT_CONTINUE;
-  m_image_ctx->asio_engine->post(on_dispatched, 0);
+  m_image_ctx->asio_engine->post_local(on_dispatched, 0);
   return true;
 }
 
@@ -0,0 +1,559 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/io/ReadaheadImageDispatch.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "include/neorados/RADOS.hpp"
+#include "include/rados/librados.hpp"
+#include "librbd/ImageCtx.h"
+#include "librbd/Types.h"
+#include "librbd/Utils.h"
+#include "librbd/asio/ContextWQ.h"
+#include "librbd/io/AioCompletion.h"
+#include "librbd/io/ImageDispatchSpec.h"
+
+#include <shared_mutex> // for std::shared_lock
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::io::ReadaheadImageDispatch: " << this \
+                           << " " << __func__ << ": "
+
+namespace librbd {
+namespace io {
+
+namespace {
+
+// smallest window a sequential stream is allowed to shrink to
+const uint64_t MIN_WINDOW = 128 * 1024;
+
+bool overlaps(uint64_t offset1, uint64_t length1,
+              uint64_t offset2, uint64_t length2) {
+  return offset1 < offset2 + length2 && offset2 < offset1 + length1;
+}
+
+} // anonymous namespace
+
+template <typename I>
+ReadaheadImageDispatch<I>::ReadaheadImageDispatch(I* image_ctx)
+  : m_image_ctx(image_ctx),
+    m_max_buffer_bytes(image_ctx->config.template get_val<Option::size_t>(
+      "rbd_readahead_buffer_bytes")),
+    m_max_streams(image_ctx->config.template get_val<uint64_t>(
+      "rbd_readahead_max_streams")),
+    m_trigger_requests(image_ctx->config.template get_val<uint64_t>(
+      "rbd_readahead_trigger_requests")),
+    m_lock(ceph::make_mutex(
+      util::unique_lock_name("librbd::io::ReadaheadImageDispatch::m_lock",
+                             this))) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << "ictx=" << image_ctx << ", "
+                << "max_buffer_bytes=" << m_max_buffer_bytes << ", "
+                << "max_streams=" << m_max_streams << dendl;
+}
+
+template <typename I>
+void ReadaheadImageDispatch<I>::shut_down(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  // wait for in-flight prefetches (and any reads waiting on them)
+  m_async_op_tracker.wait_for_ops(new LambdaContext(
+    [this, on_finish](int r) {
+      {
+        std::lock_guard locker{m_lock};
+        m_buffers.clear();
+        m_buffer_bytes = 0;
+        m_streams.clear();
+      }
+      on_finish->complete(0);
+    }));
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::read(
+    AioCompletion* aio_comp, Extents &&image_extents, ReadResult &&read_result,
+    IOContext io_context, int op_flags, int read_flags,
+    const ZTracer::Trace &parent_trace, uint64_t tid,
+    std::atomic<uint32_t>* image_dispatch_flags,
+    DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  if (*image_dispatch_flags & IMAGE_DISPATCH_FLAG_CRYPTO_HEADER) {
+    return false;
+  }
+
+  // only plain single-extent reads are tracked and served
+  if (image_extents.size() != 1 || image_extents.front().second == 0 ||
+      read_flags != 0) {
+    return false;
+  }
+
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "tid=" << tid << ", image_extents=" << image_extents
+                 << dendl;
+
+  auto [offset, length] = image_extents.front();
+  uint64_t snap_id = io_context->get_read_snap();
+
+  bool prefetch_allowed = (m_image_ctx->readahead_max_bytes > 0 &&
+                           (op_flags & LIBRADOS_OP_FLAG_FADVISE_RANDOM) == 0);
+  uint64_t area_size = 0;
+  if (prefetch_allowed) {
+    std::shared_lock image_locker{m_image_ctx->image_lock};
+    area_size = m_image_ctx->get_area_size(ImageArea::DATA);
+  }
+
+  bool hit = false;
+  bool waiting = false;
+  bufferlist bl;
+  Prefetch* prefetch = nullptr;
+  {
+    std::lock_guard locker{m_lock};
+    m_total_bytes_read += length;
+    auto disable_after_bytes = m_image_ctx->readahead_disable_after_bytes;
+    if (disable_after_bytes != 0 && m_total_bytes_read > disable_after_bytes) {
+      prefetch_allowed = false;
+    }
+
+    auto stream = update_stream(snap_id, offset, length);
+
+    if (read_buffer(snap_id, offset, length, &bl)) {
+      ldout(cct, 20) << "tid=" << tid << ": read from buffer" << dendl;
+      hit = true;
+    } else if (auto in_flight = get_prefetch(snap_id, offset, length);
+               in_flight != nullptr) {
+      ldout(cct, 20) << "tid=" << tid << ": waiting on prefetch "
+                     << in_flight->offset << "~" << in_flight->length
+                     << dendl;
+      *dispatch_result = DISPATCH_RESULT_CONTINUE;
+      in_flight->waiting_reads.push_back(
+        {aio_comp, image_extents, &read_result, dispatch_result,
+         on_dispatched});
+      waiting = true;
+    }
+
+    if (prefetch_allowed &&
+        stream->sequential_requests >= m_trigger_requests) {
+      prefetch = prepare_prefetch(stream, length, area_size);
+    }
+  }
+
+  if (prefetch != nullptr) {
+    send_prefetch(prefetch, io_context);
+  }
+
+  if (hit) {
+    *dispatch_result = DISPATCH_RESULT_COMPLETE;
+    complete_read(aio_comp, std::move(image_extents), std::move(read_result),
+                  std::move(bl));
+    return true;
+  }
+  return waiting;
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::write(
+    AioCompletion* aio_comp, Extents &&image_extents, bufferlist &&bl,
+    int op_flags, const ZTracer::Trace &parent_trace,
+    uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+    DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "tid=" << tid << dendl;
+
+  return handle_write(tid, image_extents, on_finish);
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::discard(
+    AioCompletion* aio_comp, Extents &&image_extents,
+    uint32_t discard_granularity_bytes, const ZTracer::Trace &parent_trace,
+    uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+    DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "tid=" << tid << dendl;
+
+  return handle_write(tid, image_extents, on_finish);
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::write_same(
+    AioCompletion* aio_comp, Extents &&image_extents, bufferlist &&bl,
+    int op_flags, const ZTracer::Trace &parent_trace,
+    uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+    DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "tid=" << tid << dendl;
+
+  return handle_write(tid, image_extents, on_finish);
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::compare_and_write(
+    AioCompletion* aio_comp, Extents &&image_extents,
+    bufferlist &&cmp_bl, bufferlist &&bl, uint64_t *mismatch_offset,
+    int op_flags, const ZTracer::Trace &parent_trace,
+    uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+    DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "tid=" << tid << dendl;
+
+  return handle_write(tid, image_extents, on_finish);
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::invalidate_cache(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  std::lock_guard locker{m_lock};
+  m_buffers.clear();
+  m_buffer_bytes = 0;
+  for (auto prefetch : m_prefetches) {
+    prefetch->stale = true;
+  }
+  m_streams.clear();
+  return false;
+}
+
+template <typename I>
+typename ReadaheadImageDispatch<I>::Stream*
+ReadaheadImageDispatch<I>::update_stream(uint64_t snap_id, uint64_t offset,
+                                         uint64_t length) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  for (auto it = m_streams.begin(); it != m_streams.end(); ++it) {
+    if (it->snap_id == snap_id && it->next_offset == offset) {
+      ++it->sequential_requests;
+      it->next_offset = offset + length;
+      m_streams.splice(m_streams.begin(), m_streams, it);
+      return &m_streams.front();
+    }
+  }
+
+  // replace the least recently used stream
+  if (m_streams.size() >= m_max_streams) {
+    m_streams.pop_back();
+  }
+  m_streams.emplace_front(++m_next_stream_id, snap_id, offset + length);
+  return &m_streams.front();
+}
+
+template <typename I>
+typename ReadaheadImageDispatch<I>::Stream*
+ReadaheadImageDispatch<I>::get_stream(uint64_t stream_id) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  for (auto& stream : m_streams) {
+    if (stream.id == stream_id) {
+      return &stream;
+    }
+  }
+  return nullptr;
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::read_buffer(uint64_t snap_id, uint64_t offset,
+                                            uint64_t length, bufferlist* bl) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  for (auto it = m_buffers.begin(); it != m_buffers.end(); ++it) {
+    if (it->snap_id != snap_id || offset < it->offset ||
+        offset + length > it->offset + it->bl.length()) {
+      continue;
+    }
+
+    bl->substr_of(it->bl, offset - it->offset, length);
+    m_image_ctx->perfcounter->inc(l_librbd_readahead_used_bytes, length);
+
+    // the stream has moved past everything up to the end of this read
+    uint64_t consumed = offset + length - it->offset;
+    m_buffer_bytes -= consumed;
+    if (consumed == it->bl.length()) {
+      auto stream = get_stream(it->stream_id);
+      if (stream != nullptr) {
+        stream->window = std::min(
+          stream->window * 2,
+          std::min(m_image_ctx->readahead_max_bytes, m_max_buffer_bytes));
+      }
+      m_buffers.erase(it);
+    } else {
+      bufferlist remaining;
+      remaining.substr_of(it->bl, consumed, it->bl.length() - consumed);
+      it->bl = std::move(remaining);
+      it->offset = offset + length;
+    }
+    return true;
+  }
+  return false;
+}
+
+template <typename I>
+typename ReadaheadImageDispatch<I>::Prefetch*
+ReadaheadImageDispatch<I>::get_prefetch(uint64_t snap_id, uint64_t offset,
+                                        uint64_t length) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  for (auto prefetch : m_prefetches) {
+    if (!prefetch->stale && prefetch->snap_id == snap_id &&
+        offset >= prefetch->offset &&
+        offset + length <= prefetch->offset + prefetch->length) {
+      return prefetch;
+    }
+  }
+  return nullptr;
+}
+
+template <typename I>
+typename ReadaheadImageDispatch<I>::Prefetch*
+ReadaheadImageDispatch<I>::prepare_prefetch(Stream* stream,
+                                            uint64_t request_length,
+                                            uint64_t area_size) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  uint64_t max_window = std::min(m_image_ctx->readahead_max_bytes,
+                                 m_max_buffer_bytes);
+  if (stream->window == 0) {
+    stream->window = std::max(MIN_WINDOW, 2 * request_length);
+  }
+  stream->window = std::min(stream->window, max_window);
+  if (stream->window < request_length) {
+    // the window could never hold a whole request
+    return nullptr;
+  }
+
+  // top up the window once less than half of it is left ahead of the stream
+  uint64_t start = std::max(stream->next_offset, stream->prefetch_end);
+  uint64_t end = std::min(stream->next_offset + stream->window, area_size);
+  if (start >= end || start - stream->next_offset > stream->window / 2) {
+    return nullptr;
+  }
+
+  uint64_t length = end - start;
+  if (write_in_flight(start, length)) {
+    return nullptr;
+  }
+
+  while (m_buffer_bytes + m_prefetch_bytes + length > m_max_buffer_bytes) {
+    if (!evict_buffer(stream->id)) {
+      return nullptr;
+    }
+  }
+
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "stream=" << stream->id << ", "
+                 << "window=" << stream->window << ", "
+                 << "prefetch=" << start << "~" << length << dendl;
+
+  stream->prefetch_end = end;
+  auto prefetch = new Prefetch(stream->id, stream->snap_id, start, length);
+  m_prefetches.push_back(prefetch);
+  m_prefetch_bytes += length;
+  m_async_op_tracker.start_op();
+  return prefetch;
+}
+
+template <typename I>
+void ReadaheadImageDispatch<I>::send_prefetch(Prefetch* prefetch,
+                                              IOContext io_context) {
+  uint64_t offset = prefetch->offset;
+  uint64_t length = prefetch->length;
+
+  Context* ctx = new LambdaContext([this, prefetch](int r) {
+      handle_prefetch(r, prefetch);
+    });
+  auto aio_comp = AioCompletion::create_and_start(
+    ctx, util::get_image_ctx(m_image_ctx), AIO_TYPE_READ);
+  auto req = ImageDispatchSpec::create_read(
+    *m_image_ctx, IMAGE_DISPATCH_LAYER_READAHEAD, aio_comp,
+    {{offset, length}}, ImageArea::DATA, ReadResult{&prefetch->bl},
+    io_context, 0, 0, {});
+  req->send();
+
+  m_image_ctx->perfcounter->inc(l_librbd_readahead);
+  m_image_ctx->perfcounter->inc(l_librbd_readahead_bytes, length);
+}
+
+template <typename I>
+void ReadaheadImageDispatch<I>::handle_prefetch(int r, Prefetch* prefetch) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << "r=" << r << ", "
+                 << "prefetch=" << prefetch->offset << "~" << prefetch->length
+                 << dendl;
+
+  std::list<std::pair<WaitingRead, bufferlist>> hits;
+  std::list<WaitingRead> misses;
+  {
+    std::lock_guard locker{m_lock};
+    m_prefetches.remove(prefetch);
+    m_prefetch_bytes -= prefetch->length;
+
+    if (r >= 0 && !prefetch->stale &&
+        prefetch->bl.length() == prefetch->length) {
+      m_buffers.push_back({prefetch->stream_id, prefetch->snap_id,
+                           prefetch->offset, std::move(prefetch->bl)});
+      m_buffer_bytes += prefetch->length;
+    } else {
+      if (r < 0) {
+        lderr(cct) << "failed to prefetch " << prefetch->offset << "~"
+                   << prefetch->length << ": " << cpp_strerror(r) << dendl;
+      }
+      auto stream = get_stream(prefetch->stream_id);
+      if (stream != nullptr) {
+        stream->prefetch_end = std::min(stream->prefetch_end,
+                                        prefetch->offset);
+      }
+    }
+
+    for (auto& waiting_read : prefetch->waiting_reads) {
+      auto& image_extent = waiting_read.image_extents.front();
+      bufferlist bl;
+      if (read_buffer(prefetch->snap_id, image_extent.first,
+                      image_extent.second, &bl)) {
+        hits.emplace_back(std::move(waiting_read), std::move(bl));
+      } else {
+        misses.push_back(std::move(waiting_read));
+      }
+    }
+  }
+
+  for (auto& [waiting_read, bl] : hits) {
+    *waiting_read.dispatch_result = DISPATCH_RESULT_COMPLETE;
+    complete_read(waiting_read.aio_comp,
+                  std::move(waiting_read.image_extents),
+                  std::move(*waiting_read.read_result), std::move(bl));
+  }
+
+  // send the remaining reads down to the lower layers
+  for (auto& waiting_read : misses) {
+    waiting_read.on_dispatched->complete(0);
+  }
+
+  delete prefetch;
+  m_async_op_tracker.finish_op();
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::evict_buffer(uint64_t keep_stream_id) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  for (auto it = m_buffers.begin(); it != m_buffers.end(); ++it) {
+    if (it->stream_id == keep_stream_id) {
+      continue;
+    }
+
+    // the data was prefetched too far ahead of its stream (or the stream
+    // is gone) -- shrink the window
+    auto stream = get_stream(it->stream_id);
+    if (stream != nullptr) {
+      stream->window = std::max(stream->window / 2, MIN_WINDOW);
+      stream->prefetch_end = std::min(stream->prefetch_end, it->offset);
+    }
+
+    m_buffer_bytes -= it->bl.length();
+    m_buffers.erase(it);
+    return true;
+  }
+  return false;
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::write_in_flight(uint64_t offset,
+                                                uint64_t length) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  for (auto& [tid, image_extents] : m_in_flight_writes) {
+    for (auto& image_extent : image_extents) {
+      if (overlaps(offset, length, image_extent.first, image_extent.second)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+template <typename I>
+void ReadaheadImageDispatch<I>::invalidate(const Extents& image_extents) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  // only the HEAD revision can change
+  for (auto& [offset, length] : image_extents) {
+    if (length == 0) {
+      continue;
+    }
+
+    for (auto it = m_buffers.begin(); it != m_buffers.end(); ) {
+      if (it->snap_id != CEPH_NOSNAP ||
+          !overlaps(offset, length, it->offset, it->bl.length())) {
+        ++it;
+        continue;
+      }
+
+      auto stream = get_stream(it->stream_id);
+      if (stream != nullptr) {
+        stream->prefetch_end = std::min(stream->prefetch_end, it->offset);
+      }
+      m_buffer_bytes -= it->bl.length();
+      it = m_buffers.erase(it);
+    }
+
+    for (auto prefetch : m_prefetches) {
+      if (prefetch->snap_id == CEPH_NOSNAP &&
+          overlaps(offset, length, prefetch->offset, prefetch->length)) {
+        prefetch->stale = true;
+      }
+    }
+  }
+}
+
+template <typename I>
+bool ReadaheadImageDispatch<I>::handle_write(uint64_t tid,
+                                             const Extents& image_extents,
+                                             Context** on_finish) {
+  {
+    std::lock_guard locker{m_lock};
+    invalidate(image_extents);
+    m_in_flight_writes[tid] = image_extents;
+  }
+
+  *on_finish = new LambdaContext([this, tid, on_finish=*on_finish](int r) {
+      handle_write_finished(tid);
+      on_finish->complete(r);
+    });
+  return false;
+}
+
+template <typename I>
+void ReadaheadImageDispatch<I>::handle_write_finished(uint64_t tid) {
+  std::lock_guard locker{m_lock};
+  m_in_flight_writes.erase(tid);
+}
+
+template <typename I>
+void ReadaheadImageDispatch<I>::complete_read(
+    AioCompletion* aio_comp, Extents&& image_extents, ReadResult&& read_result,
+    bufferlist&& bl) {
+  m_image_ctx->perfcounter->inc(l_librbd_rd);
+  m_image_ctx->perfcounter->inc(l_librbd_rd_bytes, bl.length());
+
+  aio_comp->read_result = std::move(read_result);
+  aio_comp->read_result.set_image_extents(image_extents);
+  aio_comp->set_request_count(1);
+  if (!aio_comp->async_op.started()) {
+    aio_comp->start_op();
+  }
+
+  auto req_comp = new ReadResult::C_ImageReadRequest(aio_comp, 0,
+                                                     image_extents);
+  req_comp->bl = std::move(bl);
+  m_image_ctx->op_work_queue->queue(req_comp, 0);
+}
+
+} // namespace io
+} // namespace librbd
+
+template class librbd::io::ReadaheadImageDispatch<librbd::ImageCtx>;
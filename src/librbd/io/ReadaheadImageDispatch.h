@@ -0,0 +1,202 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_IO_READAHEAD_IMAGE_DISPATCH_H
+#define CEPH_LIBRBD_IO_READAHEAD_IMAGE_DISPATCH_H
+
+#include "librbd/io/ImageDispatchInterface.h"
+#include "include/int_types.h"
+#include "include/buffer.h"
+#include "common/AsyncOpTracker.h"
+#include "common/ceph_mutex.h"
+#include "common/zipkin_trace.h"
+#include "librbd/io/ReadResult.h"
+#include "librbd/io/Types.h"
+
+#include <list>
+#include <map>
+
+struct Context;
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace io {
+
+struct AioCompletion;
+
+/**
+ * Read-ahead for images that are opened without a cache.
+ *
+ * Sequential read streams are detected per snapshot (several streams may
+ * be interleaved) and, once a stream has issued enough sequential
+ * requests, data ahead of it is prefetched through the lower dispatch
+ * layers into a small buffer.  Reads that are fully contained within a
+ * prefetched (or still in-flight) extent are completed from that buffer.
+ * The window of a stream doubles whenever its prefetched data is consumed
+ * and halves whenever it has to be dropped unread.
+ *
+ * Writes invalidate any overlapping prefetched data, and no data is
+ * prefetched over in-flight writes.
+ */
+template <typename ImageCtxT>
+class ReadaheadImageDispatch : public ImageDispatchInterface {
+public:
+  static ReadaheadImageDispatch* create(ImageCtxT* image_ctx) {
+    return new ReadaheadImageDispatch(image_ctx);
+  }
+
+  ReadaheadImageDispatch(ImageCtxT* image_ctx);
+
+  ImageDispatchLayer get_dispatch_layer() const override {
+    return IMAGE_DISPATCH_LAYER_READAHEAD;
+  }
+
+  void shut_down(Context* on_finish) override;
+
+  bool read(
+      AioCompletion* aio_comp, Extents &&image_extents,
+      ReadResult &&read_result, IOContext io_context, int op_flags,
+      int read_flags, const ZTracer::Trace &parent_trace, uint64_t tid,
+      std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+  bool write(
+      AioCompletion* aio_comp, Extents &&image_extents, bufferlist &&bl,
+      int op_flags, const ZTracer::Trace &parent_trace,
+      uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+  bool discard(
+      AioCompletion* aio_comp, Extents &&image_extents,
+      uint32_t discard_granularity_bytes, const ZTracer::Trace &parent_trace,
+      uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+  bool write_same(
+      AioCompletion* aio_comp, Extents &&image_extents, bufferlist &&bl,
+      int op_flags, const ZTracer::Trace &parent_trace,
+      uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+  bool compare_and_write(
+      AioCompletion* aio_comp, Extents &&image_extents,
+      bufferlist &&cmp_bl, bufferlist &&bl, uint64_t *mismatch_offset,
+      int op_flags, const ZTracer::Trace &parent_trace,
+      uint64_t tid, std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+  bool flush(
+      AioCompletion* aio_comp, FlushSource flush_source,
+      const ZTracer::Trace &parent_trace, uint64_t tid,
+      std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override {
+    return false;
+  }
+
+  bool list_snaps(
+      AioCompletion* aio_comp, Extents&& image_extents, SnapIds&& snap_ids,
+      int list_snaps_flags, SnapshotDelta* snapshot_delta,
+      const ZTracer::Trace &parent_trace, uint64_t tid,
+      std::atomic<uint32_t>* image_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override {
+    return false;
+  }
+
+  bool invalidate_cache(Context* on_finish) override;
+
+private:
+  struct Stream {
+    uint64_t id;
+    uint64_t snap_id;
+    uint64_t next_offset;
+    uint64_t sequential_requests = 1;
+    uint64_t window = 0;
+    uint64_t prefetch_end = 0;
+
+    Stream(uint64_t id, uint64_t snap_id, uint64_t next_offset)
+      : id(id), snap_id(snap_id), next_offset(next_offset) {
+    }
+  };
+
+  struct WaitingRead {
+    AioCompletion* aio_comp;
+    Extents image_extents;
+    ReadResult* read_result;
+    DispatchResult* dispatch_result;
+    Context* on_dispatched;
+  };
+
+  struct Prefetch {
+    uint64_t stream_id;
+    uint64_t snap_id;
+    uint64_t offset;
+    uint64_t length;
+    bufferlist bl;
+    bool stale = false;
+    std::list<WaitingRead> waiting_reads;
+
+    Prefetch(uint64_t stream_id, uint64_t snap_id, uint64_t offset,
+             uint64_t length)
+      : stream_id(stream_id), snap_id(snap_id), offset(offset),
+        length(length) {
+    }
+  };
+
+  struct Buffer {
+    uint64_t stream_id;
+    uint64_t snap_id;
+    uint64_t offset;
+    bufferlist bl;
+  };
+
+  ImageCtxT* m_image_ctx;
+
+  uint64_t m_max_buffer_bytes;
+  uint64_t m_max_streams;
+  uint64_t m_trigger_requests;
+
+  AsyncOpTracker m_async_op_tracker;
+
+  ceph::mutex m_lock;
+  uint64_t m_next_stream_id = 0;
+  std::list<Stream> m_streams;            // most recently used first
+  std::list<Prefetch*> m_prefetches;
+  std::list<Buffer> m_buffers;            // oldest first
+  uint64_t m_prefetch_bytes = 0;
+  uint64_t m_buffer_bytes = 0;
+  uint64_t m_total_bytes_read = 0;
+  std::map<uint64_t, Extents> m_in_flight_writes;
+
+  Stream* update_stream(uint64_t snap_id, uint64_t offset, uint64_t length);
+  Stream* get_stream(uint64_t stream_id);
+
+  bool read_buffer(uint64_t snap_id, uint64_t offset, uint64_t length,
+                   bufferlist* bl);
+  Prefetch* get_prefetch(uint64_t snap_id, uint64_t offset, uint64_t length);
+
+  Prefetch* prepare_prefetch(Stream* stream, uint64_t request_length,
+                             uint64_t area_size);
+  void send_prefetch(Prefetch* prefetch, IOContext io_context);
+  void handle_prefetch(int r, Prefetch* prefetch);
+  bool evict_buffer(uint64_t keep_stream_id);
+
+  bool write_in_flight(uint64_t offset, uint64_t length);
+  void invalidate(const Extents& image_extents);
+  bool handle_write(uint64_t tid, const Extents& image_extents,
+                    Context** on_finish);
+  void handle_write_finished(uint64_t tid);
+
+  void complete_read(AioCompletion* aio_comp, Extents&& image_extents,
+                     ReadResult&& read_result, bufferlist&& bl);
+};
+
+} // namespace io
+} // namespace librbd
+
+extern template class librbd::io::ReadaheadImageDispatch<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_IO_READAHEAD_IMAGE_DISPATCH_H
@@ -0,0 +1,183 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/object_map/BatchUpdateRequest.h"
+#include "include/rbd/object_map_types.h"
+#include "include/stringify.h"
+#include "common/dout.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/ObjectMap.h"
+#include "librbd/Utils.h"
+#include "cls/lock/cls_lock_client.h"
+
+#include <algorithm>
+#include <shared_mutex> // for std::shared_lock
+#include <string>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::object_map::BatchUpdateRequest: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace object_map {
+
+namespace {
+
+// object_map_update reads, updates and writes back whole 4K bit_vector
+// blocks, and its reads do not see the writes of earlier calls within the
+// same operation
+const uint64_t OBJECTS_PER_BLOCK = 4096 * 4;
+
+}
+
+template <typename I>
+BatchUpdateRequest<I>::BatchUpdateRequest(
+    ImageCtx &image_ctx, ceph::shared_mutex* object_map_lock,
+    ceph::BitVector<2> *object_map, Ranges&& ranges, uint8_t new_state,
+    const boost::optional<uint8_t> &current_state,
+    const ZTracer::Trace &parent_trace, bool ignore_enoent,
+    Context *on_finish)
+  : Request(image_ctx, CEPH_NOSNAP, on_finish),
+    m_object_map_lock(object_map_lock), m_object_map(*object_map),
+    m_new_state(new_state), m_current_state(current_state),
+    m_trace(util::create_trace(image_ctx, "batch update object map",
+                               parent_trace)),
+    m_ignore_enoent(ignore_enoent) {
+  m_trace.event("start");
+
+  std::sort(ranges.begin(), ranges.end());
+  Ranges merged_ranges;
+  for (auto& range : ranges) {
+    ceph_assert(range.first < range.second);
+    if (!merged_ranges.empty() && merged_ranges.back().second == range.first) {
+      merged_ranges.back().second = range.second;
+    } else {
+      ceph_assert(merged_ranges.empty() ||
+                  merged_ranges.back().second < range.first);
+      merged_ranges.push_back(range);
+    }
+  }
+
+  // put each range into the first operation that does not touch its
+  // first block yet; ranges are sorted, so that is the first operation
+  // whose last block is below it
+  std::vector<uint64_t> last_blocks;
+  for (auto& range : merged_ranges) {
+    uint64_t first_block = range.first / OBJECTS_PER_BLOCK;
+    size_t i = 0;
+    while (i < last_blocks.size() && last_blocks[i] >= first_block) {
+      ++i;
+    }
+    if (i == last_blocks.size()) {
+      last_blocks.emplace_back();
+      m_op_ranges.emplace_back();
+    }
+    last_blocks[i] = (range.second - 1) / OBJECTS_PER_BLOCK;
+    m_op_ranges[i].push_back(range);
+  }
+}
+
+template <typename I>
+void BatchUpdateRequest<I>::send() {
+  update_object_map();
+}
+
+template <typename I>
+void BatchUpdateRequest<I>::update_object_map() {
+  ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
+  ceph_assert(ceph_mutex_is_locked(*m_object_map_lock));
+  CephContext *cct = m_image_ctx.cct;
+
+  std::string oid(ObjectMap<>::object_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 20) << "ictx=" << &m_image_ctx << ", oid=" << oid << ", "
+                 << m_op_ranges.size() << " ops = "
+		 << (m_current_state ?
+		       stringify(static_cast<uint32_t>(*m_current_state)) : "")
+		 << "->" << static_cast<uint32_t>(m_new_state)
+		 << dendl;
+
+  // the operations touch disjoint blocks, so they may all be in flight
+  m_pending_ops = m_op_ranges.size();
+  for (size_t i = 0; i < m_op_ranges.size(); ++i) {
+    librados::ObjectWriteOperation op;
+    rados::cls::lock::assert_locked(&op, RBD_LOCK_NAME, ClsLockType::EXCLUSIVE,
+                                    "", "");
+    for (auto& [start_object_no, end_object_no] : m_op_ranges[i]) {
+      cls_client::object_map_update(&op, start_object_no, end_object_no,
+                                    m_new_state, m_current_state);
+    }
+
+    auto rados_completion = librbd::util::create_rados_callback(
+      new LambdaContext([this, i](int r) {
+        handle_update_object_map(i, r);
+      }));
+    std::vector<librados::snap_t> snaps;
+    int r = m_image_ctx.md_ctx.aio_operate(
+      oid, rados_completion, &op, 0, snaps,
+      (m_trace.valid() ? m_trace.get_info() : nullptr));
+    ceph_assert(r == 0);
+    rados_completion->release();
+  }
+}
+
+template <typename I>
+void BatchUpdateRequest<I>::handle_update_object_map(size_t op_index, int r) {
+  ldout(m_image_ctx.cct, 20) << "op=" << op_index << ", r=" << r << dendl;
+
+  if (r == -ENOENT && m_ignore_enoent) {
+    r = 0;
+  }
+
+  {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    std::unique_lock object_map_locker{*m_object_map_lock};
+    if (r < 0 && m_ret_val == 0) {
+      m_ret_val = r;
+    }
+    update_in_memory_object_map(m_op_ranges[op_index]);
+
+    ceph_assert(m_pending_ops > 0);
+    if (--m_pending_ops > 0) {
+      return;
+    }
+  }
+
+  complete(m_ret_val);
+}
+
+template <typename I>
+void BatchUpdateRequest<I>::update_in_memory_object_map(const Ranges& ranges) {
+  ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
+  ceph_assert(ceph_mutex_is_locked(*m_object_map_lock));
+
+  // rebuilding the object map might update on-disk only
+  if (m_snap_id != m_image_ctx.snap_id) {
+    return;
+  }
+
+  ldout(m_image_ctx.cct, 20) << dendl;
+  for (auto& [start_object_no, end_object_no] : ranges) {
+    auto it = m_object_map.begin() +
+      std::min(start_object_no, m_object_map.size());
+    auto end_it = m_object_map.begin() +
+      std::min(end_object_no, m_object_map.size());
+    for (; it != end_it; ++it) {
+      auto state_ref = *it;
+      uint8_t state = state_ref;
+      if (!m_current_state || state == *m_current_state ||
+          (*m_current_state == OBJECT_EXISTS && state == OBJECT_EXISTS_CLEAN)) {
+        state_ref = m_new_state;
+      }
+    }
+  }
+}
+
+template <typename I>
+void BatchUpdateRequest<I>::finish_request() {
+}
+
+} // namespace object_map
+} // namespace librbd
+
+template class librbd::object_map::BatchUpdateRequest<librbd::ImageCtx>;
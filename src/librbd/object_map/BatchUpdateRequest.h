@@ -0,0 +1,102 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_OBJECT_MAP_BATCH_UPDATE_REQUEST_H
+#define CEPH_LIBRBD_OBJECT_MAP_BATCH_UPDATE_REQUEST_H
+
+#include "include/int_types.h"
+#include "librbd/object_map/Request.h"
+#include "common/bit_vector.hpp"
+#include "common/zipkin_trace.h"
+#include "librbd/Utils.h"
+#include <boost/optional.hpp>
+#include <utility>
+#include <vector>
+
+class Context;
+
+namespace librbd {
+
+class ImageCtx;
+
+namespace object_map {
+
+/**
+ * Applies the same state transition to a set of disjoint object ranges of
+ * the HEAD object map.  Adjacent ranges are merged, the rest become one
+ * object_map_update call each.  Calls are grouped into as few RADOS
+ * operations as possible such that no two calls of an operation touch the
+ * same bit_vector block, and the operations are sent concurrently.
+ */
+template <typename ImageCtxT = librbd::ImageCtx>
+class BatchUpdateRequest : public Request {
+public:
+  // [start_object_no, end_object_no)
+  typedef std::vector<std::pair<uint64_t, uint64_t>> Ranges;
+
+  static BatchUpdateRequest *create(ImageCtx &image_ctx,
+                                    ceph::shared_mutex* object_map_lock,
+                                    ceph::BitVector<2> *object_map,
+                                    Ranges&& ranges, uint8_t new_state,
+                                    const boost::optional<uint8_t> &current_state,
+                                    const ZTracer::Trace &parent_trace,
+                                    bool ignore_enoent, Context *on_finish) {
+    return new BatchUpdateRequest(image_ctx, object_map_lock, object_map,
+                                  std::move(ranges), new_state, current_state,
+                                  parent_trace, ignore_enoent, on_finish);
+  }
+
+  BatchUpdateRequest(ImageCtx &image_ctx, ceph::shared_mutex* object_map_lock,
+                     ceph::BitVector<2> *object_map, Ranges&& ranges,
+                     uint8_t new_state,
+                     const boost::optional<uint8_t> &current_state,
+                     const ZTracer::Trace &parent_trace, bool ignore_enoent,
+                     Context *on_finish);
+  virtual ~BatchUpdateRequest() {
+    m_trace.event("finish");
+  }
+
+  void send() override;
+
+protected:
+  void finish_request() override;
+
+private:
+  /**
+   * @verbatim
+   *
+   * <start>
+   *    |
+   *    v
+   * UPDATE_OBJECT_MAP (one op per group of ranges, in parallel)
+   *    |
+   *    v
+   * <finish>
+   *
+   * @endverbatim
+   */
+
+  ceph::shared_mutex* m_object_map_lock;
+  ceph::BitVector<2> &m_object_map;
+  // ranges of each operation, no two of them in the same block
+  std::vector<Ranges> m_op_ranges;
+  size_t m_pending_ops = 0;
+  int m_ret_val = 0;
+  uint8_t m_new_state;
+  boost::optional<uint8_t> m_current_state;
+  ZTracer::Trace m_trace;
+  bool m_ignore_enoent;
+
+  void update_object_map();
+  void handle_update_object_map(size_t op_index, int r);
+
+  void update_in_memory_object_map(const Ranges& ranges);
+
+};
+
+} // namespace object_map
+} // namespace librbd
+
+extern template class librbd::object_map::BatchUpdateRequest<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_OBJECT_MAP_BATCH_UPDATE_REQUEST_H
@@ -45,6 +45,7 @@ public:
   virtual std::size_t size() const = 0;
 
   time m_stamp;
+  uint64_t m_seq = 0; ///< set by Log::submit_entry()
   pthread_t m_thread;
   short m_prio, m_subsys;
   thread_name_t m_thread_name{};
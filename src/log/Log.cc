@@ -26,6 +26,8 @@
 #include <syslog.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <set>
 
@@ -40,6 +42,55 @@ namespace logging {
 
 static OnExitManager exit_callbacks;
 
+static std::atomic<uint64_t> next_log_id = 1;
+
+class Log::ThreadRing {
+public:
+  /// producer side; copies @e into the ring unless it is full
+  bool push(const Entry& e) {
+    const uint64_t t = m_tail.load(std::memory_order_relaxed);
+    if (t - m_head.load(std::memory_order_acquire) == m_slots.size()) {
+      return false;
+    }
+    // slots are allocated on first use and then reused, so a thread that
+    // never logs costs nothing and one that does keeps at most
+    // THREAD_RING_SIZE entries
+    auto& slot = m_slots[t % m_slots.size()];
+    if (slot) {
+      *slot = e;
+    } else {
+      slot = std::make_unique<ConcreteEntry>(e);
+    }
+    // seq_cst so that it is ordered before the m_flusher_waiting load
+    m_tail.store(t + 1, std::memory_order_seq_cst);
+    return true;
+  }
+
+  bool empty() const {
+    return m_head.load(std::memory_order_seq_cst) ==
+      m_tail.load(std::memory_order_seq_cst);
+  }
+
+  /// consumer side; the caller holds m_queue_mutex
+  template <typename F>
+  std::size_t drain(F&& f) {
+    uint64_t h = m_head.load(std::memory_order_relaxed);
+    const uint64_t t = m_tail.load(std::memory_order_acquire);
+    const std::size_t n = t - h;
+    for (; h != t; ++h) {
+      f(std::move(*m_slots[h % m_slots.size()]));
+    }
+    m_head.store(h, std::memory_order_release);
+    return n;
+  }
+
+private:
+  std::array<std::unique_ptr<ConcreteEntry>, THREAD_RING_SIZE> m_slots;
+  // keep the consumer and producer indices on separate cache lines
+  alignas(64) std::atomic<uint64_t> m_head = 0;
+  alignas(64) std::atomic<uint64_t> m_tail = 0;
+};
+
 static void log_on_exit(void *p)
 {
   Log *l = *(Log **)p;
@@ -50,6 +101,7 @@ static void log_on_exit(void *p)
 
 Log::Log(const SubsystemMap *s)
   : m_indirect_this(nullptr),
+    m_id(next_log_id++),
     m_subs(s),
     m_recent(DEFAULT_MAX_RECENT)
 {
@@ -248,18 +300,128 @@ void Log::stop_journald_logger()
   m_journald.reset();
 }
 
+Log::ThreadRing *Log::_get_thread_ring(bool create)
+{
+  // set once this thread's rings are destroyed; being trivially
+  // destructible itself, it can still be read by whatever logs from
+  // later thread_local or static destructors.
+  static thread_local bool rings_destroyed = false;
+  struct thread_rings_t {
+    // a thread normally logs to a single Log, so this stays tiny
+    std::vector<std::pair<uint64_t, std::shared_ptr<ThreadRing>>> v;
+    ~thread_rings_t() {
+      rings_destroyed = true;
+    }
+  };
+  static thread_local thread_rings_t rings;
+
+  if (unlikely(rings_destroyed)) {
+    return nullptr;
+  }
+  auto i = std::find_if(rings.v.begin(), rings.v.end(),
+			[this](const auto& r) { return r.first == m_id; });
+  if (i != rings.v.end()) {
+    return i->second.get();
+  }
+  if (!create) {
+    return nullptr;
+  }
+  auto ring = std::make_shared<ThreadRing>();
+  {
+    std::scoped_lock lock(m_queue_mutex);
+    m_rings.push_back(ring);
+  }
+  rings.v.emplace_back(m_id, ring);
+  return ring.get();
+}
+
+bool Log::_rings_pending() const
+{
+  return std::any_of(m_rings.begin(), m_rings.end(),
+		     [](const auto& ring) { return !ring->empty(); });
+}
+
+std::size_t Log::_drain_rings(EntryVector& q)
+{
+  std::size_t drained = 0;
+  for (auto i = m_rings.begin(); i != m_rings.end(); ) {
+    auto& ring = *i;
+    // the owning thread has exited; check this before draining, so that
+    // nothing it pushed last is left behind.
+    const bool orphaned = ring.use_count() == 1;
+    if (ring->drain([&q](ConcreteEntry&& e) { q.emplace_back(std::move(e)); })) {
+      ++drained;
+    }
+    if (orphaned) {
+      i = m_rings.erase(i);
+    } else {
+      ++i;
+    }
+  }
+  return drained;
+}
+
+void Log::_gather_new()
+{
+  std::size_t sources;
+  {
+    std::scoped_lock lock(m_queue_mutex);
+    m_queue_mutex_holder = pthread_self();
+    assert(m_flush.empty());
+    m_flush.swap(m_new);
+    sources = (m_flush.empty() ? 0 : 1) + _drain_rings(m_flush);
+    m_cond_loggers.notify_all();
+    m_queue_mutex_holder = 0;
+  }
+
+  // each source is already in submission order; interleave them.
+  if (sources > 1) {
+    std::sort(m_flush.begin(), m_flush.end(),
+	      [](const ConcreteEntry& a, const ConcreteEntry& b) {
+		return a.m_seq < b.m_seq;
+	      });
+  }
+}
+
 void Log::submit_entry(Entry&& e)
 {
+  if (unlikely(m_inject_segv))
+    *(volatile int *)(0) = 0xdead;
+
+  // the wall clock may step, so entries are ordered by this instead
+  e.m_seq = m_next_seq.fetch_add(1, std::memory_order_relaxed);
+
+  ThreadRing *ring = nullptr;
+  if (likely(is_started())) {
+    ring = _get_thread_ring(true);
+    if (likely(ring && ring->push(e))) {
+      // either the flusher sees our entry when it re-checks the rings
+      // after raising m_flusher_waiting, or we see the flag here.
+      if (m_flusher_waiting.load()) {
+	std::scoped_lock lock(m_queue_mutex);
+	m_cond_flusher.notify_all();
+      }
+      return;
+    }
+  } else {
+    ring = _get_thread_ring(false);
+  }
+
   std::unique_lock lock(m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
 
-  if (unlikely(m_inject_segv))
-    *(volatile int *)(0) = 0xdead;
+  if (ring) {
+    // the ring is full or the log is not running; move what it holds to
+    // m_new along with this entry.  We hold m_queue_mutex, so we may act
+    // as the consumer.
+    ring->drain([this](ConcreteEntry&& ce) { m_new.emplace_back(std::move(ce)); });
+  }
 
   // wait for flush to catch up
   while (is_started() &&
 	 m_new.size() > m_max_new) {
     if (m_stop) break; // force addition
+    m_cond_flusher.notify_all();
     m_cond_loggers.wait(lock);
   }
 
@@ -273,14 +435,7 @@ void Log::flush()
   std::scoped_lock lock1(m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
 
-  {
-    std::scoped_lock lock2(m_queue_mutex);
-    m_queue_mutex_holder = pthread_self();
-    assert(m_flush.empty());
-    m_flush.swap(m_new);
-    m_cond_loggers.notify_all();
-    m_queue_mutex_holder = 0;
-  }
+  _gather_new();
 
   _flush(m_flush, false);
   m_flush_mutex_holder = 0;
@@ -503,13 +658,7 @@ void Log::dump_recent()
   std::scoped_lock lock1(m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
 
-  {
-    std::scoped_lock lock2(m_queue_mutex);
-    m_queue_mutex_holder = pthread_self();
-    assert(m_flush.empty());
-    m_flush.swap(m_new);
-    m_queue_mutex_holder = 0;
-  }
+  _gather_new();
 
   _flush(m_flush, false);
 
@@ -584,7 +733,7 @@ void *Log::entry()
     std::unique_lock lock(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
     while (!m_stop) {
-      if (!m_new.empty()) {
+      if (!m_new.empty() || _rings_pending()) {
         m_queue_mutex_holder = 0;
         lock.unlock();
         flush();
@@ -593,7 +742,14 @@ void *Log::entry()
         continue;
       }
 
-      m_cond_flusher.wait(lock);
+      // announce that we are going to sleep, then look again: a logger
+      // that pushed before the announcement is caught by the re-check,
+      // one that pushes after it takes m_queue_mutex and wakes us.
+      m_flusher_waiting = true;
+      if (!_rings_pending()) {
+	m_cond_flusher.wait(lock);
+      }
+      m_flusher_waiting = false;
     }
     m_queue_mutex_holder = 0;
   }
@@ -6,6 +6,7 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <map>
 #include <memory>
@@ -93,12 +94,21 @@ private:
 
   using RecentThreadNames = std::map<pthread_t, std::pair<mono_time, boost::circular_buffer<std::string> > >;
 
+  /// single-producer/single-consumer ring of entries submitted by one
+  /// thread; the owning thread pushes without locking, and entries are
+  /// only ever drained with m_queue_mutex held.  A thread whose ring is
+  /// full queues to m_new, which is bounded by m_max_new.
+  class ThreadRing;
+  static constexpr std::size_t THREAD_RING_SIZE = 16;
+
   static const std::size_t DEFAULT_MAX_NEW = 100;
   static const std::size_t DEFAULT_MAX_RECENT = 10000;
   static constexpr std::size_t DEFAULT_MAX_THREAD_NAMES = 4;
 
   Log **m_indirect_this;
 
+  const uint64_t m_id; ///< distinguishes Log instances in thread-local state
+
   const SubsystemMap *m_subs;
 
   std::mutex m_queue_mutex;
@@ -113,6 +123,9 @@ private:
   EntryVector m_new;    ///< new entries
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
+  std::vector<std::shared_ptr<ThreadRing>> m_rings; ///< per-thread rings, protected by m_queue_mutex
+  std::atomic<bool> m_flusher_waiting = false; ///< flusher is (about to be) blocked on m_cond_flusher
+  std::atomic<uint64_t> m_next_seq = 0; ///< submission order across threads
 
   std::string m_log_file;
   int m_fd = -1;
@@ -144,6 +157,11 @@ private:
 
   void *entry() override;
 
+  ThreadRing *_get_thread_ring(bool create);
+  bool _rings_pending() const;
+  std::size_t _drain_rings(EntryVector& q);
+  void _gather_new();
+
   void _log_safe_write(std::string_view sv);
   void _flush_logbuf();
   void _log_message(std::string_view s, bool crash);
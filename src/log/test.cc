@@ -14,6 +14,10 @@
 
 #include <limits.h>
 
+#include <atomic>
+#include <map>
+#include <thread>
+
 using namespace std;
 using namespace ceph::logging;
 
@@ -465,6 +469,127 @@ TEST(Log, Speed_nogather)
   }
 }
 
+namespace {
+// records what would have been written, per submitting thread
+class CapturingLog : public Log {
+public:
+  using Log::Log;
+  std::map<pthread_t, std::vector<int>> seen;
+protected:
+  void _flush(EntryVector& q, bool crash) override {
+    for (auto& e : q) {
+      seen[e.m_thread].push_back(std::stoi(std::string(e.strv())));
+    }
+    q.clear();
+  }
+};
+}
+
+TEST(Log, ConcurrentSubmitOrder)
+{
+  SubsystemMap subs;
+  CapturingLog log(&subs);
+  log.start();
+
+  constexpr int num_threads = 8;
+  constexpr int per_thread = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&log] {
+      for (int i = 0; i < per_thread; ++i) {
+        MutableEntry e(1, 0);
+        e.get_ostream() << i;
+        log.submit_entry(std::move(e));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  log.flush();
+  log.stop();
+
+  ASSERT_EQ(num_threads, (int)log.seen.size());
+  for (auto& [tid, v] : log.seen) {
+    ASSERT_EQ(per_thread, (int)v.size());
+    for (int i = 0; i < per_thread; ++i) {
+      ASSERT_EQ(i, v[i]);
+    }
+  }
+}
+
+TEST(Log, SetMaxNewKeepsOrder)
+{
+  SubsystemMap subs;
+  CapturingLog log(&subs);
+  log.set_max_new(1);
+  log.start();
+
+  // with a small log_max_new the thread keeps overflowing its ring into
+  // the shared queue, while the limit changes under it
+  constexpr int per_thread = 10000;
+  std::thread t([&log] {
+    for (int i = 0; i < per_thread; ++i) {
+      if (i % 1000 == 0) {
+        log.set_max_new(1 << (i / 1000 % 6));
+      }
+      MutableEntry e(1, 0);
+      e.get_ostream() << i;
+      log.submit_entry(std::move(e));
+    }
+  });
+  t.join();
+  log.flush();
+  log.stop();
+
+  ASSERT_EQ(1u, log.seen.size());
+  auto& v = log.seen.begin()->second;
+  ASSERT_EQ(per_thread, (int)v.size());
+  for (int i = 0; i < per_thread; ++i) {
+    ASSERT_EQ(i, v[i]);
+  }
+}
+
+// entries/sec accepted by submit_entry as the number of logging threads
+// grows; run with --gtest_also_run_disabled_tests.
+TEST(Log, DISABLED_SubmitScaling)
+{
+  SubsystemMap subs;
+  Log log(&subs);
+  log.start();
+  log.set_log_file("/dev/null");
+  log.reopen_log_file();
+
+  constexpr int per_thread = 200000;
+  for (int num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    std::atomic<bool> go = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&] {
+        while (!go) {
+          std::this_thread::yield();
+        }
+        for (int i = 0; i < per_thread; ++i) {
+          MutableEntry e(1, 0);
+          e.get_ostream() << "Iteration " << i;
+          log.submit_entry(std::move(e));
+        }
+      });
+    }
+    auto start = ceph::mono_clock::now();
+    go = true;
+    for (auto& t : threads) {
+      t.join();
+    }
+    log.flush();
+    double secs = std::chrono::duration<double>(ceph::mono_clock::now() - start).count();
+    std::cout << num_threads << " threads: "
+              << (uint64_t)(num_threads * per_thread / secs) << " entries/sec"
+              << std::endl;
+  }
+  log.stop();
+}
+
 TEST(Log, GarbleRecovery)
 {
   static const char* test_file="log_for_moment";
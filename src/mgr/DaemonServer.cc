@@ -1188,7 +1188,7 @@ bool DaemonServer::_handle_command(
     } else {
       format = cmd_getval_or<string>(cmdctx->cmdmap, "format", "plain");
     }
-    f.reset(Formatter::create(format));
+    f.reset(Formatter::create_chunked(format));
   }
 
   // this is just for mgr commands - admin socket commands will fall
@@ -384,10 +384,13 @@ void MgrClient::_send_report()
         session->declared.insert(path);
       }
 
-      encode(static_cast<uint64_t>(data.u64), report->packed);
       if (data.type & PERFCOUNTER_LONGRUNAVG) {
-        encode(static_cast<uint64_t>(data.avgcount), report->packed);
-        encode(static_cast<uint64_t>(data.avgcount2), report->packed);
+        auto [sum, count] = data.read_avg();
+        encode(sum, report->packed);
+        encode(count, report->packed);
+        encode(count, report->packed);
+      } else {
+        encode(data.read_u64(), report->packed);
       }
     }
     ENCODE_FINISH(report->packed);
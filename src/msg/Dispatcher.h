@@ -109,6 +109,33 @@ public:
    */
   virtual void ms_fast_preprocess(Message *m) {}
 
+  /**
+   * Supply the buffer that the data segment of an incoming message is
+   * received into, before it is read off the socket. This lets a Dispatcher
+   * place the payload in memory laid out the way its consumer wants (e.g.
+   * page-aligned for O_DIRECT, or from a specific mempool) and avoid a later
+   * copy. It is only consulted on fast-dispatch capable Dispatchers, and only
+   * when the messenger can receive the data segment verbatim (e.g. not in
+   * secure or compressed mode); the same locking constraints as
+   * ms_fast_preprocess apply.
+   *
+   * The message header has not been integrity checked at this point, so
+   * @a type and @a data_off may only be used as hints.
+   *
+   * @param con The Connection the message is arriving on.
+   * @param type The message type (from the message header).
+   * @param data_off The data offset hint (from the message header).
+   * @param len The length of the data segment.
+   * @param bp [out] A buffer of exactly @a len bytes.
+   * @returns True if @a bp was filled in; false to let the messenger
+   * allocate the buffer itself.
+   */
+  virtual bool ms_get_rx_data_buffer(Connection *con, int type,
+				     uint64_t data_off, uint32_t len,
+				     ceph::buffer::ptr *bp) {
+    return false;
+  }
+
   /* ms_fast_preprocess2 because otherwise the child must define both */
   virtual void ms_fast_preprocess2(const MessageRef &m) {
     /* allow old style dispatch handling that expects a Message* */
@@ -732,6 +732,22 @@ public:
       dispatcher->ms_fast_preprocess2(m);
     }
   }
+  /**
+   * Ask the fast dispatchers, in sequence, for a buffer to receive a
+   * message's data segment into. See Dispatcher::ms_get_rx_data_buffer.
+   *
+   * @returns True if a Dispatcher supplied @a bp.
+   */
+  bool ms_get_rx_data_buffer(Connection *con, int type, uint64_t data_off,
+			     uint32_t len, ceph::buffer::ptr *bp) {
+    for ([[maybe_unused]] const auto& [priority, dispatcher] : fast_dispatchers) {
+      if (dispatcher->ms_get_rx_data_buffer(con, type, data_off, len, bp)) {
+	ceph_assert(bp->length() == len);
+	return true;
+      }
+    }
+    return false;
+  }
   /**
    *  Deliver a single Message. Send it to each Dispatcher
    *  in sequence until one of them handles it.
@@ -420,6 +420,10 @@ void AsyncConnection::process() {
             opts.priority = SOCKET_PRIORITY_MIN_DELAY;
           }
       }
+      if (async_msgr->cct->_conf->ms_tcp_zerocopy) {
+        opts.zerocopy_min_size =
+          async_msgr->cct->_conf->ms_tcp_zerocopy_min_size;
+      }
       opts.connect_bind_addr = msgr->get_myaddrs().front();
       ssize_t r = worker->connect(target_addr, opts, &cs);
       if (r < 0) {
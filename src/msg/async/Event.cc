@@ -116,6 +116,7 @@ int EventCenter::init(int nevent, unsigned center_id, const std::string &type)
 
   this->type = type;
   this->center_id = center_id;
+  busy_poll_us = cct->_conf.get_val<uint64_t>("ms_async_busy_poll_us");
 
   if (type == "dpdk") {
 #ifdef HAVE_DPDK
@@ -302,6 +303,9 @@ void EventCenter::delete_file_event(int fd, int mask)
   }
 
   event->mask = event->mask & (~mask);
+  if (!event->mask) {
+    event->error_pending = false;
+  }
   ldout(cct, 30) << __func__ << " delete event end fd=" << fd << " mask=" << mask
                  << " current mask is " << event->mask << dendl;
 }
@@ -419,7 +423,25 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
 
   ldout(cct, 30) << __func__ << " wait second " << tv.tv_sec << " usec " << tv.tv_usec << dendl;
   std::vector<FiredFileEvent> fired_events;
-  numevents = driver->event_wait(fired_events, &tv);
+  numevents = 0;
+  if (blocking && busy_poll_us && timeout_microseconds &&
+      ceph::mono_clock::now() - last_active <
+        std::chrono::microseconds(busy_poll_us)) {
+    // We were busy a moment ago: more work is likely to arrive shortly, so
+    // spin rather than paying for a sleep and wakeup.
+    unsigned budget = std::min(busy_poll_us, timeout_microseconds);
+    numevents = busy_poll(fired_events, budget);
+    timeout_microseconds -= budget;
+    tv.tv_sec = timeout_microseconds / 1000000;
+    tv.tv_usec = timeout_microseconds % 1000000;
+  }
+  if (numevents == 0) {
+    auto wait_start = ceph::mono_clock::now();
+    numevents = driver->event_wait(fired_events, &tv);
+    if (blocking) {
+      sleep_time += ceph::mono_clock::now() - wait_start;
+    }
+  }
   auto working_start = ceph::mono_clock::now();
   for (int event_id = 0; event_id < numevents; event_id++) {
     int rfired = 0;
@@ -430,6 +452,9 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
     /* note the event->mask & mask & ... code: maybe an already processed
     * event removed an element that fired and we still didn't
     * processed, so we check if the event is still valid. */
+    if (event->mask && (fired_events[event_id].mask & EVENT_ERROR)) {
+      event->error_pending = true;
+    }
     if (event->mask & fired_events[event_id].mask & EVENT_READABLE) {
       rfired = 1;
       cb = event->read_cb;
@@ -470,11 +495,29 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
       numevents += pollers[i]->poll();
   }
 
+  if (numevents > 0)
+    last_active = ceph::mono_clock::now();
   if (working_dur)
     *working_dur = ceph::mono_clock::now() - working_start;
   return numevents;
 }
 
+int EventCenter::busy_poll(std::vector<FiredFileEvent> &fired_events,
+                           unsigned budget_us)
+{
+  struct timeval tv = {0, 0};
+  auto start = ceph::mono_clock::now();
+  auto deadline = start + std::chrono::microseconds(budget_us);
+  int numevents;
+  do {
+    numevents = driver->event_wait(fired_events, &tv);
+  } while (numevents == 0 && ceph::mono_clock::now() < deadline);
+  spin_time += ceph::mono_clock::now() - start;
+  ldout(cct, 30) << __func__ << " spun " << (ceph::mono_clock::now() - start)
+                 << " got " << numevents << dendl;
+  return numevents;
+}
+
 void EventCenter::dispatch_event_external(EventCallbackRef e)
 {
   uint64_t num = 0;
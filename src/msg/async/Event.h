@@ -52,6 +52,9 @@
 #define EVENT_NONE 0
 #define EVENT_READABLE 1
 #define EVENT_WRITABLE 2
+// reported along with EVENT_READABLE|EVENT_WRITABLE when the fd has a
+// pending error, see EventCenter::test_and_clear_error()
+#define EVENT_ERROR 4
 
 class EventCenter;
 
@@ -102,9 +105,10 @@ class EventCenter {
 
   struct FileEvent {
     int mask;
+    bool error_pending;
     EventCallbackRef read_cb;
     EventCallbackRef write_cb;
-    FileEvent(): mask(0), read_cb(NULL), write_cb(NULL) {}
+    FileEvent(): mask(0), error_pending(false), read_cb(NULL), write_cb(NULL) {}
   };
 
   struct TimeEvent {
@@ -175,8 +179,15 @@ class EventCenter {
   EventCallbackRef notify_handler;
   unsigned center_id;
   AssociatedCenters *global_centers = nullptr;
+  // adaptive polling: spin on non-blocking waits for up to busy_poll_us
+  // before blocking, as long as events arrived within the last busy_poll_us
+  unsigned busy_poll_us = 0;
+  ceph::mono_clock::time_point last_active;
+  ceph::timespan spin_time = ceph::timespan::zero();
+  ceph::timespan sleep_time = ceph::timespan::zero();
 
   int process_time_events();
+  int busy_poll(std::vector<FiredFileEvent> &fired_events, unsigned budget_us);
   FileEvent *_get_file_event(int fd) {
     ceph_assert(fd < nevent);
     return &file_events[fd];
@@ -204,8 +215,24 @@ class EventCenter {
   uint64_t create_time_event(uint64_t microseconds, EventCallbackRef ctxt);
   void delete_file_event(int fd, int mask);
   void delete_time_event(uint64_t id);
+  /// whether the driver reported an error on fd since the last call
+  bool test_and_clear_error(int fd) {
+    if (fd >= nevent) {
+      return false;
+    }
+    FileEvent *event = _get_file_event(fd);
+    bool pending = event->error_pending;
+    event->error_pending = false;
+    return pending;
+  }
   int process_events(unsigned timeout_microseconds, ceph::timespan *working_dur = nullptr);
   void wakeup();
+  /// time spent spinning and blocked waiting for events since the last call
+  void take_poll_times(ceph::timespan *spin, ceph::timespan *sleep) {
+    *spin = spin_time;
+    *sleep = sleep_time;
+    spin_time = sleep_time = ceph::timespan::zero();
+  }
 
   // Used by external thread
   void dispatch_event_external(EventCallbackRef e);
@@ -22,7 +22,13 @@
 
 #include <algorithm>
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 #include "PosixStack.h"
+#include "zerocopy_pins.h"
 
 #include "include/buffer.h"
 #include "include/str_list.h"
@@ -42,11 +48,54 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   int _fd;
   entity_addr_t sa;
   bool connected;
+  PerfCounters *logger;
+  uint64_t zerocopy_min_size;
+
+  EventCenter *center;
+
+#ifdef HAVE_MSG_ZEROCOPY
+  ceph::ZeroCopyPins zerocopy_pins;
+
+  // drain zerocopy completions from the socket error queue; this empties
+  // the queue so that EPOLLERR is only raised again for new completions
+  void reap_zerocopy() {
+    while (true) {
+      alignas(struct cmsghdr) char control[128];
+      struct msghdr msg;
+      // FIPS zeroization audit 20191115: this memset is not security related.
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+	return;
+      }
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+	   cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+	  continue;
+	}
+	auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+	  continue;
+	}
+	if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && logger) {
+	  logger->inc(l_msgr_send_zerocopy_copied);
+	}
+	zerocopy_pins.complete(serr->ee_info, serr->ee_data);
+      }
+    }
+  }
+#endif
 
  public:
   explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
-				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+				    int f, bool connected,
+				    PerfCounters *logger = nullptr,
+				    uint64_t zerocopy_min_size = 0,
+				    EventCenter *center = nullptr)
+      : handler(h), _fd(f), sa(sa), connected(connected),
+	logger(logger), zerocopy_min_size(zerocopy_min_size), center(center) {}
 
   int is_connected() override {
     if (connected)
@@ -64,6 +113,12 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    #ifdef HAVE_MSG_ZEROCOPY
+    // completions raise EPOLLERR, which wakes up the read handler
+    if (zerocopy_min_size && center && center->test_and_clear_error(_fd)) {
+      reap_zerocopy();
+    }
+    #endif
     #ifdef _WIN32
     ssize_t r = ::recv(_fd, buf, len, 0);
     #else
@@ -77,13 +132,18 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   // return the sent length
   // < 0 means error occurred
   #ifndef _WIN32
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  // zerocopy_calls counts the sendmsg() calls that succeeded with
+  // MSG_ZEROCOPY, each of which will produce a completion notification,
+  // and zerocopy_bytes the bytes they sent
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    int flags, uint32_t *zerocopy_calls,
+			    uint64_t *zerocopy_bytes)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | flags | (more ? MSG_MORE : 0));
       if (r < 0) {
         int err = ceph_sock_errno();
         if (err == EINTR) {
@@ -91,8 +151,21 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         } else if (err == EAGAIN) {
           break;
         }
+#ifdef HAVE_MSG_ZEROCOPY
+        if (err == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+          // out of optmem for notifications; fall back to copying
+          flags &= ~MSG_ZEROCOPY;
+          continue;
+        }
+#endif
         return -err;
       }
+#ifdef HAVE_MSG_ZEROCOPY
+      if (flags & MSG_ZEROCOPY) {
+        ++*zerocopy_calls;
+        *zerocopy_bytes += r;
+      }
+#endif
 
       sent += r;
       if (len == sent) break;
@@ -115,6 +188,8 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 
   ssize_t send(ceph::buffer::list &bl, bool more) override {
     size_t sent_bytes = 0;
+    uint32_t zerocopy_calls = 0;
+    uint64_t zerocopy_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
     while (left_pbrs) {
@@ -133,7 +208,21 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      int flags = 0;
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy_min_size && msglen >= zerocopy_min_size) {
+        flags |= MSG_ZEROCOPY;
+      }
+#endif
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, flags,
+                             &zerocopy_calls, &zerocopy_bytes);
+#ifdef HAVE_MSG_ZEROCOPY
+      if (r < 0 && zerocopy_calls) {
+        // the connection is going to fault, but the kernel may still be
+        // reading whatever it accepted
+        zerocopy_pins.pin(ceph::buffer::list(bl), zerocopy_calls);
+      }
+#endif
       if (r < 0)
         return r;
 
@@ -150,8 +239,17 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
         bl.swap(swapped);
       } else {
-        bl.clear();
+        swapped.swap(bl);
+      }
+      // "swapped" now holds exactly the bytes that were sent
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy_calls) {
+        zerocopy_pins.pin(std::move(swapped), zerocopy_calls);
       }
+#endif
+    }
+    if (zerocopy_bytes && logger) {
+      logger->inc(l_msgr_send_zerocopy_bytes, zerocopy_bytes);
     }
 
     return static_cast<ssize_t>(sent_bytes);
@@ -262,7 +360,14 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  uint64_t zerocopy_min_size = 0;
+  if (opt.zerocopy_min_size && handler.set_zerocopy(sd)) {
+    zerocopy_min_size = opt.zerocopy_min_size;
+  }
+
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(
+    handler, *out, sd, true, w ? w->perf_logger : nullptr, zerocopy_min_size,
+    w ? &w->center : nullptr));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -330,8 +435,16 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
   }
 
   net.set_priority(sd, opts.priority, addr.get_family());
+
+  uint64_t zerocopy_min_size = 0;
+  if (opts.zerocopy_min_size && net.set_zerocopy(sd)) {
+    zerocopy_min_size = opts.zerocopy_min_size;
+  }
+
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(
+        net, addr, sd, !opts.nonblock, perf_logger, zerocopy_min_size,
+        &center)));
   return 0;
 }
 
@@ -1224,6 +1224,10 @@ CtPtr ProtocolV2::read_frame_segment() {
   }
 
   rx_buffer_t rx_buffer;
+  if (get_rx_data_buffer(seg_idx, onwire_len, &rx_buffer)) {
+    return READ_RXBUF(std::move(rx_buffer), handle_read_frame_segment);
+  }
+
   uint16_t align = rx_frame_asm.get_segment_align(seg_idx);
   try {
     rx_buffer = ceph::buffer::ptr_node::create(ceph::buffer::create_aligned(
@@ -1240,6 +1244,35 @@ CtPtr ProtocolV2::read_frame_segment() {
   return READ_RXBUF(std::move(rx_buffer), handle_read_frame_segment);
 }
 
+bool ProtocolV2::get_rx_data_buffer(size_t seg_idx, uint32_t onwire_len,
+                                    rx_buffer_t *rx_buffer) {
+  // A dispatcher-supplied buffer is only usable if the data segment is
+  // received verbatim: in secure mode it is ciphertext and padded, and
+  // compressed segments are inflated into new buffers anyway.
+  if (next_tag != Tag::MESSAGE ||
+      seg_idx != SegmentIndex::Msg::DATA ||
+      session_stream_handlers.rx ||
+      rx_frame_asm.is_compressed()) {
+    return false;
+  }
+  auto& hdrbl = rx_segments_data[SegmentIndex::Msg::HEADER];
+  if (hdrbl.length() < sizeof(ceph_msg_header2)) {
+    return false;
+  }
+  const auto& header =
+    reinterpret_cast<const ceph_msg_header2&>(*hdrbl.c_str());
+
+  ceph::bufferptr bp;
+  if (!messenger->ms_get_rx_data_buffer(connection, header.type,
+                                        header.data_off, onwire_len, &bp)) {
+    return false;
+  }
+  ldout(cct, 20) << __func__ << " using dispatcher rx buffer len="
+                 << onwire_len << " type=" << header.type << dendl;
+  *rx_buffer = ceph::buffer::ptr_node::create(std::move(bp));
+  return true;
+}
+
 CtPtr ProtocolV2::handle_read_frame_segment(rx_buffer_t &&rx_buffer, int r) {
   ldout(cct, 20) << __func__ << " r=" << r << dendl;
 
@@ -53,6 +53,15 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+
+        ceph::timespan spin, sleep;
+        w->center.take_poll_times(&spin, &sleep);
+        if (spin != ceph::timespan::zero()) {
+          w->perf_logger->tinc(l_msgr_running_spin_time, spin);
+        }
+        if (sleep != ceph::timespan::zero()) {
+          w->perf_logger->tinc(l_msgr_running_sleep_time, sleep);
+        }
       }
       w->reset();
       w->destroy();
@@ -54,6 +54,8 @@ struct SocketOptions {
   bool nodelay = true;
   int rcbuf_size = 0;
   int priority = -1;
+  /// send buffers of at least this many bytes with MSG_ZEROCOPY (0 = never)
+  uint64_t zerocopy_min_size = 0;
   entity_addr_t connect_bind_addr;
 };
 
@@ -217,6 +219,8 @@ enum {
   l_msgr_running_send_time,
   l_msgr_running_recv_time,
   l_msgr_running_fast_dispatch_time,
+  l_msgr_running_spin_time,
+  l_msgr_running_sleep_time,
 
   l_msgr_send_messages_queue_lat,
   l_msgr_handle_ack_lat,
@@ -224,6 +228,9 @@ enum {
   l_msgr_recv_encrypted_bytes,
   l_msgr_send_encrypted_bytes,
 
+  l_msgr_send_zerocopy_bytes,
+  l_msgr_send_zerocopy_copied,
+
   l_msgr_last,
 };
 
@@ -275,6 +282,8 @@ class Worker {
     plb.add_time(l_msgr_running_send_time, "msgr_running_send_time", "The total time of message sending");
     plb.add_time(l_msgr_running_recv_time, "msgr_running_recv_time", "The total time of message receiving");
     plb.add_time(l_msgr_running_fast_dispatch_time, "msgr_running_fast_dispatch_time", "The total time of fast dispatch");
+    plb.add_time(l_msgr_running_spin_time, "msgr_running_spin_time", "The total time of busy polling for events");
+    plb.add_time(l_msgr_running_sleep_time, "msgr_running_sleep_time", "The total time of blocking waits for events");
 
     plb.add_time_avg(l_msgr_send_messages_queue_lat, "msgr_send_messages_queue_lat", "Network sent messages lat");
     plb.add_time_avg(l_msgr_handle_ack_lat, "msgr_handle_ack_lat", "Connection handle ack lat");
@@ -282,6 +291,9 @@ class Worker {
     plb.add_u64_counter(l_msgr_recv_encrypted_bytes, "msgr_recv_encrypted_bytes", "Network received encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_encrypted_bytes, "msgr_send_encrypted_bytes", "Network sent encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
 
+    plb.add_u64_counter(l_msgr_send_zerocopy_bytes, "msgr_send_zerocopy_bytes", "Network sent bytes using MSG_ZEROCOPY", NULL, 0, unit_t(UNIT_BYTES));
+    plb.add_u64_counter(l_msgr_send_zerocopy_copied, "msgr_send_zerocopy_copied", "MSG_ZEROCOPY sends the kernel completed by copying");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
 
@@ -21,6 +21,13 @@ static constexpr const std::size_t AESGCM_IV_LEN{12};
 static constexpr const std::size_t AESGCM_TAG_LEN{16};
 static constexpr const std::size_t AESGCM_BLOCK_LEN{16};
 
+// Plaintext fragments shorter than this are gathered into the output buffer
+// and encrypted in place as a single run. Frames built from many small
+// bufferptrs (encoded headers, omap payloads) otherwise pay the fixed cost of
+// an EVP_EncryptUpdate() call per fragment and never reach the stitched
+// AES-NI/VAES + GHASH code path, which only kicks in on longer inputs.
+static constexpr const std::size_t AESGCM_COALESCE_LEN{4096};
+
 struct nonce_t {
   ceph_le32 fixed;
   ceph_le64 counter;
@@ -46,6 +53,9 @@ class AES128GCM_OnWireTxHandler : public ceph::crypto::onwire::TxHandler {
   bool new_nonce_format;  // 64-bit counter?
   static_assert(sizeof(nonce) == AESGCM_IV_LEN);
 
+  void encrypt_update(unsigned char* out, const unsigned char* in,
+		      std::size_t len);
+
 public:
   AES128GCM_OnWireTxHandler(CephContext* const cct,
 			    const key_t& key,
@@ -111,26 +121,50 @@ void AES128GCM_OnWireTxHandler::reset_tx_handler(const uint32_t* first,
   }
 }
 
+void AES128GCM_OnWireTxHandler::encrypt_update(unsigned char* out,
+                                               const unsigned char* in,
+                                               std::size_t len)
+{
+  int update_len = 0;
+  if(1 != EVP_EncryptUpdate(ectx.get(), out, &update_len, in, len)) {
+    throw std::runtime_error("EVP_EncryptUpdate failed");
+  }
+  ceph_assert_always(update_len >= 0);
+  ceph_assert(static_cast<unsigned>(update_len) == len);
+}
+
 void AES128GCM_OnWireTxHandler::authenticated_encrypt_update(
   const ceph::bufferlist& plaintext)
 {
   ceph_assert(buffer.get_append_buffer_unused_tail_length() >=
               plaintext.length());
   auto filler = buffer.append_hole(plaintext.length());
+  auto out = reinterpret_cast<unsigned char*>(filler.c_str());
 
+  // bytes already copied to out but not yet encrypted
+  std::size_t gathered = 0;
   for (const auto& plainbuf : plaintext.buffers()) {
-    int update_len = 0;
-
-    if(1 != EVP_EncryptUpdate(ectx.get(),
-	reinterpret_cast<unsigned char*>(filler.c_str()),
-	&update_len,
-	reinterpret_cast<const unsigned char*>(plainbuf.c_str()),
-	plainbuf.length())) {
-      throw std::runtime_error("EVP_EncryptUpdate failed");
+    auto in = reinterpret_cast<const unsigned char*>(plainbuf.c_str());
+    if (plainbuf.length() < AESGCM_COALESCE_LEN) {
+      ::memcpy(out + gathered, in, plainbuf.length());
+      gathered += plainbuf.length();
+      if (gathered >= AESGCM_COALESCE_LEN) {
+	encrypt_update(out, out, gathered);
+	out += gathered;
+	gathered = 0;
+      }
+      continue;
     }
-    ceph_assert_always(update_len >= 0);
-    ceph_assert(static_cast<unsigned>(update_len) == plainbuf.length());
-    filler.advance(update_len);
+    if (gathered > 0) {
+      encrypt_update(out, out, gathered);
+      out += gathered;
+      gathered = 0;
+    }
+    encrypt_update(out, in, plainbuf.length());
+    out += plainbuf.length();
+  }
+  if (gathered > 0) {
+    encrypt_update(out, out, gathered);
   }
 
   ldout(cct, 15) << __func__
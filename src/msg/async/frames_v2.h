@@ -223,6 +223,10 @@ public:
     return m_descs[seg_idx].align;
   }
 
+  bool is_compressed() const { 
+    return m_flags & FRAME_EARLY_DATA_COMPRESSED; 
+  }
+
   // Preamble:
   //
   //   preamble_block_t
@@ -338,10 +342,6 @@ private:
     return m_crypto->rx->get_extra_size_at_final();
   }
 
-  bool is_compressed() const { 
-    return m_flags & FRAME_EARLY_DATA_COMPRESSED; 
-  }
-
   void asm_compress(bufferlist segment_bls[]);
 
   bufferlist asm_crc_rev0(const preamble_block_t& preamble,
@@ -126,6 +126,21 @@ int NetHandler::set_socket_options(int sd, bool nodelay, int size)
   return -r;
 }
 
+bool NetHandler::set_zerocopy(int sd)
+{
+#ifdef SO_ZEROCOPY
+  int on = 1;
+  if (::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, (SOCKOPT_VAL_TYPE)&on, sizeof(on)) < 0) {
+    int r = ceph_sock_errno();
+    ldout(cct, 1) << "couldn't set SO_ZEROCOPY: " << cpp_strerror(r) << dendl;
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
 void NetHandler::set_priority(int sd, int prio, int domain)
 {
 #ifdef SO_PRIORITY
@@ -40,6 +40,8 @@ namespace ceph {
     int reconnect(const entity_addr_t &addr, int sd);
     int nonblock_connect(const entity_addr_t &addr, const entity_addr_t& bind_addr);
     void set_priority(int sd, int priority, int domain);
+    /// enable MSG_ZEROCOPY sends; returns false if unsupported
+    bool set_zerocopy(int sd);
   };
 }
 
@@ -0,0 +1,76 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_ASYNC_ZEROCOPY_PINS_H
+#define CEPH_MSG_ASYNC_ZEROCOPY_PINS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+
+#include "include/buffer.h"
+
+namespace ceph {
+
+/*
+ * The kernel numbers each successful MSG_ZEROCOPY sendmsg() on a socket,
+ * starting from zero, and reports ranges of completed ids on the socket
+ * error queue.  Until then it may still be reading from our pages, so the
+ * buffers handed to those calls stay pinned here.
+ */
+class ZeroCopyPins {
+  struct pin_t {
+    uint32_t first;
+    uint32_t last;
+    uint32_t outstanding;
+    ceph::buffer::list bl;
+  };
+  uint32_t next_id;
+  std::deque<pin_t> pinned;
+
+ public:
+  explicit ZeroCopyPins(uint32_t first_id = 0) : next_id(first_id) {}
+
+  bool empty() const {
+    return pinned.empty();
+  }
+  size_t size() const {
+    return pinned.size();
+  }
+
+  /// keep bl until the next @calls zerocopy sends have completed
+  void pin(ceph::buffer::list &&bl, uint32_t calls) {
+    pinned.push_back({next_id, next_id + calls - 1, calls, std::move(bl)});
+    next_id += calls;
+  }
+
+  /// the sends numbered lo to hi (inclusive) have completed
+  void complete(uint32_t lo, uint32_t hi) {
+    // ids wrap at 2^32; work in offsets relative to lo
+    int64_t n = static_cast<uint32_t>(hi - lo);
+    for (auto &pin : pinned) {
+      int64_t a = static_cast<int32_t>(pin.first - lo);
+      int64_t b = static_cast<int32_t>(pin.last - lo);
+      int64_t overlap = std::min(b, n) - std::max(a, int64_t(0)) + 1;
+      if (overlap > 0) {
+	pin.outstanding -= std::min<uint32_t>(pin.outstanding, overlap);
+      }
+    }
+    while (!pinned.empty() && pinned.front().outstanding == 0) {
+      pinned.pop_front();
+    }
+  }
+};
+
+} // namespace ceph
+
+#endif
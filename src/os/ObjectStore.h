@@ -43,6 +43,10 @@ namespace ceph {
   class Formatter;
 }
 
+namespace PriorityCache {
+  struct PriCache;
+}
+
 /*
  * low-level interface to the local OSD file system
  */
@@ -287,6 +291,15 @@ public:
 
   virtual void set_cache_shards(unsigned num) { }
 
+  /**
+   * Let the store's memory autotuner size a cache owned by the caller
+   * alongside the store's own caches.  Stores without an autotuner ignore
+   * it; the cache must be unregistered before it is destroyed.
+   */
+  virtual void register_cache(const std::string& name,
+			      std::shared_ptr<PriorityCache::PriCache> cache) { }
+  virtual void unregister_cache(const std::string& name) { }
+
   /**
    * Returns 0 if the hobject is valid, -error otherwise
    *
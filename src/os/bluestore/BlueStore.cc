@@ -5432,6 +5432,9 @@ void *BlueStore::MempoolThread::entry()
     if (binned_kv_onode_cache != nullptr) {
       pcm->insert("kv_onode", binned_kv_onode_cache, true);
     }
+    for (auto& [name, cache] : external_caches) {
+      pcm->insert(name, cache, true);
+    }
   }
 
   utime_t next_balance = ceph_clock_now();
@@ -5495,6 +5498,8 @@ void *BlueStore::MempoolThread::entry()
       interval_stats_trim = true;
 
       if (pcm != nullptr) {
+        pcm->set_utility_step(
+          store->cct->_conf->bluestore_cache_autotune_utility_step);
         pcm->balance();
       }
 
@@ -5553,6 +5558,28 @@ void *BlueStore::MempoolThread::entry()
   return NULL;
 }
 
+void BlueStore::MempoolThread::register_cache(
+  const std::string& name,
+  std::shared_ptr<PriorityCache::PriCache> cache)
+{
+  std::lock_guard l{lock};
+  dout(10) << __func__ << " " << name << dendl;
+  ceph_assert(!external_caches.count(name));
+  external_caches.emplace(name, cache);
+  if (pcm != nullptr) {
+    pcm->insert(name, cache, true);
+  }
+}
+
+void BlueStore::MempoolThread::unregister_cache(const std::string& name)
+{
+  std::lock_guard l{lock};
+  dout(10) << __func__ << " " << name << dendl;
+  if (external_caches.erase(name) && pcm != nullptr) {
+    pcm->erase(name);
+  }
+}
+
 void BlueStore::MempoolThread::_resize_shards(bool interval_stats)
 {
   size_t onode_shards = store->onode_cache_shards.size();
@@ -6464,6 +6491,9 @@ void BlueStore::_init_logger()
     "amount of omap keys removed via rmkeys");
   b.add_u64_counter(l_bluestore_omap_rmkey_ranges_count, "omap_rmkey_range_count",
     "amount of omap key ranges removed via rmkeys");
+  b.add_u64_counter(l_bluestore_omap_clear_range_deletes,
+    "omap_clear_range_deletes",
+    "amount of omap clears done with a range tombstone");
 
   //****************************************
   // other client ops latencies
@@ -13669,7 +13699,9 @@ int BlueStore::_onode_omap_get(
     string head, tail;
     o->get_omap_header(&head);
     o->get_omap_tail(&tail);
-    KeyValueDB::Iterator it = db->get_iterator(prefix, 0, KeyValueDB::IteratorBounds{head, tail});
+    KeyValueDB::Iterator it = db->get_iterator(
+      prefix, KeyValueDB::ITERATOR_READAHEAD,
+      KeyValueDB::IteratorBounds{head, tail});
     it->lower_bound(head);
     while (it->valid()) {
       if (it->key() == head) {
@@ -13754,7 +13786,9 @@ int BlueStore::omap_get_keys(
     string head, tail;
     o->get_omap_key(string(), &head);
     o->get_omap_tail(&tail);
-    KeyValueDB::Iterator it = db->get_iterator(prefix, 0, KeyValueDB::IteratorBounds{head, tail});
+    KeyValueDB::Iterator it = db->get_iterator(
+      prefix, KeyValueDB::ITERATOR_READAHEAD,
+      KeyValueDB::IteratorBounds{head, tail});
     it->lower_bound(head);
     while (it->valid()) {
       if (it->key() >= tail) {
@@ -13809,14 +13843,23 @@ int BlueStore::omap_get_values(
     const string& prefix = o->get_omap_prefix();
     o->get_omap_key(string(), &final_key);
     size_t base_key_len = final_key.size();
-    for (set<string>::const_iterator p = keys.begin(); p != keys.end(); ++p) {
+    // the omap keys share the object's prefix, so the db keys sort in
+    // the same order as keys
+    set<string> db_keys;
+    for (auto& k : keys) {
       final_key.resize(base_key_len); // keep prefix
-      final_key += *p;
-      bufferlist val;
-      if (db->get(prefix, final_key, &val) >= 0) {
-	dout(30) << __func__ << "  got " << pretty_binary_string(final_key)
+      final_key += k;
+      db_keys.emplace_hint(db_keys.end(), final_key);
+    }
+    map<string, bufferlist> vals;
+    db->get(prefix, db_keys, &vals);
+    auto q = db_keys.begin();
+    for (auto p = keys.begin(); p != keys.end(); ++p, ++q) {
+      auto v = vals.find(*q);
+      if (v != vals.end()) {
+	dout(30) << __func__ << "  got " << pretty_binary_string(*q)
 		 << " -> " << *p << dendl;
-	out->insert(make_pair(*p, val));
+	out->emplace_hint(out->end(), *p, std::move(v->second));
       }
     }
   }
@@ -13859,16 +13902,22 @@ int BlueStore::omap_check_keys(
     const string& prefix = o->get_omap_prefix();
     o->get_omap_key(string(), &final_key);
     size_t base_key_len = final_key.size();
-    for (set<string>::const_iterator p = keys.begin(); p != keys.end(); ++p) {
+    set<string> db_keys;
+    for (auto& k : keys) {
       final_key.resize(base_key_len); // keep prefix
-      final_key += *p;
-      bufferlist val;
-      if (db->get(prefix, final_key, &val) >= 0) {
-	dout(30) << __func__ << "  have " << pretty_binary_string(final_key)
+      final_key += k;
+      db_keys.emplace_hint(db_keys.end(), final_key);
+    }
+    map<string, bufferlist> vals;
+    db->get(prefix, db_keys, &vals);
+    auto q = db_keys.begin();
+    for (auto p = keys.begin(); p != keys.end(); ++p, ++q) {
+      if (vals.count(*q)) {
+	dout(30) << __func__ << "  have " << pretty_binary_string(*q)
 		 << " -> " << *p << dendl;
 	out->insert(*p);
       } else {
-	dout(30) << __func__ << "  miss " << pretty_binary_string(final_key)
+	dout(30) << __func__ << "  miss " << pretty_binary_string(*q)
 		 << " -> " << *p << dendl;
       }
     }
@@ -13923,7 +13972,9 @@ int BlueStore::omap_iterate(
       o->get_omap_tail(&upper_bound);
       bounds.lower_bound = std::move(lower_bound);
       bounds.upper_bound = std::move(upper_bound);
-      it = db->get_iterator(o->get_omap_prefix(), 0, std::move(bounds));
+      it = db->get_iterator(o->get_omap_prefix(),
+                            KeyValueDB::ITERATOR_READAHEAD,
+                            std::move(bounds));
     }
   }
 
@@ -14627,6 +14678,9 @@ void BlueStore::_txc_committed_kv(TransContext *txc)
       finisher.queue(txc->oncommits);
     }
   }
+  for (auto& [prefix, start, end] : txc->omap_range_deletes) {
+    db->compact_range_async(prefix, start, end);
+  }
   throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_committing_lat);
   log_latency_fn(
     __func__,
@@ -18141,7 +18195,17 @@ void BlueStore::_do_omap_clear(TransContext *txc, OnodeRef& o)
   string prefix, tail;
   o->get_omap_header(&prefix);
   o->get_omap_tail(&tail);
-  txc->t->rm_range_keys(omap_prefix, prefix, tail);
+  uint64_t threshold = cct->_conf->bluestore_omap_clear_range_delete_threshold;
+  if (threshold == 0) {
+    txc->t->rm_range_keys(omap_prefix, prefix, tail);
+  } else if (txc->t->rm_range_keys_bulk(omap_prefix, prefix, tail,
+					threshold)) {
+    // the range belongs to this object alone, so a range tombstone can't
+    // hide anybody else's keys; have it compacted away once committed so
+    // that it doesn't slow down iterators crossing the range
+    logger->inc(l_bluestore_omap_clear_range_deletes);
+    txc->omap_range_deletes.emplace_back(omap_prefix, prefix, tail);
+  }
   txc->t->rmkey(omap_prefix, tail);
   o->onode.clear_omap_flag();
   dout(20) << __func__ << " remove range start: "
@@ -18398,7 +18462,9 @@ int BlueStore::_clone(TransContext *txc,
     string head, tail;
     oldo->get_omap_header(&head);
     oldo->get_omap_tail(&tail);
-    KeyValueDB::Iterator it = db->get_iterator(prefix, 0, KeyValueDB::IteratorBounds{head, tail});
+    KeyValueDB::Iterator it = db->get_iterator(
+      prefix, KeyValueDB::ITERATOR_READAHEAD,
+      KeyValueDB::IteratorBounds{head, tail});
     it->lower_bound(head);
     while (it->valid()) {
       if (it->key() >= tail) {
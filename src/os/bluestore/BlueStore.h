@@ -206,6 +206,7 @@ enum {
   l_bluestore_omap_setkeys_count,
   l_bluestore_omap_setkeys_records,
   l_bluestore_omap_setkeys_bytes,
+  l_bluestore_omap_clear_range_deletes,
   //****************************************
 
   // other client ops latencies
@@ -1938,6 +1939,8 @@ public:
     KeyValueDB::Transaction t; ///< then we will commit this
     std::list<Context*> oncommits;  ///< more commit completions
     std::list<CollectionRef> removed_collections; ///< colls we removed
+    /// omap ranges dropped with a range tombstone: (prefix, start, end)
+    std::list<std::tuple<std::string, std::string, std::string>> omap_range_deletes;
 
     boost::intrusive::list_member_hook<> deferred_queue_item;
     bluestore_deferred_transaction_t *deferred_txn = nullptr; ///< if any
@@ -2556,6 +2559,10 @@ private:
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_onode_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
+    // caches of the store's user balanced along with ours, see
+    // register_cache()
+    std::map<std::string, std::shared_ptr<PriorityCache::PriCache>>
+      external_caches;
 
     struct MempoolCache : public PriorityCache::PriCache {
       BlueStore *store;
@@ -2707,6 +2714,11 @@ private:
       virtual std::string get_cache_name() const {
         return "BlueStore Meta Cache";
       }
+      virtual bool get_hit_stats(uint64_t *hits, uint64_t *misses) const {
+        *hits = store->logger->get(l_bluestore_onode_hits);
+        *misses = store->logger->get(l_bluestore_onode_misses);
+        return true;
+      }
       uint64_t _get_num_onodes() const {
         uint64_t onode_num =
             mempool::bluestore_cache_onode::allocated_items();
@@ -2751,6 +2763,13 @@ private:
       virtual std::string get_cache_name() const {
         return "BlueStore Data Cache";
       }
+      virtual bool get_hit_stats(uint64_t *hits, uint64_t *misses) const {
+        // count a block read from the cache like an onode lookup
+        uint64_t block_size = std::max<uint64_t>(store->block_size, 1);
+        *hits = store->logger->get(l_bluestore_buffer_hit_bytes) / block_size;
+        *misses = store->logger->get(l_bluestore_buffer_miss_bytes) / block_size;
+        return true;
+      }
     };
     std::shared_ptr<DataCache> data_cache;
 
@@ -2772,6 +2791,9 @@ private:
       lock.unlock();
       join();
     }
+    void register_cache(const std::string& name,
+                        std::shared_ptr<PriorityCache::PriCache> cache);
+    void unregister_cache(const std::string& name);
 
   private:
     void _update_cache_settings();
@@ -3163,6 +3185,13 @@ public:
   }
 
   void set_cache_shards(unsigned num) override;
+  void register_cache(const std::string& name,
+		      std::shared_ptr<PriorityCache::PriCache> cache) override {
+    mempool_thread.register_cache(name, std::move(cache));
+  }
+  void unregister_cache(const std::string& name) override {
+    mempool_thread.unregister_cache(name);
+  }
   void dump_cache_stats(ceph::Formatter *f) override {
     int onode_count = 0, buffers_bytes = 0;
     for (auto i: onode_cache_shards) {
@@ -389,6 +389,9 @@ shared_ptr<shard_extent_map_t> ECExtentCache::LRU::find(
     cache = c;
     auto it = lru_iter; // Intentional copy.
     erase(it, false);
+    hits++;
+  } else {
+    misses++;
   }
   mutex.unlock();
   return cache;
@@ -410,9 +413,85 @@ void ECExtentCache::LRU::free_maybe() {
   while (max_size < size) {
     auto it = lru.begin();
     erase(it, true);
+    evictions++;
   }
 }
 
+void ECExtentCache::LRU::set_max_size(uint64_t new_max_size) {
+  mutex.lock();
+  max_size = new_max_size;
+  free_maybe();
+  mutex.unlock();
+}
+
+ECExtentCache::LRU::Stats ECExtentCache::LRU::get_stats() {
+  Stats stats;
+  mutex.lock();
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.evictions = evictions;
+  stats.size = size;
+  stats.max_size = max_size;
+  mutex.unlock();
+  return stats;
+}
+
+uint64_t ECExtentCache::LRUPriCache::get_used_bytes() const {
+  uint64_t used = 0;
+  for (auto lru : lrus) {
+    used += lru->get_stats().size;
+  }
+  return used;
+}
+
+int64_t ECExtentCache::LRUPriCache::request_cache_bytes(
+    PriorityCache::Priority pri, uint64_t total_cache) const {
+  uint64_t used = get_used_bytes();
+  uint64_t min_used = std::min<uint64_t>(used, min_bytes);
+  int64_t request;
+
+  switch (pri) {
+  case PriorityCache::Priority::PRI1:
+    request = min_used;
+    break;
+  case PriorityCache::Priority::LAST:
+    request = used - min_used;
+    break;
+  default:
+    return 0;
+  }
+  int64_t assigned = get_cache_bytes(pri);
+  return request > assigned ? request - assigned : 0;
+}
+
+int64_t ECExtentCache::LRUPriCache::get_cache_bytes() const {
+  int64_t total = 0;
+  for (int i = 0; i < PriorityCache::Priority::LAST + 1; i++) {
+    total += get_cache_bytes(static_cast<PriorityCache::Priority>(i));
+  }
+  return total;
+}
+
+int64_t ECExtentCache::LRUPriCache::commit_cache_size(uint64_t total_cache) {
+  committed_bytes = PriorityCache::get_chunk(get_cache_bytes(), total_cache);
+  for (auto lru : lrus) {
+    lru->set_max_size(committed_bytes / lrus.size());
+  }
+  return committed_bytes;
+}
+
+bool ECExtentCache::LRUPriCache::get_hit_stats(uint64_t *hits,
+                                               uint64_t *misses) const {
+  *hits = 0;
+  *misses = 0;
+  for (auto lru : lrus) {
+    auto stats = lru->get_stats();
+    *hits += stats.hits;
+    *misses += stats.misses;
+  }
+  return true;
+}
+
 void ECExtentCache::LRU::discard() {
   mutex.lock();
   lru.clear();
@@ -31,7 +31,12 @@
  * taken.
  *
  * The LRU has a maximum size (defined in the constructor) and will keep its
- * usage below this amount.
+ * usage below this amount. The maximum size may be changed at runtime with
+ * set_max_size(), which evicts immediately if the cache is now over budget.
+ * The LRU counts lookups that hit and missed, along with evictions, so that
+ * the OSD can report the effectiveness of the cache via its perf counters.
+ * LRUPriCache hands the LRUs of all OSD shards to the object store's memory
+ * autotuner, which then sets their maximum size.
  *
  * Cache Lines
  *
@@ -76,6 +81,7 @@
 #pragma once
 
 #include "ECUtil.h"
+#include "common/PriorityCache.h"
 #include "include/Context.h"
 
 class ECExtentCache {
@@ -131,6 +137,14 @@ class ECExtentCache {
       }
     };
 
+    struct Stats {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t evictions = 0;
+      uint64_t size = 0;
+      uint64_t max_size = 0;
+    };
+
    private:
     friend class Object;
     friend class ECExtentCache;
@@ -140,6 +154,9 @@ class ECExtentCache {
     std::list<Key> lru;
     uint64_t max_size = 0;
     uint64_t size = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
     ceph::mutex mutex = ceph::make_mutex("ECExtentCache::LRU");
 
     void free_maybe();
@@ -154,6 +171,66 @@ class ECExtentCache {
 
    public:
     explicit LRU(uint64_t max_size) : map(), max_size(max_size) {}
+
+    void set_max_size(uint64_t new_max_size);
+    Stats get_stats();
+  };
+
+  /* Presents the LRUs of all the OSD shards to the object store's memory
+   * autotuner as a single cache.  Up to min_bytes of cached data are
+   * requested at PRI1 and anything above that at LAST.  The committed size
+   * is split evenly between the LRUs.
+   */
+  class LRUPriCache : public PriorityCache::PriCache {
+    std::vector<LRU*> lrus;
+    std::atomic<uint64_t> min_bytes;
+    int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
+    int64_t committed_bytes = 0;
+    double cache_ratio = 0;
+
+    uint64_t get_used_bytes() const;
+
+   public:
+    LRUPriCache(std::vector<LRU*> lrus, uint64_t min_bytes)
+      : lrus(std::move(lrus)), min_bytes(min_bytes) {}
+
+    void set_min_bytes(uint64_t bytes) {
+      min_bytes = bytes;
+    }
+
+    int64_t request_cache_bytes(PriorityCache::Priority pri,
+                                uint64_t total_cache) const override;
+    int64_t get_cache_bytes(PriorityCache::Priority pri) const override {
+      return cache_bytes[pri];
+    }
+    int64_t get_cache_bytes() const override;
+    void set_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+      cache_bytes[pri] = bytes;
+    }
+    void add_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+      cache_bytes[pri] += bytes;
+    }
+    int64_t commit_cache_size(uint64_t total_cache) override;
+    int64_t get_committed_size() const override {
+      return committed_bytes;
+    }
+    double get_cache_ratio() const override {
+      return cache_ratio;
+    }
+    void set_cache_ratio(double ratio) override {
+      cache_ratio = ratio;
+    }
+    std::string get_cache_name() const override {
+      return "EC Extent Cache";
+    }
+    // The LRUs do not age their contents in bins.
+    void shift_bins() override {}
+    void import_bins(const std::vector<uint64_t> &bins) override {}
+    void set_bins(PriorityCache::Priority pri, uint64_t end_bin) override {}
+    uint64_t get_bins(PriorityCache::Priority pri) const override {
+      return 0;
+    }
+    bool get_hit_stats(uint64_t *hits, uint64_t *misses) const override;
   };
 
   class Op {
@@ -2485,6 +2485,10 @@ OSD::OSD(CephContext *cct_,
       op_queue_cut_off);
     shards.push_back(one_shard);
   }
+
+  rx_buffer_pool = AlignedBufferPool::create(
+    cct->_conf.get_val<Option::size_t>("osd_rx_buffer_pool_size"),
+    cct->_conf.get_val<Option::size_t>("osd_rx_buffer_pool_max_buffer"));
 }
 
 OSD::~OSD()
@@ -3791,6 +3795,17 @@ int OSD::init()
   dout(2) << "journal looks like " << (journal_is_rotational ? "hdd" : "ssd")
           << dendl;
 
+  {
+    std::vector<ECExtentCache::LRU*> lrus;
+    for (auto shard : shards) {
+      lrus.push_back(&shard->ec_extent_cache_lru);
+    }
+    ec_extent_pricache = std::make_shared<ECExtentCache::LRUPriCache>(
+      std::move(lrus),
+      cct->_conf.get_val<uint64_t>("ec_extent_cache_size") * shards.size());
+    store->register_cache("ec_extent", ec_extent_pricache);
+  }
+
   enable_disable_fuse(false);
 
   dout(2) << "boot" << dendl;
@@ -4155,6 +4170,7 @@ int OSD::init()
 
 out:
   enable_disable_fuse(true);
+  store->unregister_cache("ec_extent");
   store->umount();
   store.reset();
   return r;
@@ -4725,6 +4741,7 @@ int OSD::shutdown()
     service.fast_shutdown();
     std::lock_guard lock(osd_lock);
     // TBD: assert in allocator that nothing is being add
+    store->unregister_cache("ec_extent");
     store->umount();
 
     utime_t end_time = ceph_clock_now();
@@ -4882,6 +4899,7 @@ int OSD::shutdown()
   service.shutdown();
 
   std::lock_guard lock(osd_lock);
+  store->unregister_cache("ec_extent");
   store->umount();
   store.reset();
   dout(10) << "Store synced" << dendl;
@@ -6480,6 +6498,21 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc_adjusted, ceph::buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, ceph::buffer::get_missed_crc());
 
+  {
+    ECExtentCache::LRU::Stats total;
+    for (auto& shard : shards) {
+      auto stats = shard->ec_extent_cache_lru.get_stats();
+      total.hits += stats.hits;
+      total.misses += stats.misses;
+      total.evictions += stats.evictions;
+      total.size += stats.size;
+    }
+    logger->set(l_osd_ec_extent_cache_hit, total.hits);
+    logger->set(l_osd_ec_extent_cache_miss, total.misses);
+    logger->set(l_osd_ec_extent_cache_evict, total.evictions);
+    logger->set(l_osd_ec_extent_cache_bytes, total.size);
+  }
+
   // refresh osd stats
   struct store_statfs_t stbuf;
   osd_alert_list_t alerts;
@@ -7789,6 +7822,28 @@ void OSD::ms_fast_dispatch(Message *m)
   OID_EVENT_TRACE_WITH_MSG(m, "MS_FAST_DISPATCH_END", false);
 }
 
+bool OSD::ms_get_rx_data_buffer(Connection *con, int type, uint64_t data_off,
+				uint32_t len, ceph::buffer::ptr *bp)
+{
+  switch (type) {
+  case CEPH_MSG_OSD_OP:
+  case MSG_OSD_REPOP:
+    break;
+  default:
+    return false;
+  }
+  // Place each byte of the write payload at the same offset within its page
+  // as it will have within the object, so that the objectstore can submit
+  // it for direct I/O without rebuilding an aligned copy.
+  unsigned head = data_off & ~CEPH_PAGE_MASK;
+  try {
+    *bp = rx_buffer_pool->get(head, len);
+  } catch (const ceph::buffer::bad_alloc&) {
+    return false;
+  }
+  return true;
+}
+
 bool OSD::ms_handle_fast_authentication(Connection *con)
 {
   auto s = ceph::ref_cast<Session>(con->get_priv());
@@ -10094,7 +10149,9 @@ std::vector<std::string> OSD::get_tracked_keys() const noexcept
     "osd_scrub_interval_randomize_ratio"s,
     "osd_op_thread_timeout"s,
     "osd_op_thread_suicide_timeout"s,
-    "osd_max_scrubs"s
+    "osd_max_scrubs"s,
+    "ec_extent_cache_size"s,
+    "osd_rx_buffer_pool_size"s
   };
 }
 
@@ -10243,6 +10300,19 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("osd_op_thread_suicide_timeout")) {
     op_shardedwq.set_suicide_timeout(g_conf().get_val<int64_t>("osd_op_thread_suicide_timeout"));
   }
+  if (changed.count("ec_extent_cache_size")) {
+    uint64_t size = conf.get_val<uint64_t>("ec_extent_cache_size");
+    for (auto& shard : shards) {
+      shard->ec_extent_cache_lru.set_max_size(size);
+    }
+    if (ec_extent_pricache) {
+      ec_extent_pricache->set_min_bytes(size * shards.size());
+    }
+  }
+  if (changed.count("osd_rx_buffer_pool_size")) {
+    rx_buffer_pool->set_max_bytes(
+      conf.get_val<Option::size_t>("osd_rx_buffer_pool_size"));
+  }
 }
 
 void OSD::maybe_override_max_osd_capacity_for_qos()
@@ -19,6 +19,7 @@
 
 #include "msg/Dispatcher.h"
 
+#include "common/AlignedBufferPool.h"
 #include "common/admin_finisher.h"
 #include "common/async/context_pool.h"
 #include "common/Timer.h"
@@ -1100,6 +1101,10 @@ protected:
   PerfCounters      *logger;
   PerfCounters      *recoverystate_perf;
   std::unique_ptr<ObjectStore> store;
+  // the shards' EC extent cache LRUs as sized by the store's autotuner
+  std::shared_ptr<ECExtentCache::LRUPriCache> ec_extent_pricache;
+  // page aligned buffers for write payloads, see ms_get_rx_data_buffer()
+  std::shared_ptr<AlignedBufferPool> rx_buffer_pool;
 #ifdef HAVE_LIBFUSE
   FuseStore *fuse_store = nullptr;
 #endif
@@ -1977,6 +1982,8 @@ private:
     }
   }
   void ms_fast_dispatch(Message *m) override;
+  bool ms_get_rx_data_buffer(Connection *con, int type, uint64_t data_off,
+			     uint32_t len, ceph::buffer::ptr *bp) override;
   bool ms_dispatch(Message *m) override;
   void ms_handle_connect(Connection *con) override;
   void ms_handle_fast_connect(Connection *con) override;
@@ -3,6 +3,7 @@
 
 #include "osd_perf_counters.h"
 #include "include/common_fwd.h"
+#include "common/ceph_context.h"
 
 
 PerfCounters *build_osd_logger(CephContext *cct) {
@@ -27,6 +28,11 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   };
 
 
+#ifndef WITH_CRIMSON
+  // op threads of all shards update these concurrently
+  osd_plb.set_sharded(cct->_conf->perf_counters_sharded);
+#endif
+
   // All the basic OSD operation stats are to be considered useful
   osd_plb.set_prio_default(PerfCountersBuilder::PRIO_USEFUL);
 
@@ -335,6 +341,19 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_ec_extent_cache_hit, "ec_extent_cache_hit",
+    "EC extent cache lines found in the LRU");
+  osd_plb.add_u64_counter(
+    l_osd_ec_extent_cache_miss, "ec_extent_cache_miss",
+    "EC extent cache lines not found in the LRU");
+  osd_plb.add_u64_counter(
+    l_osd_ec_extent_cache_evict, "ec_extent_cache_evict",
+    "EC extent cache lines evicted from the LRU");
+  osd_plb.add_u64(
+    l_osd_ec_extent_cache_bytes, "ec_extent_cache_bytes",
+    "Bytes held by the EC extent cache LRU", NULL, 0, unit_t(UNIT_BYTES));
+
   /// scrub's replicas reservation time/#replicas histogram
   PerfHistogramCommon::axis_config_d rsrv_hist_x_axis_config{
       "number of replicas",
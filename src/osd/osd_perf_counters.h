@@ -137,6 +137,11 @@ enum osd_counter_idx_t {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_ec_extent_cache_hit,
+  l_osd_ec_extent_cache_miss,
+  l_osd_ec_extent_cache_evict,
+  l_osd_ec_extent_cache_bytes,
+
   // scrubber related. Here, as the rest of the scrub counters
   // are labeled, and histograms do not fully support labels.
   l_osd_scrub_reservation_dur_hist,
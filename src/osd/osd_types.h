@@ -945,6 +945,10 @@ public:
     auto p = std::cbegin(bl);
     decode(p);
   }
+  DENC(eversion_t, v, p) {
+    denc(v.version, p);
+    denc(v.epoch, p);
+  }
   void dump(ceph::Formatter *f) const {
     f->dump_unsigned("version", version);
     f->dump_unsigned("epoch", epoch);
@@ -955,6 +959,7 @@ public:
   }
 };
 WRITE_CLASS_ENCODER(eversion_t)
+WRITE_CLASS_DENC_RAW(eversion_t, sizeof(version_t) + sizeof(epoch_t))
 
 inline bool operator==(const eversion_t& l, const eversion_t& r) {
   return (l.epoch == r.epoch) && (l.version == r.version);
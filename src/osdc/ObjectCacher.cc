@@ -1284,7 +1284,7 @@ void ObjectCacher::bh_write_commit(int64_t poolid, sobject_t oid,
     finish_contexts(cct, ls, r);
 }
 
-void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount, int max_bhs)
+bool ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount, int max_bhs)
 {
   ceph_assert(trace != nullptr);
   ceph_assert(ceph_mutex_is_locked(lock));
@@ -1301,7 +1301,7 @@ void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount, int max_bhs)
    */
   int64_t left = amount;
   int left_bhs = max_bhs;
-  while ((amount == 0 && max_bhs == 0) || left > 0 || left_bhs > 0) {
+  while ((amount == 0 || left > 0) && (max_bhs == 0 || left_bhs > 0)) {
     BufferHead *bh = static_cast<BufferHead*>(
       bh_lru_dirty.lru_get_next_expire());
     if (!bh) break;
@@ -1316,6 +1316,7 @@ void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount, int max_bhs)
       bh_write(bh, *trace);
     }
   }
+  return max_bhs > 0 && left_bhs <= 0 && (amount == 0 || left > 0);
 }
 
 void ObjectCacher::trim()
@@ -1976,6 +1977,15 @@ void ObjectCacher::flusher_entry()
       trace.event("start");
     }
 
+    // writeback is started on at most MAX_FLUSH_UNDER_LOCK bh's at a
+    // time; back off the lock in between so that readers and writers are
+    // not stalled behind a large flush
+    auto backoff = [&l, &trace] {
+      trace.event("backoff");
+      l.unlock();
+      l.lock();
+    };
+
     loff_t actual = get_stat_dirty() + get_stat_dirty_waiting();
     int actual_bhs = dirty_or_tx_bh.size() + get_stat_nr_dirty_waiters();
     if (actual > 0 && (uint64_t) actual > target_dirty) {
@@ -1983,13 +1993,30 @@ void ObjectCacher::flusher_entry()
       ldout(cct, 10) << "flusher " << get_stat_dirty() << " dirty + "
 		     << get_stat_dirty_waiting() << " dirty_waiting > target "
 		     << target_dirty << ", flushing some dirty bhs" << dendl;
-      flush(&trace, actual - target_dirty);
+      loff_t left = actual - target_dirty;
+      while (left > 0 && !flusher_stop) {
+	loff_t dirty = get_stat_dirty();
+	bool more = flush(&trace, left, MAX_FLUSH_UNDER_LOCK);
+	left -= dirty - get_stat_dirty();
+	if (!more) {
+	  break;
+	}
+	backoff();
+      }
     } else if (actual_bhs > target_dirty_bh) {
       ldout(cct, 10) << "flusher " << dirty_or_tx_bh.size() << " dirty/tx bh + "
                      << get_stat_nr_dirty_waiters() << " dirty_waiters > "
                      << "target dirty bh " << target_dirty_bh
                      << ", flushing some dirty bhs" << dendl;
-      flush(&trace, 0, actual_bhs - target_dirty_bh);
+      int left_bhs = actual_bhs - target_dirty_bh;
+      while (left_bhs > 0 && !flusher_stop) {
+	int max_bhs = std::min(left_bhs, MAX_FLUSH_UNDER_LOCK);
+	if (!flush(&trace, 0, max_bhs)) {
+	  break;
+	}
+	left_bhs -= max_bhs;
+	backoff();
+      }
     } else {
       // check tail of lru for old dirty items
       ceph::real_time cutoff = ceph::real_clock::now();
@@ -2010,9 +2037,7 @@ void ObjectCacher::flusher_entry()
       }
       if (!max) {
 	// back off the lock to avoid starving other threads
-        trace.event("backoff");
-	l.unlock();
-	l.lock();
+	backoff();
 	continue;
       }
     }
@@ -2701,8 +2726,6 @@ void ObjectCacher::bh_stat_add(BufferHead *bh)
   default:
     ceph_abort_msg("bh_stat_add: invalid bufferhead state");
   }
-  if (get_stat_dirty_waiting() > 0)
-    stat_cond.notify_all();
 }
 
 void ObjectCacher::bh_stat_sub(BufferHead *bh)
@@ -2765,6 +2788,10 @@ void ObjectCacher::bh_set_state(BufferHead *bh, int s)
 	     s != BufferHead::STATE_TX &&
 	     s != BufferHead::STATE_DIRTY) {
     dirty_or_tx_bh.erase(bh);
+    // only less dirty|tx data can unblock writers waiting for writeback;
+    // waking them on other state changes just has them contend for the lock
+    if (get_stat_nr_dirty_waiters() > 0)
+      stat_cond.notify_all();
   }
 
   if (s != BufferHead::STATE_ERROR &&
@@ -2816,7 +2843,7 @@ void ObjectCacher::bh_remove(Object *ob, BufferHead *bh)
     dirty_or_tx_bh.erase(bh);
   }
   bh_stat_sub(bh);
-  if (get_stat_dirty_waiting() > 0)
+  if ((bh->is_dirty() || bh->is_tx()) && get_stat_nr_dirty_waiters() > 0)
     stat_cond.notify_all();
 }
 
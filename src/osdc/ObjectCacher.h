@@ -543,7 +543,15 @@ class ObjectCacher {
 			    int64_t *amount, int *max_count);
 
   void trim();
-  void flush(ZTracer::Trace *trace, loff_t amount=0, int max_bhs=0);
+  /**
+   * start writeback of the oldest dirty buffers
+   *
+   * @param amount bytes to write back, or 0 for no limit
+   * @param max_bhs max number of buffers to write back, or 0 for no limit
+   * @return true if max_bhs buffers were written back before amount was
+   *         reached (more dirty buffers may be waiting)
+   */
+  bool flush(ZTracer::Trace *trace, loff_t amount=0, int max_bhs=0);
 
   /**
    * flush a range of buffers
@@ -188,6 +188,9 @@ enum {
   l_osdc_replica_read_bounced,
   l_osdc_replica_read_completed,
 
+  l_osdc_pg_mapping_hit,
+  l_osdc_pg_mapping_miss,
+
   l_osdc_last,
 };
 
@@ -270,6 +273,8 @@ void Objecter::init()
 
   if (!logger) {
     PerfCountersBuilder pcb(cct, "objecter", l_osdc_first, l_osdc_last);
+    // every submitting thread bumps these
+    pcb.set_sharded(cct->_conf->perf_counters_sharded);
 
     pcb.add_u64(l_osdc_op_active, "op_active", "Operations active", "actv",
 		PerfCountersBuilder::PRIO_CRITICAL);
@@ -398,6 +403,11 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_replica_read_completed, "replica_read_completed",
 			"Operations completed by replica");
 
+    pcb.add_u64_counter(l_osdc_pg_mapping_hit, "pg_mapping_hit",
+			"Op targets resolved from the cached PG mapping");
+    pcb.add_u64_counter(l_osdc_pg_mapping_miss, "pg_mapping_miss",
+			"Op targets that needed a CRUSH calculation");
+
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -432,7 +442,7 @@ void Objecter::start(const OSDMap* o)
   start_tick();
   if (o) {
     osdmap->deepish_copy_from(*o);
-    prune_pg_mapping(osdmap->get_pools());
+    pg_mappings.prune(osdmap->get_pools());
   } else if (osdmap->get_epoch() == 0) {
     _maybe_request_map();
   }
@@ -555,7 +565,7 @@ void Objecter::shutdown()
 }
 
 void Objecter::_send_linger(LingerOp *info,
-			    ceph::shunique_lock<ceph::shared_mutex>& sul)
+			    ceph::shunique_lock<rwlock_t>& sul)
 {
   ceph_assert(sul.owns_lock() && sul.mutex() == &rwlock);
 
@@ -889,7 +899,7 @@ ceph_tid_t Objecter::linger_notify(LingerOp *info,
 }
 
 void Objecter::_linger_submit(LingerOp *info,
-			      ceph::shunique_lock<ceph::shared_mutex>& sul)
+			      ceph::shunique_lock<rwlock_t>& sul)
 {
   ceph_assert(sul.owns_lock() && sul.mutex() == &rwlock);
   ceph_assert(info->linger_id);
@@ -1066,7 +1076,7 @@ void Objecter::_scan_requests(
   map<ceph_tid_t, Op*>& need_resend,
   list<LingerOp*>& need_resend_linger,
   map<ceph_tid_t, CommandOp*>& need_resend_command,
-  ceph::shunique_lock<ceph::shared_mutex>& sul)
+  ceph::shunique_lock<rwlock_t>& sul)
 {
   ceph_assert(sul.owns_lock() && sul.mutex() == &rwlock);
 
@@ -1270,7 +1280,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	}
 	logger->set(l_osdc_map_epoch, osdmap->get_epoch());
 
-        prune_pg_mapping(osdmap->get_pools());
+        pg_mappings.prune(osdmap->get_pools());
 	cluster_full = cluster_full || _osdmap_full_flag();
 	update_pool_full_map(pool_full_map);
 
@@ -1311,7 +1321,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	ldout(cct, 3) << "handle_osd_map decoding full epoch "
 		      << m->get_last() << dendl;
 	osdmap->decode(m->maps[m->get_last()]);
-        prune_pg_mapping(osdmap->get_pools());
+        pg_mappings.prune(osdmap->get_pools());
 
 	_scan_requests(homeless_session, false, false, NULL,
 		       need_resend, need_resend_linger,
@@ -1871,7 +1881,7 @@ void Objecter::_command_cancel_map_check(CommandOp *c)
  * promotion to write.
  */
 int Objecter::_get_session(int osd, OSDSession **session,
-			   shunique_lock<ceph::shared_mutex>& sul)
+			   shunique_lock<rwlock_t>& sul)
 {
   ceph_assert(sul && sul.mutex() == &rwlock);
 
@@ -2029,7 +2039,7 @@ void Objecter::wait_for_osd_map(epoch_t e)
 
 void Objecter::_get_latest_version(epoch_t oldest, epoch_t newest,
 				   OpCompletion fin,
-				   std::unique_lock<ceph::shared_mutex>&& l)
+				   std::unique_lock<rwlock_t>&& l)
 {
   ceph_assert(fin);
   if (osdmap->get_epoch() >= newest) {
@@ -2152,7 +2162,7 @@ void Objecter::_kick_requests(OSDSession *session,
 }
 
 void Objecter::_linger_ops_resend(map<uint64_t, LingerOp *>& lresend,
-				  unique_lock<ceph::shared_mutex>& ul)
+				  unique_lock<rwlock_t>& ul)
 {
   ceph_assert(ul.owns_lock());
   shunique_lock sul(std::move(ul));
@@ -2313,7 +2323,7 @@ void Objecter::op_submit(Op *op, ceph_tid_t *ptid, int *ctx_budget)
 }
 
 void Objecter::_op_submit_with_budget(Op *op,
-				      shunique_lock<ceph::shared_mutex>& sul,
+				      shunique_lock<rwlock_t>& sul,
 				      ceph_tid_t *ptid,
 				      int *ctx_budget)
 {
@@ -2438,7 +2448,7 @@ struct op_cancellation {
   }
 };
 
-void Objecter::_op_submit(Op *op, shunique_lock<ceph::shared_mutex>& sul, ceph_tid_t *ptid)
+void Objecter::_op_submit(Op *op, shunique_lock<rwlock_t>& sul, ceph_tid_t *ptid)
 {
   // rwlock is locked
 
@@ -2456,7 +2466,13 @@ void Objecter::_op_submit(Op *op, shunique_lock<ceph::shared_mutex>& sul, ceph_t
     break;
   case RECALC_OP_TARGET_POOL_EIO:
     if (op->has_completion()) {
-      op->complete(osdc_errc::pool_eio, -EIO, service.get_executor());
+      // we hold rwlock, which the completion may want for its next op
+      boost::asio::defer(
+	service.get_executor(),
+	[onfinish = std::move(op->onfinish), e = service.get_executor()]()
+	mutable {
+	  Op::complete(std::move(onfinish), osdc_errc::pool_eio, -EIO, e);
+	});
     }
     return;
   }
@@ -2917,18 +2933,15 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
   unsigned pg_num = pi->get_pg_num();
   unsigned pg_num_mask = pi->get_pg_num_mask();
   unsigned pg_num_pending = pi->get_pg_num_pending();
-  int up_primary, acting_primary;
-  vector<int> up, acting;
   ps_t actual_ps = ceph_stable_mod(pgid.ps(), pg_num, pg_num_mask);
   pg_t actual_pgid(actual_ps, pgid.pool());
-  if (!lookup_pg_mapping(actual_pgid, osdmap->get_epoch(), &up, &up_primary,
-                         &acting, &acting_primary)) {
-    osdmap->pg_to_up_acting_osds(actual_pgid, &up, &up_primary,
-                                 &acting, &acting_primary);
-    pg_mapping_t pg_mapping(osdmap->get_epoch(),
-                            up, up_primary, acting, acting_primary);
-    update_pg_mapping(actual_pgid, std::move(pg_mapping));
-  }
+  bool mapping_hit;
+  auto pg_mapping = pg_mappings.get(*osdmap, actual_pgid, &mapping_hit);
+  logger->inc(mapping_hit ? l_osdc_pg_mapping_hit : l_osdc_pg_mapping_miss);
+  const vector<int>& up = pg_mapping->up;
+  const vector<int>& acting = pg_mapping->acting;
+  int up_primary = pg_mapping->up_primary;
+  int acting_primary = pg_mapping->acting_primary;
   bool sort_bitwise = osdmap->test_flag(CEPH_OSDMAP_SORTBITWISE);
   bool recovery_deletes = osdmap->test_flag(CEPH_OSDMAP_RECOVERY_DELETES);
   unsigned prev_seed = ceph_stable_mod(pgid.ps(), t->pg_num, t->pg_num_mask);
@@ -2994,10 +3007,10 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
 
   if (legacy_change || split_or_merge || force_resend) {
     t->pgid = pgid;
-    t->acting = std::move(acting);
+    t->acting = acting;
     t->acting_primary = acting_primary;
     t->up_primary = up_primary;
-    t->up = std::move(up);
+    t->up = up;
     t->size = size;
     t->min_size = min_size;
     t->pg_num = pg_num;
@@ -3079,7 +3092,7 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
 }
 
 int Objecter::_map_session(op_target_t *target, OSDSession **s,
-			   shunique_lock<ceph::shared_mutex>& sul)
+			   shunique_lock<rwlock_t>& sul)
 {
   _calc_target(target, nullptr);
   return _get_session(target->osd, s, sul);
@@ -3186,7 +3199,7 @@ void Objecter::_session_command_op_assign(OSDSession *to, CommandOp *op)
 }
 
 int Objecter::_recalc_linger_op_target(LingerOp *linger_op,
-				       shunique_lock<ceph::shared_mutex>& sul)
+				       shunique_lock<rwlock_t>& sul)
 {
   // rwlock is locked unique
 
@@ -3408,7 +3421,7 @@ int Objecter::calc_op_budget(const bc::small_vector_base<OSDOp>& ops)
 }
 
 void Objecter::_throttle_op(Op *op,
-			    shunique_lock<ceph::shared_mutex>& sul,
+			    shunique_lock<rwlock_t>& sul,
 			    int op_budget)
 {
   ceph_assert(sul && sul.mutex() == &rwlock);
@@ -3911,6 +3924,8 @@ void Objecter::list_nobjects(NListContext *list_context, Context *onfinish)
     if (list_context->list.empty()) {
       list_context->at_end_of_pool = true;
     }
+    // the caller may well list on from onfinish
+    rl.unlock();
     // release the listing context's budget once all
     // OPs (in the session) are finished
     put_nlist_context_budget(list_context);
@@ -5005,7 +5020,7 @@ void Objecter::submit_command(CommandOp *c, ceph_tid_t *ptid)
 }
 
 int Objecter::_calc_command_target(CommandOp *c,
-				   shunique_lock<ceph::shared_mutex>& sul)
+				   shunique_lock<rwlock_t>& sul)
 {
   ceph_assert(sul.owns_lock() && sul.mutex() == &rwlock);
 
@@ -5061,7 +5076,7 @@ int Objecter::_calc_command_target(CommandOp *c,
 }
 
 void Objecter::_assign_command_session(CommandOp *c,
-				       shunique_lock<ceph::shared_mutex>& sul)
+				       shunique_lock<rwlock_t>& sul)
 {
   ceph_assert(sul.owns_lock() && sul.mutex() == &rwlock);
 
@@ -49,6 +49,7 @@
 #include "common/ceph_mutex.h"
 #include "common/ceph_timer.h"
 #include "common/config_obs.h"
+#include "common/sharded_shared_mutex.h"
 #include "common/shunique_lock.h"
 #include "common/snap_types.h" // for class SnapContext
 #include "common/zipkin_trace.h"
@@ -63,6 +64,7 @@
 
 #include "osd/OSDMap.h"
 #include "osd/error_code.h"
+#include "osdc/PGMappingCache.h"
 
 class Context;
 class Messenger;
@@ -1727,69 +1729,7 @@ private:
   // to be drained by consume_blocklist_events.
   bool blocklist_events_enabled = false;
   std::set<entity_addr_t> blocklist_events;
-  struct pg_mapping_t {
-    epoch_t epoch = 0;
-    std::vector<int> up;
-    int up_primary = -1;
-    std::vector<int> acting;
-    int acting_primary = -1;
-
-    pg_mapping_t() {}
-    pg_mapping_t(epoch_t epoch, const std::vector<int>& up, int up_primary,
-                 const std::vector<int>& acting, int acting_primary)
-               : epoch(epoch), up(up), up_primary(up_primary),
-                 acting(acting), acting_primary(acting_primary) {}
-  };
-  ceph::shared_mutex pg_mapping_lock =
-    ceph::make_shared_mutex("Objecter::pg_mapping_lock");
-  // pool -> pg mapping
-  std::map<int64_t, std::vector<pg_mapping_t>> pg_mappings;
-
-  // convenient accessors
-  bool lookup_pg_mapping(const pg_t& pg, epoch_t epoch, std::vector<int> *up,
-                         int *up_primary, std::vector<int> *acting,
-                         int *acting_primary) {
-    std::shared_lock l{pg_mapping_lock};
-    auto it = pg_mappings.find(pg.pool());
-    if (it == pg_mappings.end())
-      return false;
-    auto& mapping_array = it->second;
-    if (pg.ps() >= mapping_array.size())
-      return false;
-    if (mapping_array[pg.ps()].epoch != epoch) // stale
-      return false;
-    auto& pg_mapping = mapping_array[pg.ps()];
-    *up = pg_mapping.up;
-    *up_primary = pg_mapping.up_primary;
-    *acting = pg_mapping.acting;
-    *acting_primary = pg_mapping.acting_primary;
-    return true;
-  }
-  void update_pg_mapping(const pg_t& pg, pg_mapping_t&& pg_mapping) {
-    std::lock_guard l{pg_mapping_lock};
-    auto& mapping_array = pg_mappings[pg.pool()];
-    ceph_assert(pg.ps() < mapping_array.size());
-    mapping_array[pg.ps()] = std::move(pg_mapping);
-  }
-  void prune_pg_mapping(const mempool::osdmap::map<int64_t,pg_pool_t>& pools) {
-    std::lock_guard l{pg_mapping_lock};
-    for (auto& pool : pools) {
-      auto& mapping_array = pg_mappings[pool.first];
-      size_t pg_num = pool.second.get_pg_num();
-      if (mapping_array.size() != pg_num) {
-        // catch both pg_num increasing & decreasing
-        mapping_array.resize(pg_num);
-      }
-    }
-    for (auto it = pg_mappings.begin(); it != pg_mappings.end(); ) {
-      if (!pools.count(it->first)) {
-        // pool is gone
-        pg_mappings.erase(it++);
-        continue;
-      }
-      it++;
-    }
-  }
+  PGMappingCache pg_mappings;
 
 public:
   void maybe_request_map();
@@ -1802,8 +1742,13 @@ private:
   version_t last_seen_osdmap_version = 0;
   version_t last_seen_pgmap_version = 0;
 
-  mutable ceph::shared_mutex rwlock =
-	   ceph::make_shared_mutex("Objecter::rwlock");
+  // rwlock is taken shared by every op submission and exclusively only
+  // on map changes and reconfiguration, so it uses the per-thread reader
+  // slots of sharded_shared_mutex to keep concurrent submitters from
+  // contending on one cache line.  It prefers writers: never take it
+  // shared again while already holding it, e.g. from a completion.
+  using rwlock_t = ceph::sharded_shared_mutex;
+  mutable rwlock_t rwlock{"Objecter::rwlock"};
   ceph::timer<ceph::coarse_mono_clock> timer;
 
   PerfCounters* logger = nullptr;
@@ -2311,9 +2256,9 @@ public:
 
   void submit_command(CommandOp *c, ceph_tid_t *ptid);
   int _calc_command_target(CommandOp *c,
-			   ceph::shunique_lock<ceph::shared_mutex> &sul);
+			   ceph::shunique_lock<rwlock_t> &sul);
   void _assign_command_session(CommandOp *c,
-			       ceph::shunique_lock<ceph::shared_mutex> &sul);
+			       ceph::shunique_lock<rwlock_t> &sul);
   void _send_command(CommandOp *c);
   int command_op_cancel(OSDSession *s, ceph_tid_t tid,
 			boost::system::error_code ec);
@@ -2548,7 +2493,7 @@ public:
   int _calc_target(op_target_t *t, Connection *con,
 		   bool any_change = false);
   int _map_session(op_target_t *op, OSDSession **s,
-		   ceph::shunique_lock<ceph::shared_mutex>& lc);
+		   ceph::shunique_lock<rwlock_t>& lc);
 
   void _session_op_assign(OSDSession *s, Op *op);
   void _session_op_remove(OSDSession *s, Op *op);
@@ -2557,16 +2502,16 @@ public:
   void _session_command_op_assign(OSDSession *to, CommandOp *op);
   void _session_command_op_remove(OSDSession *from, CommandOp *op);
 
-  int _assign_op_target_session(Op *op, ceph::shunique_lock<ceph::shared_mutex>& lc,
+  int _assign_op_target_session(Op *op, ceph::shunique_lock<rwlock_t>& lc,
 				bool src_session_locked,
 				bool dst_session_locked);
   int _recalc_linger_op_target(LingerOp *op,
-			       ceph::shunique_lock<ceph::shared_mutex>& lc);
+			       ceph::shunique_lock<rwlock_t>& lc);
 
   void _linger_submit(LingerOp *info,
-		      ceph::shunique_lock<ceph::shared_mutex>& sul);
+		      ceph::shunique_lock<rwlock_t>& sul);
   void _send_linger(LingerOp *info,
-		    ceph::shunique_lock<ceph::shared_mutex>& sul);
+		    ceph::shunique_lock<rwlock_t>& sul);
   void _linger_commit(LingerOp *info, boost::system::error_code ec,
 		      ceph::buffer::list& outbl);
   void _linger_reconnect(LingerOp *info, boost::system::error_code ec);
@@ -2610,10 +2555,10 @@ private:
 
   void _kick_requests(OSDSession *session, std::map<uint64_t, LingerOp *>& lresend);
   void _linger_ops_resend(std::map<uint64_t, LingerOp *>& lresend,
-			  std::unique_lock<ceph::shared_mutex>& ul);
+			  std::unique_lock<rwlock_t>& ul);
 
   int _get_session(int osd, OSDSession **session,
-		   ceph::shunique_lock<ceph::shared_mutex>& sul);
+		   ceph::shunique_lock<rwlock_t>& sul);
   void put_session(OSDSession *s);
   void get_session(OSDSession *s);
   void _reopen_session(OSDSession *session);
@@ -2631,9 +2576,9 @@ private:
    * If throttle_op needs to throttle it will unlock client_lock.
    */
   int calc_op_budget(const boost::container::small_vector_base<OSDOp>& ops);
-  void _throttle_op(Op *op, ceph::shunique_lock<ceph::shared_mutex>& sul,
+  void _throttle_op(Op *op, ceph::shunique_lock<rwlock_t>& sul,
 		    int op_size = 0);
-  int _take_op_budget(Op *op, ceph::shunique_lock<ceph::shared_mutex>& sul) {
+  int _take_op_budget(Op *op, ceph::shunique_lock<rwlock_t>& sul) {
     ceph_assert(sul && sul.mutex() == &rwlock);
     int op_budget = calc_op_budget(op->ops);
     if (keep_balanced_budget) {
@@ -2707,7 +2652,7 @@ private:
     std::map<ceph_tid_t, Op*>& need_resend,
     std::list<LingerOp*>& need_resend_linger,
     std::map<ceph_tid_t, CommandOp*>& need_resend_command,
-    ceph::shunique_lock<ceph::shared_mutex>& sul);
+    ceph::shunique_lock<rwlock_t>& sul);
 
   int64_t get_object_hash_position(int64_t pool, const std::string& key,
 				   const std::string& ns);
@@ -2791,10 +2736,10 @@ private:
                              const OSDMap &new_osd_map);
 
   // low-level
-  void _op_submit(Op *op, ceph::shunique_lock<ceph::shared_mutex>& lc,
+  void _op_submit(Op *op, ceph::shunique_lock<rwlock_t>& lc,
 		  ceph_tid_t *ptid);
   void _op_submit_with_budget(Op *op,
-			      ceph::shunique_lock<ceph::shared_mutex>& lc,
+			      ceph::shunique_lock<rwlock_t>& lc,
 			      ceph_tid_t *ptid,
 			      int *ctx_budget = NULL);
   // public interface
@@ -2914,7 +2859,7 @@ public:
 
   void _get_latest_version(epoch_t oldest, epoch_t neweset,
 			   OpCompletion fin,
-			   std::unique_lock<ceph::shared_mutex>&& ul);
+			   std::unique_lock<rwlock_t>&& ul);
 
   /** Get the current set of global op flags */
   int get_global_op_flags() const { return global_op_flags; }
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSDC_PGMAPPINGCACHE_H
+#define CEPH_OSDC_PGMAPPINGCACHE_H
+
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "include/ceph_assert.h"
+#include "osd/OSDMap.h"
+
+/**
+ * Memoizes the pg -> up/acting mapping of the current OSDMap epoch.
+ *
+ * Computing a mapping runs CRUSH, which is one of the larger costs of
+ * submitting an op.  Entries are filled in lazily and go stale as soon as
+ * the epoch moves on; prune() only has to follow pg_num changes and
+ * deleted pools.  Mappings are shared immutable objects, so a lookup
+ * costs a reference count rather than copies of the OSD vectors.
+ */
+class PGMappingCache {
+public:
+  struct mapping_t {
+    epoch_t epoch = 0;
+    std::vector<int> up;
+    int up_primary = -1;
+    std::vector<int> acting;
+    int acting_primary = -1;
+
+    mapping_t() {}
+    mapping_t(epoch_t epoch, std::vector<int>&& up, int up_primary,
+	      std::vector<int>&& acting, int acting_primary)
+      : epoch(epoch), up(std::move(up)), up_primary(up_primary),
+	acting(std::move(acting)), acting_primary(acting_primary) {}
+  };
+  using mapping_ref = std::shared_ptr<const mapping_t>;
+
+  /// get the mapping of pg in osdmap's epoch, computing it on a miss
+  mapping_ref get(const OSDMap& osdmap, const pg_t& pg, bool *hit = nullptr) {
+    epoch_t epoch = osdmap.get_epoch();
+    if (auto m = lookup(pg, epoch); m) {
+      if (hit) {
+	*hit = true;
+      }
+      return m;
+    }
+    if (hit) {
+      *hit = false;
+    }
+    std::vector<int> up, acting;
+    int up_primary, acting_primary;
+    osdmap.pg_to_up_acting_osds(pg, &up, &up_primary, &acting,
+				&acting_primary);
+    auto m = std::make_shared<const mapping_t>(
+      epoch, std::move(up), up_primary, std::move(acting), acting_primary);
+    update(pg, m);
+    return m;
+  }
+
+  mapping_ref lookup(const pg_t& pg, epoch_t epoch) const {
+    std::shared_lock l{lock};
+    auto it = mappings.find(pg.pool());
+    if (it == mappings.end())
+      return nullptr;
+    auto& mapping_array = it->second;
+    if (pg.ps() >= mapping_array.size())
+      return nullptr;
+    auto& m = mapping_array[pg.ps()];
+    if (!m || m->epoch != epoch) // stale
+      return nullptr;
+    return m;
+  }
+
+  void update(const pg_t& pg, mapping_ref m) {
+    std::lock_guard l{lock};
+    auto& mapping_array = mappings[pg.pool()];
+    ceph_assert(pg.ps() < mapping_array.size());
+    mapping_array[pg.ps()] = std::move(m);
+  }
+
+  void prune(const mempool::osdmap::map<int64_t,pg_pool_t>& pools) {
+    std::lock_guard l{lock};
+    for (auto& pool : pools) {
+      auto& mapping_array = mappings[pool.first];
+      size_t pg_num = pool.second.get_pg_num();
+      if (mapping_array.size() != pg_num) {
+	// catch both pg_num increasing & decreasing
+	mapping_array.resize(pg_num);
+      }
+    }
+    for (auto it = mappings.begin(); it != mappings.end(); ) {
+      if (!pools.count(it->first)) {
+	// pool is gone
+	mappings.erase(it++);
+	continue;
+      }
+      it++;
+    }
+  }
+
+private:
+  mutable ceph::shared_mutex lock =
+    ceph::make_shared_mutex("PGMappingCache::lock");
+  // pool -> pg mapping
+  std::map<int64_t, std::vector<mapping_ref>> mappings;
+};
+
+#endif
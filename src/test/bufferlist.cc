@@ -24,6 +24,7 @@
 #include <sys/uio.h>
 
 #include <iostream> // for std::cout
+#include <thread>
 
 #include "include/buffer.h"
 #include "include/buffer_raw.h"
@@ -3052,6 +3053,107 @@ TEST(BufferList, DanglingLastP) {
   EXPECT_EQ(0, ::memcmp("12C", bl.c_str(), 3));
 }
 
+static const buffer::raw* get_raw(const bufferptr& bp)
+{
+  return static_cast<const instrumented_bptr&>(bp).get_raw();
+}
+
+#ifndef __has_feature
+#define __has_feature(x) 0
+#endif
+
+TEST(BufferList, RecyclesSmallAppendBuffers) {
+#if __has_feature(address_sanitizer) || defined(__SANITIZE_ADDRESS__)
+  GTEST_SKIP() << "buffer caching is compiled out under ASan";
+#endif
+  if (get_env_bool("CEPH_BUFFER_NO_CACHE")) {
+    GTEST_SKIP() << "buffer caching is disabled";
+  }
+  const buffer::raw* raw;
+  const void* node;
+  unsigned append_len;
+  {
+    bufferlist bl;
+    bl.append('a');
+    raw = get_raw(bl.front());
+    node = &bl.buffers().front();
+    append_len = bl.front().raw_length();
+  }
+  // the freed append buffer and ptr_node are handed out again
+  bufferlist bl;
+  bl.append('b');
+  EXPECT_EQ(raw, get_raw(bl.front()));
+  EXPECT_EQ(node, &bl.buffers().front());
+  EXPECT_EQ(append_len, bl.front().raw_length());
+  EXPECT_EQ('b', bl[0]);
+
+  // but never to requests needing a stronger alignment
+  bufferlist().append('c');
+  bufferptr aligned = buffer::create_aligned(append_len, 64);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned.c_str()) % 64);
+}
+
+TEST(BufferList, RecycleAcrossThreads) {
+  // buffers allocated on one thread and released on another end up in
+  // the releasing thread's cache, which is emptied when it exits
+  std::vector<bufferlist> bls(100);
+  for (auto& bl : bls) {
+    encode(std::string("object name"), bl);
+    encode(uint64_t(42), bl);
+  }
+  std::thread t([&bls] {
+    bls.clear();
+    for (int i = 0; i < 100; ++i) {
+      bufferlist bl;
+      encode(std::string("object name"), bl);
+      ASSERT_EQ(sizeof(uint32_t) + 11, bl.length());
+    }
+  });
+  t.join();
+  bufferlist bl;
+  encode(uint64_t(42), bl);
+  ASSERT_EQ(sizeof(uint64_t), bl.length());
+}
+
+// encode and decode a small, message-like structure the way the
+// messenger and BlueStore do: many tiny appends into a fresh bufferlist
+TEST(BufferList, BenchEncodeDecodeSmall) {
+  const std::string oid("rbd_data.1234567890ab.0000000000000042");
+  const std::vector<uint32_t> ops = {1, 2, 3, 4};
+  std::map<std::string, bufferlist> attrs;
+  attrs["_"].append(std::string(200, 'o'));
+  attrs["snapset"].append(std::string(40, 's'));
+  bufferptr payload = buffer::create(512);
+  payload.zero();
+
+  constexpr int num = 200000;
+  uint64_t total = 0;
+  utime_t start = ceph_clock_now();
+  for (int i = 0; i < num; ++i) {
+    bufferlist bl;
+    encode(oid, bl);
+    encode(uint64_t(i), bl);
+    encode(ops, bl);
+    encode(attrs, bl);
+    bl.append(payload);
+
+    auto p = bl.cbegin();
+    std::string doid;
+    uint64_t snap;
+    std::vector<uint32_t> dops;
+    std::map<std::string, bufferlist> dattrs;
+    decode(doid, p);
+    decode(snap, p);
+    decode(dops, p);
+    decode(dattrs, p);
+    total += snap + dattrs.size();
+  }
+  utime_t end = ceph_clock_now();
+  ASSERT_GT(total, 0u);
+  cout << num << " encode+decode of a small message in " << (end - start)
+       << " (" << (end - start).to_nsec() / num << " ns each)" << std::endl;
+}
+
 TEST(BufferHash, all) {
   {
     bufferlist bl;
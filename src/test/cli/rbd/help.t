@@ -808,7 +808,8 @@
   usage: rbd export-diff [--pool <pool>] [--namespace <namespace>] 
                          [--image <image>] [--snap <snap>] [--path <path>] 
                          [--from-snap <from-snap>] [--whole-object] 
-                         [--no-progress] 
+                         [--diff-format <diff-format>] 
+                         [--compression <compression>] [--no-progress] 
                          <source-image-or-snap-spec> <path-name> 
   
   Export incremental diff to file.
@@ -828,6 +829,9 @@
     --path arg                   export file (or '-' for stdout)
     --from-snap arg              snapshot starting point
     --whole-object               compare whole object
+    --diff-format arg            format of the diff file [1 (default) or 3]
+    --compression arg            compression algorithm for the diff (zstd, lz4,
+                                 snappy or zlib; requires diff format 3)
     --no-progress                disable progress output
   
   rbd help feature disable
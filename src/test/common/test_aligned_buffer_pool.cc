@@ -0,0 +1,95 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/AlignedBufferPool.h"
+#include "include/page.h"
+
+#include <gtest/gtest.h>
+
+TEST(AlignedBufferPool, alignment)
+{
+  auto pool = AlignedBufferPool::create(1 << 20, 1 << 20);
+  auto bp = pool->get(100, 3 * CEPH_PAGE_SIZE);
+  ASSERT_EQ(3 * CEPH_PAGE_SIZE, bp.length());
+  ASSERT_EQ(100u, bp.offset());
+  ASSERT_EQ(0u, (uintptr_t)(bp.c_str() - 100) % CEPH_PAGE_SIZE);
+  // 100 + 3 pages of data needs a 4 page block
+  ASSERT_EQ(4 * CEPH_PAGE_SIZE, bp.raw_length());
+}
+
+TEST(AlignedBufferPool, reuse)
+{
+  auto pool = AlignedBufferPool::create(1 << 20, 1 << 20);
+  const char *data;
+  {
+    auto bp = pool->get(0, 2 * CEPH_PAGE_SIZE);
+    data = bp.c_str();
+    ASSERT_EQ(0u, pool->get_stats().cached_bytes);
+  }
+  ASSERT_EQ(2 * CEPH_PAGE_SIZE, pool->get_stats().cached_bytes);
+
+  // a request of the same size class gets the freed block back
+  auto bp = pool->get(10, CEPH_PAGE_SIZE + 1);
+  ASSERT_EQ(data, bp.c_str() - 10);
+  auto stats = pool->get_stats();
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(1u, stats.misses);
+  ASSERT_EQ(0u, stats.cached_bytes);
+}
+
+TEST(AlignedBufferPool, max_block_size)
+{
+  auto pool = AlignedBufferPool::create(1 << 20, 4 * CEPH_PAGE_SIZE);
+  {
+    auto bp = pool->get(0, 5 * CEPH_PAGE_SIZE);
+    ASSERT_EQ(0u, (uintptr_t)bp.c_str() % CEPH_PAGE_SIZE);
+  }
+  // too large blocks are never pooled
+  ASSERT_EQ(0u, pool->get_stats().cached_bytes);
+  ASSERT_EQ(0u, pool->get_stats().misses);
+}
+
+TEST(AlignedBufferPool, max_bytes)
+{
+  auto pool = AlignedBufferPool::create(4 * CEPH_PAGE_SIZE,
+					4 * CEPH_PAGE_SIZE);
+  {
+    auto a = pool->get(0, CEPH_PAGE_SIZE);
+    auto b = pool->get(0, CEPH_PAGE_SIZE);
+    auto c = pool->get(0, CEPH_PAGE_SIZE);
+  }
+  ASSERT_EQ(3 * CEPH_PAGE_SIZE, pool->get_stats().cached_bytes);
+
+  // a block of another size makes room for itself
+  {
+    auto bp = pool->get(0, 4 * CEPH_PAGE_SIZE);
+  }
+  ASSERT_EQ(4 * CEPH_PAGE_SIZE, pool->get_stats().cached_bytes);
+
+  // but does not displace blocks of its own size
+  {
+    auto a = pool->get(0, 4 * CEPH_PAGE_SIZE);
+    auto b = pool->get(0, 4 * CEPH_PAGE_SIZE);
+  }
+  ASSERT_EQ(4 * CEPH_PAGE_SIZE, pool->get_stats().cached_bytes);
+
+  pool->set_max_bytes(0);
+  ASSERT_EQ(0u, pool->get_stats().cached_bytes);
+}
+
+TEST(AlignedBufferPool, outlives_owner)
+{
+  auto pool = AlignedBufferPool::create(1 << 20, 1 << 20);
+  auto bp = pool->get(0, CEPH_PAGE_SIZE);
+  pool.reset();
+  bp.c_str()[0] = 'x';
+}
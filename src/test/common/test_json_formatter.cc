@@ -126,3 +126,126 @@ TEST(formatter, dump_large_item) {
   EXPECT_TRUE(parser.parse(bl.c_str(), bl.length()));
   EXPECT_EQ(parser.find_obj("Location")->get_data(), full_url);
 }
+
+static void dump_sample(Formatter& f, int entries)
+{
+  f.open_object_section("dump");
+  f.open_array_section("items");
+  for (int i = 0; i < entries; ++i) {
+    f.open_object_section("item");
+    f.dump_int("id", i);
+    f.dump_int("neg", -i);
+    f.dump_unsigned("big", std::numeric_limits<uint64_t>::max() - i);
+    f.dump_float("ratio", i / 7.0);
+    f.dump_string("name", "object_" + std::to_string(i));
+    f.dump_string("escaped", "tab\there \"quoted\" \\ \x01 end\n");
+    f.dump_stream("stream") << "pg " << i << '.' << (i % 16);
+    f.dump_bool("flag", i & 1);
+    f.close_section();
+  }
+  f.close_section();
+  f.close_section();
+}
+
+TEST(formatter, dump_float_precision)
+{
+  JSONFormatter formatter;
+  formatter.open_object_section("floats");
+  const double values[] = {0.1, 1.0/3, 1e300, -2.5e-310, 42.0, 0.0};
+  for (double v : values) {
+    formatter.dump_float("v", v);
+  }
+  formatter.close_section();
+  std::ostringstream out;
+  formatter.flush(out);
+
+  // must match what an ostream with max_digits10 precision prints
+  std::ostringstream expected;
+  expected.precision(std::numeric_limits<double>::max_digits10);
+  expected << "{";
+  for (unsigned i = 0; i < std::size(values); ++i) {
+    expected << (i ? "," : "") << "\"v\":" << values[i];
+  }
+  expected << "}";
+  ASSERT_EQ(expected.str(), out.str());
+}
+
+TEST(formatter, chunked_matches_json)
+{
+  for (bool pretty : {false, true}) {
+    JSONFormatter plain(pretty);
+    JSONFormatterChunked chunked(pretty, {}, 4096);
+    dump_sample(plain, 1000);
+    dump_sample(chunked, 1000);
+    ASSERT_EQ(plain.get_len(), chunked.get_len());
+
+    bufferlist a, b;
+    plain.flush(a);
+    chunked.flush(b);
+    ASSERT_GT(b.get_num_buffers(), 1u);
+    ASSERT_TRUE(a.contents_equal(b));
+
+    JSONParser parser;
+    ASSERT_TRUE(parser.parse(b.c_str(), b.length()));
+
+    // the formatter can be reused after a flush
+    dump_sample(plain, 3);
+    dump_sample(chunked, 3);
+    std::ostringstream sa, sb;
+    plain.flush(sa);
+    chunked.flush(sb);
+    ASSERT_EQ(sa.str(), sb.str());
+  }
+}
+
+TEST(formatter, chunked_sink)
+{
+  constexpr size_t chunk_size = 4096;
+  bufferlist sunk;
+  unsigned chunks = 0;
+  JSONFormatterChunked chunked(
+    false,
+    [&](bufferlist&& bl) {
+      // nothing accumulates beyond a chunk before it is handed over
+      ASSERT_LE(bl.length(), chunk_size);
+      ++chunks;
+      sunk.claim_append(bl);
+    },
+    chunk_size);
+  dump_sample(chunked, 1000);
+  chunked.flush_to_sink();
+  bufferlist rest;
+  chunked.flush(rest);
+  ASSERT_EQ(0u, rest.length());
+  ASSERT_GT(chunks, 10u);
+
+  JSONFormatter plain;
+  dump_sample(plain, 1000);
+  bufferlist expected;
+  plain.flush(expected);
+  ASSERT_TRUE(expected.contents_equal(sunk));
+}
+
+// compare rendering a large dump with JSONFormatter and JSONFormatterChunked
+TEST(formatter, DISABLED_bench_chunked)
+{
+  constexpr int entries = 500000;
+  auto bench = [](const char *what, Formatter& f) {
+    auto start = ceph::mono_clock::now();
+    dump_sample(f, entries);
+    bufferlist bl;
+    f.flush(bl);
+    double secs = std::chrono::duration<double>(
+      ceph::mono_clock::now() - start).count();
+    std::cout << what << ": " << bl.length() / secs / (1 << 20)
+	      << " MB/s (" << bl.length() << " bytes in "
+	      << bl.get_num_buffers() << " buffers)" << std::endl;
+  };
+  for (bool pretty : {false, true}) {
+    JSONFormatter plain(pretty);
+    bench(pretty ? "JSONFormatter(pretty)" : "JSONFormatter", plain);
+    JSONFormatterChunked chunked(pretty);
+    bench(pretty ? "JSONFormatterChunked(pretty)" : "JSONFormatterChunked",
+	  chunked);
+  }
+}
@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/ceph_context.h"
+#include "common/perf_counters.h"
+
+enum {
+  l_bench_first = 1000,
+  l_bench_ops,
+  l_bench_bytes,
+  l_bench_lat,
+  l_bench_last,
+};
+
+static std::unique_ptr<PerfCounters> build_counters(CephContext *cct,
+						    bool sharded)
+{
+  PerfCountersBuilder plb(cct, "bench", l_bench_first, l_bench_last);
+  plb.set_sharded(sharded);
+  plb.add_u64_counter(l_bench_ops, "ops");
+  plb.add_u64_counter(l_bench_bytes, "bytes");
+  plb.add_time_avg(l_bench_lat, "lat");
+  return std::unique_ptr<PerfCounters>(plb.create_perf_counters());
+}
+
+// updates/sec when every thread hammers the same few counters, the way
+// OSD op threads do
+static double run(PerfCounters *pc, int num_threads, int per_thread)
+{
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&] {
+      while (!go) {
+	std::this_thread::yield();
+      }
+      for (int i = 0; i < per_thread; ++i) {
+	pc->inc(l_bench_ops);
+	pc->inc(l_bench_bytes, 4096);
+	pc->tinc(l_bench_lat, std::chrono::microseconds(1));
+      }
+    });
+  }
+  auto start = ceph::mono_clock::now();
+  go = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  double secs = std::chrono::duration<double>(
+    ceph::mono_clock::now() - start).count();
+  return 3.0 * num_threads * per_thread / secs;
+}
+
+class PerfCountersContention : public ::testing::TestWithParam<bool> {
+protected:
+  boost::intrusive_ptr<CephContext> cct{
+    new CephContext(CEPH_ENTITY_TYPE_CLIENT), false};
+};
+
+TEST_P(PerfCountersContention, Totals)
+{
+  auto pc = build_counters(cct.get(), GetParam());
+  const int max_threads = std::max(4u, std::thread::hardware_concurrency());
+  constexpr int per_thread = 20000;
+  uint64_t expected = 0;
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    double rate = run(pc.get(), threads, per_thread);
+    expected += threads * per_thread;
+    std::cout << (GetParam() ? "sharded  " : "unsharded") << " "
+	      << threads << " threads: " << (uint64_t)rate << " updates/sec"
+	      << std::endl;
+    ASSERT_EQ(expected, pc->get(l_bench_ops));
+    ASSERT_EQ(expected * 4096, pc->get(l_bench_bytes));
+    auto [count, sum] = pc->get_tavg_ns(l_bench_lat);
+    ASSERT_EQ(expected, count);
+    ASSERT_EQ(expected * 1000, sum);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  PerfCounters,
+  PerfCountersContention,
+  ::testing::Bool());
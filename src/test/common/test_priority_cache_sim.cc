@@ -0,0 +1,263 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Replays cache access traces against PriorityCache::Manager to compare
+ * balancing policies.  Each simulated cache is an LRU of fixed size items
+ * that asks, like the BlueStore caches, for the items it touched during
+ * the last interval at PRI1 and leaves the rest to the ratios.
+ *
+ * A recorded trace can be replayed by pointing CEPH_PRIORITY_CACHE_TRACE
+ * at a file of "<cache> <key>" lines, with "balance" lines separating the
+ * intervals.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/PriorityCache.h"
+#include "global/global_context.h"
+
+using namespace PriorityCache;
+
+namespace {
+
+class SimCache : public PriCache {
+  const std::string name;
+  const uint64_t item_size;
+  double ratio;
+  int64_t cache_bytes[Priority::LAST + 1] = {0};
+  int64_t committed = 0;
+
+  std::list<uint64_t> lru;
+  std::unordered_map<uint64_t, std::list<uint64_t>::iterator> index;
+  std::unordered_set<uint64_t> recent;
+
+  void trim() {
+    while (!lru.empty() &&
+	   static_cast<int64_t>(lru.size() * item_size) > get_cache_bytes()) {
+      index.erase(lru.back());
+      lru.pop_back();
+    }
+  }
+
+public:
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+  SimCache(const std::string& name, uint64_t item_size, double ratio)
+    : name(name), item_size(item_size), ratio(ratio) {}
+
+  void access(uint64_t key) {
+    recent.insert(key);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      ++hits;
+      lru.splice(lru.begin(), lru, it->second);
+      return;
+    }
+    ++misses;
+    lru.push_front(key);
+    index[key] = lru.begin();
+    trim();
+  }
+
+  int64_t request_cache_bytes(Priority pri, uint64_t total_cache) const override {
+    if (pri != Priority::PRI1) {
+      return 0;
+    }
+    int64_t want = recent.size() * item_size;
+    int64_t assigned = get_cache_bytes(pri);
+    return want > assigned ? want - assigned : 0;
+  }
+  int64_t get_cache_bytes(Priority pri) const override {
+    return cache_bytes[pri];
+  }
+  int64_t get_cache_bytes() const override {
+    int64_t total = 0;
+    for (auto b : cache_bytes) {
+      total += b;
+    }
+    return total;
+  }
+  void set_cache_bytes(Priority pri, int64_t bytes) override {
+    cache_bytes[pri] = bytes;
+  }
+  void add_cache_bytes(Priority pri, int64_t bytes) override {
+    cache_bytes[pri] += bytes;
+  }
+  int64_t commit_cache_size(uint64_t total_cache) override {
+    recent.clear();
+    trim();
+    committed = get_cache_bytes();
+    return committed;
+  }
+  int64_t get_committed_size() const override {
+    return committed;
+  }
+  double get_cache_ratio() const override {
+    return ratio;
+  }
+  void set_cache_ratio(double r) override {
+    ratio = r;
+  }
+  std::string get_cache_name() const override {
+    return name;
+  }
+  void shift_bins() override {}
+  void import_bins(const std::vector<uint64_t>& bins) override {}
+  void set_bins(Priority pri, uint64_t end_bin) override {}
+  uint64_t get_bins(Priority pri) const override {
+    return 0;
+  }
+  bool get_hit_stats(uint64_t *h, uint64_t *m) const override {
+    *h = hits;
+    *m = misses;
+    return true;
+  }
+};
+
+struct access_t {
+  unsigned cache;  // index into the simulated caches; ~0u ends an interval
+  uint64_t key;
+};
+using trace_t = std::vector<access_t>;
+constexpr unsigned BALANCE = ~0u;
+
+constexpr uint64_t MEM = 64 << 20;
+
+// A metadata-like cache of 4K items over a 96M working set and a data-like
+// cache of 64K items over 192M share 64M.  Which one gains more from memory
+// flips half way through.
+trace_t make_shifting_trace(unsigned intervals)
+{
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<uint64_t> meta_key(0, (96 << 20) / 4096 - 1);
+  std::uniform_int_distribution<uint64_t> data_key(0, (192 << 20) / 65536 - 1);
+  trace_t trace;
+  for (unsigned i = 0; i < intervals; ++i) {
+    bool meta_heavy = i < intervals / 2;
+    unsigned meta_ops = meta_heavy ? 100000 : 10000;
+    unsigned data_ops = meta_heavy ? 20000 : 200000;
+    for (unsigned n = 0; n < meta_ops; ++n) {
+      trace.push_back({0, meta_key(rng)});
+    }
+    for (unsigned n = 0; n < data_ops; ++n) {
+      trace.push_back({1, data_key(rng)});
+    }
+    trace.push_back({BALANCE, 0});
+  }
+  return trace;
+}
+
+bool load_trace(const std::string& path, trace_t *trace)
+{
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string cache;
+  while (in >> cache) {
+    if (cache == "balance") {
+      trace->push_back({BALANCE, 0});
+      continue;
+    }
+    uint64_t key;
+    if (!(in >> key)) {
+      return false;
+    }
+    trace->push_back({cache == "meta" ? 0u : 1u, key});
+  }
+  return true;
+}
+
+struct result_t {
+  uint64_t hits = 0;
+  uint64_t accesses = 0;
+  double meta_ratio_mid = 0;  // effective meta ratio half way through
+  double meta_ratio_end = 0;
+};
+
+result_t replay(const trace_t& trace, double utility_step)
+{
+  Manager mgr(g_ceph_context, MEM, MEM, MEM, false, "pricache_sim");
+  mgr.set_utility_step(utility_step);
+  std::vector<std::shared_ptr<SimCache>> caches = {
+    std::make_shared<SimCache>("meta", 4096, 0.5),
+    std::make_shared<SimCache>("data", 65536, 0.5),
+  };
+  for (auto& c : caches) {
+    mgr.insert(c->get_cache_name(), c, true);
+  }
+  mgr.balance();
+
+  unsigned intervals = 0;
+  for (auto& a : trace) {
+    intervals += a.cache == BALANCE;
+  }
+  result_t r;
+  unsigned interval = 0;
+  for (auto& a : trace) {
+    if (a.cache != BALANCE) {
+      caches[a.cache]->access(a.key);
+      continue;
+    }
+    mgr.balance();
+    if (++interval == intervals / 2) {
+      r.meta_ratio_mid = mgr.get_effective_ratio("meta");
+    }
+  }
+  r.meta_ratio_end = mgr.get_effective_ratio("meta");
+  for (auto& c : caches) {
+    r.hits += c->hits;
+    r.accesses += c->hits + c->misses;
+  }
+  return r;
+}
+
+void print(const std::string& policy, const result_t& r)
+{
+  std::cout << policy << ": hit ratio "
+	    << static_cast<double>(r.hits) / r.accesses
+	    << " meta ratio " << r.meta_ratio_mid << " -> "
+	    << r.meta_ratio_end << std::endl;
+}
+
+} // anonymous namespace
+
+TEST(PriorityCacheSim, UtilityFollowsWorkload)
+{
+  trace_t trace = make_shifting_trace(30);
+  result_t ratios = replay(trace, 0);
+  result_t utility = replay(trace, 0.05);
+  print("ratios", ratios);
+  print("utility", utility);
+
+  EXPECT_DOUBLE_EQ(0.5, ratios.meta_ratio_mid);
+  EXPECT_DOUBLE_EQ(0.5, ratios.meta_ratio_end);
+  // memory goes to the metadata cache first, then back to the data cache
+  EXPECT_GT(utility.meta_ratio_mid, 0.5);
+  EXPECT_LT(utility.meta_ratio_end, utility.meta_ratio_mid);
+  EXPECT_GT(utility.hits, ratios.hits);
+}
+
+TEST(PriorityCacheSim, ReplayTrace)
+{
+  const char *path = getenv("CEPH_PRIORITY_CACHE_TRACE");
+  if (!path) {
+    GTEST_SKIP() << "set CEPH_PRIORITY_CACHE_TRACE to replay a trace";
+  }
+  trace_t trace;
+  ASSERT_TRUE(load_trace(path, &trace));
+  for (double step : {0.0, 0.01, 0.02, 0.05, 0.1}) {
+    print("utility step " + std::to_string(step), replay(trace, step));
+  }
+}
@@ -0,0 +1,129 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "common/sharded_shared_mutex.h"
+
+TEST(ShardedSharedMutex, simple)
+{
+  ceph::sharded_shared_mutex mutex{"sharded::simple"};
+  {
+    std::unique_lock lock{mutex};
+    ASSERT_FALSE(mutex.try_lock());
+    ASSERT_FALSE(mutex.try_lock_shared());
+  }
+  {
+    std::shared_lock lock{mutex};
+    // readers do not exclude each other
+    ASSERT_TRUE(mutex.try_lock_shared());
+    mutex.unlock_shared();
+    ASSERT_FALSE(mutex.try_lock());
+  }
+  ASSERT_TRUE(mutex.try_lock());
+  mutex.unlock();
+}
+
+TEST(ShardedSharedMutex, shared_across_threads)
+{
+  // readers on other threads land in other slots, the writer has to wait
+  // for all of them
+  ceph::sharded_shared_mutex mutex{"sharded::across"};
+  const int NR_READERS = 8;
+  std::vector<std::thread> readers;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> nr_locked = 0;
+  for (int i = 0; i < NR_READERS; i++) {
+    readers.emplace_back([&] {
+      std::shared_lock lock{mutex};
+      nr_locked++;
+      released.wait();
+    });
+  }
+  while (nr_locked < NR_READERS) {
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(mutex.try_lock());
+  release.set_value();
+  for (auto& t : readers) {
+    t.join();
+  }
+  ASSERT_TRUE(mutex.try_lock());
+  mutex.unlock();
+}
+
+TEST(ShardedSharedMutex, writer_sleeps_until_drained)
+{
+  ceph::sharded_shared_mutex mutex{"sharded::drain"};
+  mutex.lock_shared();
+  std::atomic<bool> locked = false;
+  std::thread writer([&] {
+    std::unique_lock lock{mutex};
+    locked = true;
+  });
+  // the pending writer keeps new readers out
+  while (mutex.try_lock_shared()) {
+    mutex.unlock_shared();
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(locked);
+  // and is woken by the last reader to leave
+  mutex.unlock_shared();
+  writer.join();
+  ASSERT_TRUE(locked);
+}
+
+TEST(ShardedSharedMutex, unlock_on_other_thread)
+{
+  ceph::sharded_shared_mutex mutex{"sharded::handoff"};
+  mutex.lock_shared();
+  std::thread([&] { mutex.unlock_shared(); }).join();
+  ASSERT_TRUE(mutex.try_lock());
+  mutex.unlock();
+}
+
+TEST(ShardedSharedMutex, exclusive)
+{
+  // writers see no readers, and readers never see a half-done update
+  ceph::sharded_shared_mutex mutex{"sharded::exclusive"};
+  const int NR_THREADS = 8;
+  const int NR_ROUNDS = 2000;
+  uint64_t a = 0, b = 0;
+  std::atomic<int> nr_readers = 0;
+  std::atomic<bool> torn = false;
+  auto run = [&](int i) {
+    for (int n = 0; n < NR_ROUNDS; n++) {
+      if (n % NR_THREADS == i) {
+        std::unique_lock lock{mutex};
+        if (nr_readers != 0) {
+          torn = true;
+        }
+        a++;
+        b++;
+      } else {
+        std::shared_lock lock{mutex};
+        nr_readers++;
+        if (a != b) {
+          torn = true;
+        }
+        nr_readers--;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NR_THREADS; i++) {
+    threads.emplace_back(run, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(torn);
+  ASSERT_EQ(a, b);
+  // each thread writes once every NR_THREADS rounds
+  ASSERT_EQ(a, uint64_t(NR_ROUNDS));
+}
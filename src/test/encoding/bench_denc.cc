@@ -0,0 +1,176 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Throughput of encoding and decoding a few hot on-disk and on-wire
+ * types: fixed-layout types copied with WRITE_CLASS_DENC_RAW against the
+ * same layout encoded field by field, PG log entries, and (with
+ * BlueStore) onodes.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "include/denc.h"
+#include "include/utime.h"
+#include "osd/osd_types.h"
+#ifdef WITH_BLUESTORE
+#include "os/bluestore/bluestore_types.h"
+#endif
+
+using namespace std;
+using ceph::bufferlist;
+
+// eversion_t and utime_t as they were encoded before being declared raw
+struct eversion_fields_t {
+  version_t version = 0;
+  epoch_t epoch = 0;
+  DENC(eversion_fields_t, v, p) {
+    denc(v.version, p);
+    denc(v.epoch, p);
+  }
+};
+WRITE_CLASS_DENC_BOUNDED(eversion_fields_t)
+
+struct utime_fields_t {
+  __u32 sec = 0;
+  __u32 nsec = 0;
+  DENC(utime_fields_t, v, p) {
+    denc(v.sec, p);
+    denc(v.nsec, p);
+  }
+};
+WRITE_CLASS_DENC_BOUNDED(utime_fields_t)
+
+template<typename F>
+static void run(const string& name, unsigned iterations, F&& f)
+{
+  uint64_t bytes = 0;
+  auto start = chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i) {
+    bytes += f();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  cout << setw(36) << left << name
+       << setw(12) << right << fixed << setprecision(0)
+       << iterations / elapsed.count() << " ops/s "
+       << setw(10) << setprecision(1)
+       << bytes / elapsed.count() / (1 << 20) << " MB/s" << std::endl;
+}
+
+template<typename T>
+static void bench_container(const string& name, unsigned iterations,
+			    const T& v)
+{
+  run(name + " encode", iterations, [&] {
+    bufferlist bl;
+    encode(v, bl);
+    return bl.length();
+  });
+  bufferlist bl;
+  encode(v, bl);
+  bl.rebuild();
+  run(name + " decode", iterations, [&] {
+    T out;
+    auto p = bl.cbegin();
+    decode(out, p);
+    return bl.length();
+  });
+}
+
+static void bench_pg_log(unsigned iterations)
+{
+  constexpr unsigned num_entries = 64;
+  vector<pg_log_entry_t> entries;
+  for (unsigned i = 0; i < num_entries; ++i) {
+    hobject_t oid(object_t("rbd_data.1234567890ab." + to_string(i)), "",
+		  CEPH_NOSNAP, i * 7919, 3, "");
+    entries.emplace_back(pg_log_entry_t::MODIFY, oid,
+			 eversion_t(100, 1000 + i), eversion_t(100, 999 + i),
+			 1000 + i, osd_reqid_t(entity_name_t::CLIENT(4242), 0, i),
+			 utime_t(1700000000, i), 0);
+  }
+  run("pg_log_entry_t x64 encode", iterations, [&] {
+    bufferlist bl;
+    for (auto& e : entries) {
+      encode(e, bl);
+    }
+    return bl.length();
+  });
+  bufferlist bl;
+  for (auto& e : entries) {
+    encode(e, bl);
+  }
+  bl.rebuild();
+  run("pg_log_entry_t x64 decode", iterations, [&] {
+    auto p = bl.cbegin();
+    for (unsigned i = 0; i < num_entries; ++i) {
+      pg_log_entry_t e;
+      decode(e, p);
+    }
+    return bl.length();
+  });
+}
+
+#ifdef WITH_BLUESTORE
+static void bench_onode(unsigned iterations)
+{
+  bluestore_onode_t onode;
+  onode.nid = 123456789;
+  onode.size = 4 << 20;
+  onode.attrs["_"] = ceph::buffer::create(250);
+  onode.attrs["snapset"] = ceph::buffer::create(35);
+  for (auto& [k, v] : onode.attrs) {
+    v.zero();
+  }
+  for (uint32_t i = 0; i < 8; ++i) {
+    bluestore_onode_t::shard_info s;
+    s.offset = i << 19;
+    s.bytes = 500;
+    onode.extent_map_shards.push_back(s);
+  }
+  run("bluestore_onode_t encode", iterations, [&] {
+    bufferlist bl;
+    encode(onode, bl, 0);
+    return bl.length();
+  });
+  bufferlist bl;
+  encode(onode, bl, 0);
+  bl.rebuild();
+  run("bluestore_onode_t decode", iterations, [&] {
+    bluestore_onode_t out;
+    auto p = bl.front().begin();
+    denc(out, p);
+    return bl.length();
+  });
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  unsigned iterations = argc > 1 ? atoi(argv[1]) : 100000;
+  if (iterations == 0) {
+    cerr << "usage: " << argv[0] << " [iterations]" << std::endl;
+    return 1;
+  }
+
+  constexpr size_t n = 256;
+  bench_container("vector<eversion_fields_t> x256", iterations,
+		  vector<eversion_fields_t>(n));
+  bench_container("vector<eversion_t> x256", iterations,
+		  vector<eversion_t>(n));
+  bench_container("vector<utime_fields_t> x256", iterations,
+		  vector<utime_fields_t>(n));
+  bench_container("vector<utime_t> x256", iterations, vector<utime_t>(n));
+  bench_container("vector<uint64_t> x256", iterations, vector<uint64_t>(n));
+
+  bench_pg_log(iterations / 10);
+#ifdef WITH_BLUESTORE
+  bench_onode(iterations);
+#endif
+  return 0;
+}
@@ -0,0 +1,294 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Drives reads of a cloned image through the parent cache.  A parent image
+ * is written, snapshotted and cloned; the clone is then read a number of
+ * times from several threads with a uniform, sequential or zipf (hot
+ * object) access pattern and the throughput of every pass is reported.
+ * The first pass populates the cache, later passes show the hit path.
+ *
+ * Needs a running cluster and a ceph-immutable-object-cache daemon on the
+ * same host (e.g. a vstart cluster); the daemon's policy and the client's
+ * immutable_object_cache_client_mmap_max_size can be varied through the
+ * usual configuration to compare setups.
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/errno.h"
+#include "include/rados/librados.hpp"
+#include "include/rbd/librbd.hpp"
+
+using namespace std;
+
+namespace {
+
+struct Options {
+  string pool = "rbd";
+  uint64_t image_size = 1ULL << 30;
+  int order = 22;
+  uint64_t io_size = 4096;
+  uint64_t ios = 100000;
+  int threads = 8;
+  int passes = 3;
+  string pattern = "zipf";
+};
+
+class OffsetGenerator {
+public:
+  OffsetGenerator(const Options& opts, unsigned seed)
+    : m_opts(opts), m_rng(seed),
+      m_object_size(1ULL << opts.order),
+      m_num_objects(opts.image_size / m_object_size) {
+    if (opts.pattern == "zipf") {
+      vector<double> weights;
+      for (uint64_t i = 0; i < m_num_objects; ++i) {
+	weights.push_back(1.0 / pow(i + 1, 0.99));
+      }
+      m_zipf = discrete_distribution<uint64_t>(weights.begin(), weights.end());
+    }
+  }
+
+  uint64_t next() {
+    uint64_t ios_per_object = m_object_size / m_opts.io_size;
+    if (m_opts.pattern == "seq") {
+      uint64_t offset = m_next_offset;
+      m_next_offset = (m_next_offset + m_opts.io_size) % m_opts.image_size;
+      return offset;
+    }
+    uint64_t object_no;
+    if (m_opts.pattern == "zipf") {
+      // scatter the hot objects over the image
+      object_no = (m_zipf(m_rng) * 2654435761ULL) % m_num_objects;
+    } else {
+      object_no = uniform_int_distribution<uint64_t>(
+	0, m_num_objects - 1)(m_rng);
+    }
+    uint64_t io_no = uniform_int_distribution<uint64_t>(
+      0, ios_per_object - 1)(m_rng);
+    return object_no * m_object_size + io_no * m_opts.io_size;
+  }
+
+private:
+  const Options& m_opts;
+  mt19937_64 m_rng;
+  uint64_t m_object_size;
+  uint64_t m_num_objects;
+  uint64_t m_next_offset = 0;
+  discrete_distribution<uint64_t> m_zipf;
+};
+
+int prepare_images(librados::IoCtx& ioctx, const Options& opts,
+		   const string& parent_name, const string& clone_name)
+{
+  librbd::RBD rbd;
+  int order = opts.order;
+  int r = rbd.create2(ioctx, parent_name.c_str(), opts.image_size,
+		      RBD_FEATURE_LAYERING, &order);
+  if (r < 0) {
+    cerr << "failed to create parent image: " << cpp_strerror(r) << std::endl;
+    return r;
+  }
+
+  librbd::Image parent;
+  r = rbd.open(ioctx, parent, parent_name.c_str());
+  if (r < 0) {
+    cerr << "failed to open parent image: " << cpp_strerror(r) << std::endl;
+    return r;
+  }
+  uint64_t object_size = 1ULL << opts.order;
+  for (uint64_t off = 0; off < opts.image_size; off += object_size) {
+    ceph::bufferlist bl;
+    bl.append(string(object_size, 'a' + (off / object_size) % 26));
+    if (parent.write(off, object_size, bl) < 0) {
+      cerr << "failed to write parent image" << std::endl;
+      return -EIO;
+    }
+  }
+  r = parent.snap_create("snap");
+  if (r == 0) {
+    r = parent.snap_protect("snap");
+  }
+  parent.close();
+  if (r < 0) {
+    cerr << "failed to snapshot parent image: " << cpp_strerror(r)
+	 << std::endl;
+    return r;
+  }
+
+  order = opts.order;
+  r = rbd.clone(ioctx, parent_name.c_str(), "snap", ioctx,
+		clone_name.c_str(), RBD_FEATURE_LAYERING, &order);
+  if (r < 0) {
+    cerr << "failed to clone image: " << cpp_strerror(r) << std::endl;
+  }
+  return r;
+}
+
+void remove_images(librados::IoCtx& ioctx, const string& parent_name,
+		   const string& clone_name)
+{
+  librbd::RBD rbd;
+  rbd.remove(ioctx, clone_name.c_str());
+
+  librbd::Image parent;
+  if (rbd.open(ioctx, parent, parent_name.c_str()) == 0) {
+    parent.snap_unprotect("snap");
+    parent.snap_remove("snap");
+    parent.close();
+  }
+  rbd.remove(ioctx, parent_name.c_str());
+}
+
+int run_pass(librados::IoCtx& ioctx, const Options& opts,
+	     const string& clone_name, int pass)
+{
+  librbd::RBD rbd;
+  librbd::Image clone;
+  int r = rbd.open(ioctx, clone, clone_name.c_str());
+  if (r < 0) {
+    cerr << "failed to open clone: " << cpp_strerror(r) << std::endl;
+    return r;
+  }
+
+  atomic<uint64_t> errors = 0;
+  vector<thread> threads;
+  uint64_t ios_per_thread = opts.ios / opts.threads;
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < opts.threads; ++t) {
+    threads.emplace_back([&, t] {
+      OffsetGenerator offsets(opts, pass * opts.threads + t);
+      for (uint64_t i = 0; i < ios_per_thread; ++i) {
+	ceph::bufferlist bl;
+	if (clone.read(offsets.next(), opts.io_size, bl) !=
+	      (ssize_t)opts.io_size) {
+	  ++errors;
+	}
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  clone.close();
+
+  uint64_t ios = ios_per_thread * opts.threads;
+  cout << "pass " << pass << ": " << uint64_t(ios / elapsed.count())
+       << " IOPS, " << uint64_t(ios * opts.io_size / elapsed.count() /
+				(1 << 20))
+       << " MiB/s";
+  if (errors > 0) {
+    cout << ", " << errors << " failed reads";
+  }
+  cout << std::endl;
+  return errors > 0 ? -EIO : 0;
+}
+
+void usage(const char* name)
+{
+  cerr << "usage: " << name << " [--pool NAME] [--image-size MB]"
+       << " [--order N] [--io-size BYTES] [--ios N] [--threads N]"
+       << " [--passes N] [--pattern rand|seq|zipf]" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  Options opts;
+  int image_size_mb = opts.image_size >> 20;
+  int io_size = opts.io_size;
+  int ios = opts.ios;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &opts.pool, "--pool", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &opts.pattern, "--pattern",
+			      (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &image_size_mb, err,
+				     "--image-size", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &opts.order, err, "--order",
+				     (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &io_size, err, "--io-size",
+				     (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &ios, err, "--ios",
+				     (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &opts.threads, err, "--threads",
+				     (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &opts.passes, err, "--passes",
+				     (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return 1;
+      }
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  opts.image_size = uint64_t(image_size_mb) << 20;
+  opts.io_size = io_size;
+  opts.ios = ios;
+  if (opts.order < 12 || opts.order > 25 || opts.io_size == 0 ||
+      (1ULL << opts.order) % opts.io_size != 0 ||
+      opts.image_size < (1ULL << opts.order) || opts.threads < 1 ||
+      (opts.pattern != "rand" && opts.pattern != "seq" &&
+       opts.pattern != "zipf")) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  librados::Rados rados;
+  int r = rados.init_with_context(nullptr);
+  if (r == 0) {
+    r = rados.conf_read_file(nullptr);
+  }
+  if (r == 0) {
+    rados.conf_parse_env(nullptr);
+    r = rados.conf_set("rbd_parent_cache_enabled", "true");
+  }
+  if (r == 0) {
+    r = rados.conf_set("rbd_plugins", "parent_cache");
+  }
+  if (r == 0) {
+    r = rados.connect();
+  }
+  if (r < 0) {
+    cerr << "failed to connect to cluster: " << cpp_strerror(r) << std::endl;
+    return 1;
+  }
+
+  librados::IoCtx ioctx;
+  r = rados.ioctx_create(opts.pool.c_str(), ioctx);
+  if (r < 0) {
+    cerr << "failed to open pool " << opts.pool << ": " << cpp_strerror(r)
+	 << std::endl;
+    return 1;
+  }
+
+  string suffix = std::to_string(getpid());
+  string parent_name = "bench_parent_cache_parent_" + suffix;
+  string clone_name = "bench_parent_cache_clone_" + suffix;
+  r = prepare_images(ioctx, opts, parent_name, clone_name);
+  if (r == 0) {
+    cout << opts.pattern << " reads of " << opts.io_size << " bytes, "
+	 << opts.threads << " threads" << std::endl;
+    for (int pass = 0; pass < opts.passes && r == 0; ++pass) {
+      r = run_pass(ioctx, opts, clone_name, pass);
+    }
+  }
+  remove_images(ioctx, parent_name, clone_name);
+  return r < 0 ? 1 : 0;
+}
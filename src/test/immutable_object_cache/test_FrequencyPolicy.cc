@@ -0,0 +1,131 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <list>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "include/Context.h"
+#include "tools/immutable_object_cache/FrequencyPolicy.h"
+
+using namespace ceph::immutable_obj_cache;
+
+class TestFrequencyPolicy :public ::testing::Test {
+public:
+  FrequencyPolicy* m_policy;
+  const uint64_t m_cache_size = 100;
+
+  void SetUp() override {
+    m_policy = new FrequencyPolicy(g_ceph_context, m_cache_size, 128, 0.9);
+  }
+  void TearDown() override {
+    delete m_policy;
+  }
+
+  std::string file_name(uint64_t index) {
+    return "object_cache_file_" + std::to_string(index);
+  }
+
+  void promote(const std::string& cache_file_name) {
+    ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object(cache_file_name));
+    ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->get_status(cache_file_name));
+    m_policy->update_status(cache_file_name, OBJ_CACHE_PROMOTED, 1);
+    ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->get_status(cache_file_name));
+  }
+
+  // fill the cache up to the watermark
+  void fill() {
+    for (uint64_t i = 0; i < m_cache_size * 0.9; ++i) {
+      promote(file_name(i));
+    }
+  }
+};
+
+TEST_F(TestFrequencyPolicy, test_lookup_miss_and_have_free) {
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object("file"));
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->get_status("file"));
+  ASSERT_EQ(1U, m_policy->get_promoting_entry_num());
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_object("file"));
+}
+
+TEST_F(TestFrequencyPolicy, test_promote_and_evict) {
+  promote("file");
+  ASSERT_EQ(0U, m_policy->get_promoting_entry_num());
+  ASSERT_EQ(1U, m_policy->get_promoted_entry_num());
+  ASSERT_EQ(m_cache_size - 1, m_policy->get_free_size());
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_object("file"));
+
+  m_policy->evict_entry("file");
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status("file"));
+  ASSERT_EQ(0U, m_policy->get_promoted_entry_num());
+  ASSERT_EQ(m_cache_size, m_policy->get_free_size());
+}
+
+TEST_F(TestFrequencyPolicy, test_promote_failed) {
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object("file"));
+  m_policy->update_status("file", OBJ_CACHE_NONE);
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status("file"));
+  ASSERT_EQ(0U, m_policy->get_promoting_entry_num());
+  ASSERT_EQ(m_cache_size, m_policy->get_free_size());
+}
+
+TEST_F(TestFrequencyPolicy, test_admission_above_watermark) {
+  fill();
+  // every cached object has been looked up once, a second lookup makes
+  // an object hotter than all of them
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_object("cold_file"));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status("cold_file"));
+  ASSERT_EQ(1U, m_policy->get_frequency("cold_file"));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object("cold_file"));
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->get_status("cold_file"));
+}
+
+TEST_F(TestFrequencyPolicy, test_lookup_miss_and_no_free) {
+  fill();
+  for (uint64_t i = m_cache_size * 0.9; i < m_cache_size; ++i) {
+    ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_object(file_name(i)));
+    ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object(file_name(i)));
+    m_policy->update_status(file_name(i), OBJ_CACHE_PROMOTED, 1);
+  }
+  ASSERT_EQ(0U, m_policy->get_free_size());
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_object("file"));
+  }
+}
+
+TEST_F(TestFrequencyPolicy, test_evict_list_0) {
+  fill();
+  std::list<std::string> evict_entry_list;
+  m_policy->get_evict_list(&evict_entry_list);
+  ASSERT_TRUE(evict_entry_list.empty());
+}
+
+TEST_F(TestFrequencyPolicy, test_evict_least_frequently_used) {
+  fill();
+  // make all but the last ten objects hot
+  for (uint64_t i = 0; i < m_cache_size * 0.9 - 10; ++i) {
+    ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->lookup_object(file_name(i)));
+  }
+  ASSERT_EQ(OBJ_CACHE_SKIP, m_policy->lookup_object("new_file"));
+  ASSERT_EQ(OBJ_CACHE_NONE, m_policy->lookup_object("new_file"));
+  m_policy->update_status("new_file", OBJ_CACHE_PROMOTED, 1);
+
+  std::list<std::string> evict_entry_list;
+  m_policy->get_evict_list(&evict_entry_list);
+  // down to 10% below the watermark, coldest (least recently used) first
+  ASSERT_EQ(11U, evict_entry_list.size());
+  uint64_t index = m_cache_size * 0.9 - 10;
+  auto it = evict_entry_list.begin();
+  for (int i = 0; i < 10; ++i, ++it, ++index) {
+    ASSERT_EQ(file_name(index), *it);
+  }
+  ASSERT_EQ(file_name(0), *it);
+
+  for (auto& evict_entry : evict_entry_list) {
+    m_policy->update_status(evict_entry, OBJ_CACHE_SKIP);
+    m_policy->evict_entry(evict_entry);
+    ASSERT_EQ(OBJ_CACHE_NONE, m_policy->get_status(evict_entry));
+  }
+  ASSERT_EQ(OBJ_CACHE_PROMOTED, m_policy->get_status("new_file"));
+  ASSERT_EQ(m_cache_size - 80, m_policy->get_free_size());
+}
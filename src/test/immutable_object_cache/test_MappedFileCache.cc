@@ -0,0 +1,120 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <unistd.h>
+#include <filesystem>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "include/buffer.h"
+#include "global/global_context.h"
+#include "tools/immutable_object_cache/MappedFileCache.h"
+
+namespace fs = std::filesystem;
+using namespace ceph::immutable_obj_cache;
+
+class TestMappedFileCache : public ::testing::Test {
+public:
+  fs::path m_dir;
+
+  void SetUp() override {
+    m_dir = fs::temp_directory_path() /
+      ("test_mapped_file_cache_" + std::to_string(getpid()));
+    fs::create_directories(m_dir);
+  }
+  void TearDown() override {
+    fs::remove_all(m_dir);
+  }
+
+  std::string write_file(const std::string& name, const std::string& data) {
+    std::string path = m_dir / name;
+    ceph::bufferlist bl;
+    bl.append(data);
+    EXPECT_EQ(0, bl.write_file(path.c_str()));
+    return path;
+  }
+};
+
+TEST_F(TestMappedFileCache, Read) {
+  MappedFileCache cache(g_ceph_context, 1 << 20);
+  auto path = write_file("file", std::string(4096, '1') +
+                                 std::string(4096, '2'));
+
+  ceph::bufferlist bl1;
+  ASSERT_EQ(4096, cache.read(path, 2048, 4096, &bl1));
+  ASSERT_EQ(std::string(2048, '1') + std::string(2048, '2'), bl1.to_str());
+
+  // short read at the end of the file
+  ceph::bufferlist bl2;
+  ASSERT_EQ(1024, cache.read(path, 7168, 4096, &bl2));
+  ASSERT_EQ(std::string(1024, '2'), bl2.to_str());
+
+  ceph::bufferlist bl3;
+  ASSERT_EQ(0, cache.read(path, 8192, 4096, &bl3));
+  ASSERT_EQ(0U, bl3.length());
+
+  ASSERT_EQ(1U, cache.get_mapped_file_num());
+  ASSERT_EQ(8192U, cache.get_mapped_size());
+}
+
+TEST_F(TestMappedFileCache, ReadMissingFile) {
+  MappedFileCache cache(g_ceph_context, 1 << 20);
+  ceph::bufferlist bl;
+  ASSERT_EQ(-ENOENT, cache.read((m_dir / "missing").string(), 0, 4096, &bl));
+  ASSERT_EQ(0U, cache.get_mapped_file_num());
+}
+
+TEST_F(TestMappedFileCache, ReadEvictedFile) {
+  MappedFileCache cache(g_ceph_context, 1 << 20);
+  auto path = write_file("file", std::string(4096, '1'));
+
+  ceph::bufferlist bl1;
+  ASSERT_EQ(4096, cache.read(path, 0, 4096, &bl1));
+  fs::remove(path);
+
+  // still served from the mapping
+  ceph::bufferlist bl2;
+  ASSERT_EQ(4096, cache.read(path, 0, 4096, &bl2));
+  ASSERT_EQ(std::string(4096, '1'), bl2.to_str());
+
+  // buffers stay valid after the mapping is dropped
+  cache.clear();
+  ASSERT_EQ(std::string(4096, '1'), bl1.to_str());
+}
+
+TEST_F(TestMappedFileCache, Trim) {
+  MappedFileCache cache(g_ceph_context, 8192);
+  auto path1 = write_file("file1", std::string(4096, '1'));
+  auto path2 = write_file("file2", std::string(4096, '2'));
+  auto path3 = write_file("file3", std::string(4096, '3'));
+
+  ceph::bufferlist bl;
+  ASSERT_EQ(4096, cache.read(path1, 0, 4096, &bl));
+  ASSERT_EQ(4096, cache.read(path2, 0, 4096, &bl));
+  ASSERT_EQ(4096, cache.read(path1, 0, 4096, &bl));
+  ASSERT_EQ(4096, cache.read(path3, 0, 4096, &bl));
+  ASSERT_EQ(2U, cache.get_mapped_file_num());
+  ASSERT_EQ(8192U, cache.get_mapped_size());
+
+  // file2 was the least recently used one
+  fs::remove(path2);
+  ASSERT_EQ(4096, cache.read(path1, 0, 4096, &bl));
+  ASSERT_EQ(-ENOENT, cache.read(path2, 0, 4096, &bl));
+  ASSERT_EQ(std::string(4096, '1') + std::string(4096, '2') +
+            std::string(4096, '1') + std::string(4096, '3') +
+            std::string(4096, '1'), bl.to_str());
+}
+
+TEST_F(TestMappedFileCache, ModifyBuffer) {
+  MappedFileCache cache(g_ceph_context, 1 << 20);
+  auto path = write_file("file", std::string(4096, '1'));
+
+  ceph::bufferlist bl1;
+  ASSERT_EQ(4096, cache.read(path, 0, 4096, &bl1));
+  memset(bl1.c_str(), '2', 4096);
+
+  ceph::bufferlist bl2;
+  std::string error;
+  ASSERT_EQ(0, bl2.read_file(path.c_str(), &error));
+  ASSERT_EQ(std::string(4096, '1'), bl2.to_str());
+}
@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_fixture.h"
+#include "test/librbd/test_support.h"
+#include "common/numa.h"
+#include "librbd/asio/NumaPool.h"
+#include <future>
+#include <map>
+#include <pthread.h>
+
+namespace librbd {
+namespace asio {
+
+namespace {
+
+NumaPool::NodeCpus make_node(int id, const char* cpus) {
+  NumaPool::NodeCpus node{id};
+  parse_cpu_set_list(cpus, &node.cpu_set_size, &node.cpu_set);
+  return node;
+}
+
+} // anonymous namespace
+
+class TestNumaPool : public TestFixture {
+public:
+  void SetUp() override {
+    TestFixture::SetUp();
+    m_cct = reinterpret_cast<CephContext*>(m_ioctx.cct());
+  }
+
+  CephContext *m_cct;
+};
+
+TEST_F(TestNumaPool, DiscoverNodes) {
+  // node 1 has memory only, node 2 is offline and node 5 is gone
+  std::map<int, std::string> cpus = {{0, "0-1"}, {1, ""}, {3, "2-3"}};
+  auto get_node_cpu_set = [&cpus](int id, size_t* cpu_set_size,
+				  cpu_set_t* cpu_set) {
+    auto it = cpus.find(id);
+    if (it == cpus.end()) {
+      return -ENOENT;
+    }
+    return parse_cpu_set_list(it->second.c_str(), cpu_set_size, cpu_set);
+  };
+
+  auto nodes = NumaPool::discover_nodes({0, 1, 3, 5}, get_node_cpu_set);
+  ASSERT_EQ(2U, nodes.size());
+  ASSERT_EQ(0, nodes[0].id);
+  ASSERT_EQ("0-1", cpu_set_to_str_list(nodes[0].cpu_set_size,
+				       &nodes[0].cpu_set));
+  ASSERT_EQ(3, nodes[1].id);
+  ASSERT_EQ("2-3", cpu_set_to_str_list(nodes[1].cpu_set_size,
+				       &nodes[1].cpu_set));
+}
+
+TEST_F(TestNumaPool, CpuNode) {
+  NumaPool pool(m_cct, 1, {make_node(2, "0-1"), make_node(7, "4")});
+  ASSERT_EQ(2U, pool.get_node_count());
+  ASSERT_EQ(2, pool.get_cpu_node(0));
+  ASSERT_EQ(2, pool.get_cpu_node(1));
+  ASSERT_EQ(-1, pool.get_cpu_node(2));
+  ASSERT_EQ(7, pool.get_cpu_node(4));
+  ASSERT_EQ(-1, pool.get_cpu_node(5));
+  ASSERT_EQ(-1, pool.get_cpu_node(-1));
+}
+
+TEST_F(TestNumaPool, PostToLocalNode) {
+  cpu_set_t cpu_set;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpu_set), &cpu_set));
+  auto cpus = cpu_set_to_str_list(sizeof(cpu_set), &cpu_set);
+
+  // whichever CPU we run on, it belongs to the only node
+  NumaPool pool(m_cct, 1, {make_node(3, cpus.c_str())});
+  std::promise<std::string> thread_name;
+  auto f = [&thread_name] {
+    char name[16] = {};
+    ceph_pthread_getname(name, sizeof(name));
+    thread_name.set_value(name);
+  };
+  ASSERT_TRUE(pool.post(f));
+  ASSERT_EQ("rbd_numa3", thread_name.get_future().get());
+
+  NumaPool empty_pool(m_cct, 1, {});
+  bool called = false;
+  auto g = [&called] { called = true; };
+  ASSERT_FALSE(empty_pool.post(g));
+  ASSERT_FALSE(called);
+}
+
+} // namespace asio
+} // namespace librbd
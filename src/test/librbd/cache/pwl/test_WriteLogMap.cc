@@ -6,6 +6,10 @@
 
 #include "librbd/cache/pwl/LogMap.cc"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 void register_test_write_log_map() {
 }
 
@@ -333,6 +337,88 @@ TEST_F(TestWriteLogMap, OverlapSplit) {
   ASSERT_EQ(8, found0.front().block_extent.block_end);
 }
 
+TEST_F(TestWriteLogMap, ShardedAcrossStripes) {
+  TestLogMap map(m_cct, 4);
+  const uint64_t stripe = TestLogMap::STRIPE_SIZE;
+
+  /* Spans the end of stripe 0 and the start of stripe 1 */
+  auto e0 = make_shared<TestLogEntry>(stripe - 4, 8);
+  map.add_log_entry(e0);
+  ASSERT_EQ(2, e0->get_map_ref());
+
+  TestLogMapEntries found0 = map.find_map_entries(BlockExtent(0, 2 * stripe));
+  ASSERT_EQ(2, found0.size());
+  ASSERT_EQ(e0, found0.front().log_entry);
+  ASSERT_EQ(stripe - 4, found0.front().block_extent.block_start);
+  ASSERT_EQ(stripe, found0.front().block_extent.block_end);
+  found0.pop_front();
+  ASSERT_EQ(e0, found0.front().log_entry);
+  ASSERT_EQ(stripe, found0.front().block_extent.block_start);
+  ASSERT_EQ(stripe + 4, found0.front().block_extent.block_end);
+
+  /* Overwrites the part of e0 in stripe 1 only */
+  auto e1 = make_shared<TestLogEntry>(stripe, 4);
+  map.add_log_entry(e1);
+  ASSERT_EQ(1, e0->get_map_ref());
+  TestLogEntries found1 = map.find_log_entries(BlockExtent(stripe - 8,
+                                                           stripe + 8));
+  ASSERT_EQ(2, found1.size());
+  ASSERT_EQ(e0, found1.front());
+  ASSERT_EQ(e1, found1.back());
+
+  /* Stripe 4 maps to the same shard as stripe 0 */
+  auto e2 = make_shared<TestLogEntry>(4 * stripe, 8);
+  map.add_log_entry(e2);
+  TestLogMapEntries found2 = map.find_map_entries(BlockExtent(0, 8 * stripe));
+  ASSERT_EQ(3, found2.size());
+  ASSERT_EQ(e2, found2.back().log_entry);
+
+  map.remove_log_entry(e0);
+  ASSERT_EQ(0, e0->get_map_ref());
+  map.remove_log_entry(e1);
+  map.remove_log_entry(e2);
+  ASSERT_EQ(0, map.find_map_entries(BlockExtent(0, 8 * stripe)).size());
+}
+
+TEST_F(TestWriteLogMap, DISABLED_ConcurrentReadWrite) {
+  /* Writers replace and readers look up random 4K blocks of a 1G image,
+   * the way the write log does for cache writes and reads */
+  const uint64_t image_size = 1ULL << 30;
+  const uint64_t block_size = 4096;
+  const int num_threads = 8;
+  const int ops_per_thread = 200000;
+
+  for (uint32_t num_shards : {1, 16, 64}) {
+    TestLogMap map(m_cct, num_shards);
+    std::atomic<uint64_t> hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        uint64_t seed = t + 1;
+        for (int i = 0; i < ops_per_thread; ++i) {
+          seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+          uint64_t off = (seed >> 16) % (image_size / block_size) * block_size;
+          if (i % 4 == 0) {
+            map.add_log_entry(make_shared<TestLogEntry>(off, block_size));
+          } else {
+            hits += map.find_map_entries(
+              BlockExtent(off, off + block_size)).size();
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    std::cout << num_shards << " shards: "
+              << num_threads * ops_per_thread / elapsed.count() << " ops/s, "
+              << hits << " hits" << std::endl;
+  }
+}
+
 } // namespace pwl
 } // namespace cache
 } // namespace librbd
@@ -1,7 +1,9 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <chrono>
 #include <iostream>
+#include <list>
 #include "common/hostname.h"
 #include "test/librbd/test_mock_fixture.h"
 #include "test/librbd/test_support.h"
@@ -756,6 +758,58 @@ TEST_F(TestMockCacheSSDWriteLog, flush_source_user) {
   ASSERT_EQ(0, finish_ctx4.wait());
 }
 
+// 4K writes per second through a file-backed cache whose writeback target
+// is the librados test stub, for a few queue depths and block map shard
+// counts; run with --gtest_also_run_disabled_tests.
+TEST_F(TestMockCacheSSDWriteLog, DISABLED_write_iops) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  const uint64_t block_count = m_image_size / 4096;
+  constexpr int writes = 20000;
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  for (auto shards : {"1", "16"}) {
+    ictx->config.set_val("rbd_persistent_cache_log_map_shards", shards);
+    for (int queue_depth : {1, 16, 64}) {
+      MockImageCtx mock_image_ctx(*ictx);
+      MockImageWriteback mock_image_writeback(mock_image_ctx);
+      MockApi mock_api;
+      MockSSDWriteLog ssd(
+          mock_image_ctx, get_cache_state(mock_image_ctx, mock_api),
+          mock_image_writeback, mock_api);
+      expect_op_work_queue(mock_image_ctx);
+      expect_metadata_set(mock_image_ctx);
+
+      C_SaferCond init_ctx;
+      ssd.init(&init_ctx);
+      ASSERT_EQ(0, init_ctx.wait());
+
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < writes; i += queue_depth) {
+        std::list<C_SaferCond> write_ctxs;
+        for (int j = i; j < std::min(writes, i + queue_depth); ++j) {
+          auto& write_ctx = write_ctxs.emplace_back();
+          ssd.write({{(j % block_count) * 4096, 4096}}, bufferlist{bl}, 0,
+                    &write_ctx);
+        }
+        for (auto& write_ctx : write_ctxs) {
+          ASSERT_EQ(0, write_ctx.wait());
+        }
+      }
+      std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+      std::cout << shards << " map shards, queue depth " << queue_depth
+                << ": " << (uint64_t)(writes / elapsed.count())
+                << " writes/sec" << std::endl;
+
+      C_SaferCond shut_down_ctx;
+      ssd.shut_down(&shut_down_ctx);
+      ASSERT_EQ(0, shut_down_ctx.wait());
+    }
+  }
+}
+
 } // namespace pwl
 } // namespace cache
 } // namespace librbd
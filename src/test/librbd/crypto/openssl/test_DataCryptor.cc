@@ -105,6 +105,41 @@ TEST_F(TestCryptoOpensslDataCryptor, ReuseContext) {
   cryptor->return_context(ctx2, CipherMode::CIPHER_MODE_ENC);
 }
 
+TEST_F(TestCryptoOpensslDataCryptor, CryptBlocks) {
+  const uint32_t block_size = 512;
+  const uint64_t sector_number = 0x1230;
+  auto ctx = cryptor->get_context(CipherMode::CIPHER_MODE_ENC);
+  ASSERT_NE(ctx, nullptr);
+
+  unsigned char out[sizeof(TEST_DATA)];
+  ASSERT_EQ(sizeof(TEST_DATA),
+            cryptor->crypt_blocks(ctx, TEST_DATA, out, block_size,
+                                  sizeof(TEST_DATA) / block_size,
+                                  sector_number));
+
+  unsigned char expected[sizeof(TEST_DATA)];
+  for (uint32_t i = 0; i < sizeof(TEST_DATA) / block_size; ++i) {
+    unsigned char iv[16] = {};
+    auto sector_le = ceph_le64(sector_number + i);
+    memcpy(iv, &sector_le, sizeof(sector_le));
+    ASSERT_EQ(0, cryptor->init_context(ctx, iv, sizeof(iv)));
+    ASSERT_EQ(block_size,
+              cryptor->update_context(ctx, TEST_DATA + i * block_size,
+                                      expected + i * block_size, block_size));
+  }
+  ASSERT_EQ(0, memcmp(out, expected, sizeof(TEST_DATA)));
+  cryptor->return_context(ctx, CipherMode::CIPHER_MODE_ENC);
+
+  ctx = cryptor->get_context(CipherMode::CIPHER_MODE_DEC);
+  ASSERT_NE(ctx, nullptr);
+  ASSERT_EQ(sizeof(TEST_DATA),
+            cryptor->crypt_blocks(ctx, out, out, block_size,
+                                  sizeof(TEST_DATA) / block_size,
+                                  sector_number));
+  ASSERT_EQ(0, memcmp(out, TEST_DATA, sizeof(TEST_DATA)));
+  cryptor->return_context(ctx, CipherMode::CIPHER_MODE_DEC);
+}
+
 TEST_F(TestCryptoOpensslDataCryptor, InvalidIVLength) {
   auto ctx = cryptor->get_context(CipherMode::CIPHER_MODE_ENC);
   ASSERT_NE(ctx, nullptr);
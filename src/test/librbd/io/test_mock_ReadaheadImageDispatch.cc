@@ -0,0 +1,325 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "common/Cond.h"
+#include "librbd/io/AioCompletion.h"
+#include "librbd/io/ImageDispatchSpec.h"
+#include "librbd/io/ReadaheadImageDispatch.h"
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+} // anonymous namespace
+
+namespace util {
+
+inline ImageCtx *get_image_ctx(MockTestImageCtx *image_ctx) {
+  return image_ctx->image_ctx;
+}
+
+} // namespace util
+} // namespace librbd
+
+#include "librbd/io/ReadaheadImageDispatch.cc"
+
+namespace librbd {
+namespace io {
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Invoke;
+using ::testing::Return;
+
+struct TestMockIoReadaheadImageDispatch : public TestMockFixture {
+  typedef ReadaheadImageDispatch<librbd::MockTestImageCtx>
+    MockReadaheadImageDispatch;
+
+  static const uint64_t IMAGE_SIZE = 1 << 24;
+
+  librbd::ImageCtx *m_ictx = nullptr;
+  ceph::bufferlist m_image_bl;
+
+  void SetUp() override {
+    TestMockFixture::SetUp();
+
+    ASSERT_EQ(0, open_image(m_image_name, &m_ictx));
+    m_ictx->config.set_val("rbd_readahead_buffer_bytes", "4194304");
+    m_ictx->config.set_val("rbd_readahead_trigger_requests", "2");
+    m_ictx->config.set_val("rbd_readahead_max_streams", "2");
+
+    for (uint64_t i = 0; i < (1 << 20); ++i) {
+      m_image_bl.append(static_cast<char>(i % 251));
+    }
+  }
+
+  void init_image_ctx(MockTestImageCtx &mock_image_ctx) {
+    mock_image_ctx.readahead_max_bytes = 512 * 1024;
+    mock_image_ctx.readahead_disable_after_bytes = 0;
+
+    EXPECT_CALL(mock_image_ctx, get_area_size(ImageArea::DATA))
+      .WillRepeatedly(Return(IMAGE_SIZE));
+    expect_op_work_queue(mock_image_ctx);
+  }
+
+  void expect_prefetch(MockTestImageCtx &mock_image_ctx, uint64_t offset,
+                       uint64_t length, Context** on_read) {
+    EXPECT_CALL(*mock_image_ctx.io_image_dispatcher, send(_))
+      .WillOnce(Invoke([this, offset, length, on_read](ImageDispatchSpec* spec) {
+          auto* read = std::get_if<ImageDispatchSpec::Read>(&spec->request);
+          ASSERT_TRUE(read != nullptr);
+          ASSERT_EQ(IMAGE_DISPATCH_LAYER_READAHEAD, spec->dispatch_layer);
+
+          ASSERT_EQ(1U, spec->image_extents.size());
+          ASSERT_EQ(offset, spec->image_extents[0].first);
+          ASSERT_EQ(length, spec->image_extents[0].second);
+
+          spec->dispatch_result = DISPATCH_RESULT_COMPLETE;
+          auto aio_comp = spec->aio_comp;
+          aio_comp->set_request_count(1);
+          aio_comp->read_result = std::move(read->read_result);
+          aio_comp->read_result.set_image_extents(spec->image_extents);
+          auto ctx = new ReadResult::C_ImageReadRequest(
+            aio_comp, 0, spec->image_extents);
+          ctx->bl.substr_of(m_image_bl, offset, length);
+          *on_read = ctx;
+        }));
+  }
+
+  struct TestRead {
+    C_SaferCond ctx;
+    ceph::bufferlist bl;
+    ReadResult read_result{&bl};
+    AioCompletion* aio_comp = nullptr;
+  };
+
+  bool read(MockReadaheadImageDispatch &mock_readahead_image_dispatch,
+            uint64_t offset, uint64_t length, TestRead* test_read,
+            DispatchResult* dispatch_result,
+            Context* on_dispatched = nullptr) {
+    test_read->aio_comp = AioCompletion::create_and_start(
+      &test_read->ctx, m_ictx, AIO_TYPE_READ);
+    std::atomic<uint32_t> image_dispatch_flags = 0;
+    Context* on_finish = nullptr;
+    return mock_readahead_image_dispatch.read(
+      test_read->aio_comp, {{offset, length}},
+      std::move(test_read->read_result),
+      m_ictx->get_data_io_context(), 0, 0, {}, 0, &image_dispatch_flags,
+      dispatch_result, &on_finish, on_dispatched);
+  }
+
+  void complete_lower_read(TestRead* test_read) {
+    // stand-in for the lower layers handling a passed-through read
+    test_read->aio_comp->set_request_count(0);
+    ASSERT_EQ(0, test_read->ctx.wait());
+  }
+
+  ceph::bufferlist image_data(uint64_t offset, uint64_t length) {
+    ceph::bufferlist bl;
+    bl.substr_of(m_image_bl, offset, length);
+    return bl;
+  }
+};
+
+TEST_F(TestMockIoReadaheadImageDispatch, SequentialRead) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  init_image_ctx(mock_image_ctx);
+
+  MockReadaheadImageDispatch mock_readahead_image_dispatch(&mock_image_ctx);
+
+  InSequence seq;
+  Context* on_prefetch = nullptr;
+  expect_prefetch(mock_image_ctx, 8192, 128 * 1024, &on_prefetch);
+
+  auto used_bytes = m_ictx->perfcounter->get(l_librbd_readahead_used_bytes);
+
+  TestRead read1;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 0, 4096, &read1,
+                    &dispatch_result));
+  complete_lower_read(&read1);
+
+  // second sequential request triggers the prefetch
+  TestRead read2;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 4096, 4096, &read2,
+                    &dispatch_result));
+  complete_lower_read(&read2);
+  ASSERT_TRUE(on_prefetch != nullptr);
+  on_prefetch->complete(0);
+
+  TestRead read3;
+  ASSERT_TRUE(read(mock_readahead_image_dispatch, 8192, 4096, &read3,
+                   &dispatch_result));
+  ASSERT_EQ(DISPATCH_RESULT_COMPLETE, dispatch_result);
+  ASSERT_EQ(4096, read3.ctx.wait());
+  ASSERT_TRUE(image_data(8192, 4096).contents_equal(read3.bl));
+  ASSERT_EQ(used_bytes + 4096,
+            m_ictx->perfcounter->get(l_librbd_readahead_used_bytes));
+
+  C_SaferCond shut_down_ctx;
+  mock_readahead_image_dispatch.shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+}
+
+TEST_F(TestMockIoReadaheadImageDispatch, WaitForInFlightPrefetch) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  init_image_ctx(mock_image_ctx);
+
+  MockReadaheadImageDispatch mock_readahead_image_dispatch(&mock_image_ctx);
+
+  InSequence seq;
+  Context* on_prefetch = nullptr;
+  expect_prefetch(mock_image_ctx, 8192, 128 * 1024, &on_prefetch);
+
+  TestRead read1;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 0, 4096, &read1,
+                    &dispatch_result));
+  complete_lower_read(&read1);
+  TestRead read2;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 4096, 4096, &read2,
+                    &dispatch_result));
+  complete_lower_read(&read2);
+  ASSERT_TRUE(on_prefetch != nullptr);
+
+  TestRead read3;
+  C_SaferCond on_dispatched;
+  ASSERT_TRUE(read(mock_readahead_image_dispatch, 8192, 4096, &read3,
+                   &dispatch_result, &on_dispatched));
+  ASSERT_EQ(DISPATCH_RESULT_CONTINUE, dispatch_result);
+
+  on_prefetch->complete(0);
+  ASSERT_EQ(DISPATCH_RESULT_COMPLETE, dispatch_result);
+  ASSERT_EQ(4096, read3.ctx.wait());
+  ASSERT_TRUE(image_data(8192, 4096).contents_equal(read3.bl));
+
+  C_SaferCond shut_down_ctx;
+  mock_readahead_image_dispatch.shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+}
+
+TEST_F(TestMockIoReadaheadImageDispatch, WriteInvalidatesPrefetch) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  init_image_ctx(mock_image_ctx);
+
+  MockReadaheadImageDispatch mock_readahead_image_dispatch(&mock_image_ctx);
+
+  InSequence seq;
+  Context* on_prefetch = nullptr;
+  expect_prefetch(mock_image_ctx, 8192, 128 * 1024, &on_prefetch);
+
+  TestRead read1;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 0, 4096, &read1,
+                    &dispatch_result));
+  complete_lower_read(&read1);
+  TestRead read2;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 4096, 4096, &read2,
+                    &dispatch_result));
+  complete_lower_read(&read2);
+  ASSERT_TRUE(on_prefetch != nullptr);
+
+  TestRead read3;
+  C_SaferCond on_dispatched;
+  ASSERT_TRUE(read(mock_readahead_image_dispatch, 8192, 4096, &read3,
+                   &dispatch_result, &on_dispatched));
+
+  // the write overlaps the in-flight prefetch
+  std::atomic<uint32_t> image_dispatch_flags = 0;
+  C_SaferCond write_ctx;
+  Context* on_write_finish = &write_ctx;
+  ceph::bufferlist write_bl;
+  write_bl.append_zero(4096);
+  DispatchResult write_dispatch_result;
+  ASSERT_FALSE(mock_readahead_image_dispatch.write(
+    nullptr, {{12288, 4096}}, std::move(write_bl), 0, {}, 0,
+    &image_dispatch_flags, &write_dispatch_result, &on_write_finish,
+    nullptr));
+  ASSERT_NE(&write_ctx, on_write_finish);
+
+  // the waiting read is sent down to the lower layers
+  on_prefetch->complete(0);
+  ASSERT_EQ(0, on_dispatched.wait());
+  ASSERT_EQ(DISPATCH_RESULT_CONTINUE, dispatch_result);
+  complete_lower_read(&read3);
+
+  on_write_finish->complete(0);
+  ASSERT_EQ(0, write_ctx.wait());
+
+  TestRead read4;
+  ASSERT_FALSE(read(mock_readahead_image_dispatch, 12288, 4096, &read4,
+                    &dispatch_result));
+  complete_lower_read(&read4);
+
+  C_SaferCond shut_down_ctx;
+  mock_readahead_image_dispatch.shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+}
+
+TEST_F(TestMockIoReadaheadImageDispatch, RandomRead) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  init_image_ctx(mock_image_ctx);
+
+  MockReadaheadImageDispatch mock_readahead_image_dispatch(&mock_image_ctx);
+
+  EXPECT_CALL(*mock_image_ctx.io_image_dispatcher, send(_)).Times(0);
+
+  DispatchResult dispatch_result;
+  for (uint64_t offset : {65536, 0, 131072, 8192, 4096}) {
+    TestRead test_read;
+    ASSERT_FALSE(read(mock_readahead_image_dispatch, offset, 4096,
+                      &test_read, &dispatch_result));
+    complete_lower_read(&test_read);
+  }
+
+  C_SaferCond shut_down_ctx;
+  mock_readahead_image_dispatch.shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+}
+
+TEST_F(TestMockIoReadaheadImageDispatch, InterleavedStreams) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  init_image_ctx(mock_image_ctx);
+
+  MockReadaheadImageDispatch mock_readahead_image_dispatch(&mock_image_ctx);
+
+  InSequence seq;
+  Context* on_prefetch1 = nullptr;
+  expect_prefetch(mock_image_ctx, 8192, 128 * 1024, &on_prefetch1);
+  Context* on_prefetch2 = nullptr;
+  expect_prefetch(mock_image_ctx, 524288 + 8192, 128 * 1024, &on_prefetch2);
+
+  DispatchResult dispatch_result;
+  for (uint64_t offset : {0, 524288, 4096, 524288 + 4096}) {
+    TestRead test_read;
+    ASSERT_FALSE(read(mock_readahead_image_dispatch, offset, 4096,
+                      &test_read, &dispatch_result));
+    complete_lower_read(&test_read);
+  }
+  ASSERT_TRUE(on_prefetch1 != nullptr);
+  ASSERT_TRUE(on_prefetch2 != nullptr);
+  on_prefetch1->complete(0);
+  on_prefetch2->complete(0);
+
+  for (uint64_t offset : {8192, 524288 + 8192}) {
+    TestRead test_read;
+    ASSERT_TRUE(read(mock_readahead_image_dispatch, offset, 4096,
+                     &test_read, &dispatch_result));
+    ASSERT_EQ(4096, test_read.ctx.wait());
+    ASSERT_TRUE(image_data(offset, 4096).contents_equal(test_read.bl));
+  }
+
+  C_SaferCond shut_down_ctx;
+  mock_readahead_image_dispatch.shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+}
+
+} // namespace io
+} // namespace librbd
@@ -62,6 +62,7 @@ MockImageCtx::MockImageCtx(librbd::ImageCtx &image_ctx)
     op_work_queue(new MockContextWQ()),
     plugin_registry(new MockPluginRegistry()),
     readahead_max_bytes(image_ctx.readahead_max_bytes),
+    readahead_disable_after_bytes(image_ctx.readahead_disable_after_bytes),
     event_socket(image_ctx.event_socket),
     parent(NULL), operations(new MockOperations()),
     state(new MockImageState()),
@@ -222,6 +222,7 @@ struct MockImageCtx {
 
   MockReadahead readahead;
   uint64_t readahead_max_bytes;
+  uint64_t readahead_disable_after_bytes;
 
   EventSocket &event_socket;
 
@@ -0,0 +1,267 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librados_test_stub/MockTestMemIoCtxImpl.h"
+#include "common/bit_vector.hpp"
+#include "librbd/internal.h"
+#include "librbd/ObjectMap.h"
+#include "librbd/Operations.h"
+#include "librbd/object_map/BatchUpdateRequest.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <shared_mutex> // for std::shared_lock
+
+namespace librbd {
+namespace object_map {
+
+using ::testing::_;
+using ::testing::DoDefault;
+using ::testing::Return;
+using ::testing::StrEq;
+
+class TestMockObjectMapBatchUpdateRequest : public TestMockFixture {
+public:
+  void expect_assert_locked(librbd::ImageCtx *ictx, int ops) {
+    std::string oid(ObjectMap<>::object_map_name(ictx->id, CEPH_NOSNAP));
+    EXPECT_CALL(get_mock_io_ctx(ictx->md_ctx),
+                exec(oid, _, StrEq("lock"), StrEq("assert_locked"), _, _, _,
+                     _))
+                  .Times(ops).WillRepeatedly(DoDefault());
+  }
+
+  void expect_update(librbd::ImageCtx *ictx, uint64_t start_object_no,
+                     uint64_t end_object_no, uint8_t new_state,
+                     const boost::optional<uint8_t>& current_state, int r) {
+    bufferlist bl;
+    encode(start_object_no, bl);
+    encode(end_object_no, bl);
+    encode(new_state, bl);
+    encode(current_state, bl);
+
+    std::string oid(ObjectMap<>::object_map_name(ictx->id, CEPH_NOSNAP));
+    if (r < 0) {
+      EXPECT_CALL(get_mock_io_ctx(ictx->md_ctx),
+                  exec(oid, _, StrEq("rbd"), StrEq("object_map_update"),
+                       ContentsEqual(bl), _, _, _))
+                    .WillOnce(Return(r));
+    } else {
+      EXPECT_CALL(get_mock_io_ctx(ictx->md_ctx),
+                  exec(oid, _, StrEq("rbd"), StrEq("object_map_update"),
+                       ContentsEqual(bl), _, _, _))
+                    .WillOnce(DoDefault());
+    }
+  }
+
+  void expect_invalidate(librbd::ImageCtx *ictx) {
+    EXPECT_CALL(get_mock_io_ctx(ictx->md_ctx),
+                exec(ictx->header_oid, _, StrEq("rbd"), StrEq("set_flags"), _,
+                     _, _, _))
+                  .WillOnce(DoDefault());
+  }
+};
+
+TEST_F(TestMockObjectMapBatchUpdateRequest, CoalesceRanges) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  librbd::NoOpProgressContext no_progress;
+  ASSERT_EQ(0, ictx->operations->resize(8 << ictx->order, true, no_progress));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  // adjacent ranges are merged; the others share a block and need an
+  // operation each
+  expect_assert_locked(ictx, 3);
+  expect_update(ictx, 0, 3, OBJECT_EXISTS, {}, 0);
+  expect_update(ictx, 5, 6, OBJECT_EXISTS, {}, 0);
+  expect_update(ictx, 7, 8, OBJECT_EXISTS, {}, 0);
+
+  ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
+  ceph::BitVector<2> object_map;
+  object_map.resize(8);
+
+  C_SaferCond cond_ctx;
+  AsyncRequest<> *req = new BatchUpdateRequest<>(
+    *ictx, &object_map_lock, &object_map,
+    {{7, 8}, {0, 1}, {5, 6}, {1, 3}}, OBJECT_EXISTS, {}, {}, false,
+    &cond_ctx);
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    std::unique_lock object_map_locker{object_map_lock};
+    req->send();
+  }
+  ASSERT_EQ(0, cond_ctx.wait());
+
+  for (uint64_t i = 0; i < object_map.size(); ++i) {
+    if (i < 3 || i == 5 || i == 7) {
+      ASSERT_EQ(OBJECT_EXISTS, object_map[i]);
+    } else {
+      ASSERT_EQ(OBJECT_NONEXISTENT, object_map[i]);
+    }
+  }
+
+  expect_unlock_exclusive_lock(*ictx);
+}
+
+TEST_F(TestMockObjectMapBatchUpdateRequest, SeparateBlocks) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  // three 4K blocks of 16384 objects each
+  const uint64_t object_count = 3 * 16384;
+  librbd::NoOpProgressContext no_progress;
+  ASSERT_EQ(0, ictx->operations->resize(object_count << ictx->order, true,
+                                        no_progress));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  // [0, 1), [16390, 16394) and [32768, 32769) touch different blocks and
+  // share an operation, [2, 3) and [16395, 16396) need a second one
+  expect_assert_locked(ictx, 2);
+  expect_update(ictx, 0, 1, OBJECT_EXISTS, {}, 0);
+  expect_update(ictx, 2, 3, OBJECT_EXISTS, {}, 0);
+  expect_update(ictx, 16390, 16394, OBJECT_EXISTS, {}, 0);
+  expect_update(ictx, 16395, 16396, OBJECT_EXISTS, {}, 0);
+  expect_update(ictx, 32768, 32769, OBJECT_EXISTS, {}, 0);
+
+  ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
+  ceph::BitVector<2> object_map;
+  object_map.resize(object_count);
+
+  C_SaferCond cond_ctx;
+  AsyncRequest<> *req = new BatchUpdateRequest<>(
+    *ictx, &object_map_lock, &object_map,
+    {{32768, 32769}, {16395, 16396}, {2, 3}, {0, 1}, {16390, 16394}},
+    OBJECT_EXISTS, {}, {}, false, &cond_ctx);
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    std::unique_lock object_map_locker{object_map_lock};
+    req->send();
+  }
+  ASSERT_EQ(0, cond_ctx.wait());
+
+  for (uint64_t i = 0; i < object_map.size(); ++i) {
+    if (i == 0 || i == 2 || (i >= 16390 && i < 16394) || i == 16395 ||
+        i == 32768) {
+      ASSERT_EQ(OBJECT_EXISTS, object_map[i]);
+    } else {
+      ASSERT_EQ(OBJECT_NONEXISTENT, object_map[i]);
+    }
+  }
+
+  expect_unlock_exclusive_lock(*ictx);
+}
+
+TEST_F(TestMockObjectMapBatchUpdateRequest, UpdateInMemoryCurrentState) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  librbd::NoOpProgressContext no_progress;
+  ASSERT_EQ(0, ictx->operations->resize(8 << ictx->order, true, no_progress));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
+  ceph::BitVector<2> object_map;
+  object_map.resize(8);
+  for (uint64_t i = 0; i < object_map.size(); ++i) {
+    object_map[i] = i % 4;
+  }
+
+  C_SaferCond cond_ctx;
+  AsyncRequest<> *req = new BatchUpdateRequest<>(
+    *ictx, &object_map_lock, &object_map, {{0, 2}, {4, 8}},
+    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false, &cond_ctx);
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    std::unique_lock object_map_locker{object_map_lock};
+    req->send();
+  }
+  ASSERT_EQ(0, cond_ctx.wait());
+
+  for (uint64_t i = 0; i < object_map.size(); ++i) {
+    bool in_range = i < 2 || i >= 4;
+    if (in_range && (i % 4 == OBJECT_EXISTS ||
+                     i % 4 == OBJECT_EXISTS_CLEAN)) {
+      ASSERT_EQ(OBJECT_NONEXISTENT, object_map[i]);
+    } else {
+      ASSERT_EQ(i % 4, object_map[i]);
+    }
+  }
+
+  expect_unlock_exclusive_lock(*ictx);
+}
+
+TEST_F(TestMockObjectMapBatchUpdateRequest, UpdateOnDiskError) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  librbd::NoOpProgressContext no_progress;
+  ASSERT_EQ(0, ictx->operations->resize(4 << ictx->order, true, no_progress));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  expect_assert_locked(ictx, 2);
+  expect_update(ictx, 0, 1, OBJECT_EXISTS, {}, -EINVAL);
+  expect_update(ictx, 2, 4, OBJECT_EXISTS, {}, 0);
+  expect_invalidate(ictx);
+
+  ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
+  ceph::BitVector<2> object_map;
+  object_map.resize(4);
+
+  C_SaferCond cond_ctx;
+  AsyncRequest<> *req = new BatchUpdateRequest<>(
+    *ictx, &object_map_lock, &object_map, {{0, 1}, {2, 4}}, OBJECT_EXISTS,
+    {}, {}, false, &cond_ctx);
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    std::unique_lock object_map_locker{object_map_lock};
+    req->send();
+  }
+  ASSERT_EQ(0, cond_ctx.wait());
+
+  expect_unlock_exclusive_lock(*ictx);
+}
+
+TEST_F(TestMockObjectMapBatchUpdateRequest, IgnoreMissingObjectMap) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  librbd::NoOpProgressContext no_progress;
+  ASSERT_EQ(0, ictx->operations->resize(4 << ictx->order, true, no_progress));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  expect_assert_locked(ictx, 2);
+  expect_update(ictx, 0, 1, OBJECT_EXISTS, {}, -ENOENT);
+  expect_update(ictx, 3, 4, OBJECT_EXISTS, {}, -ENOENT);
+
+  ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
+  ceph::BitVector<2> object_map;
+  object_map.resize(4);
+
+  C_SaferCond cond_ctx;
+  AsyncRequest<> *req = new BatchUpdateRequest<>(
+    *ictx, &object_map_lock, &object_map, {{0, 1}, {3, 4}}, OBJECT_EXISTS,
+    {}, {}, true, &cond_ctx);
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    std::unique_lock object_map_locker{object_map_lock};
+    req->send();
+  }
+  ASSERT_EQ(0, cond_ctx.wait());
+
+  expect_unlock_exclusive_lock(*ictx);
+}
+
+} // namespace object_map
+} // namespace librbd
@@ -8,6 +8,8 @@
 #include "librbd/ImageWatcher.h"
 #include "librbd/internal.h"
 #include "librbd/ObjectMap.h"
+#include "librbd/api/Io.h"
+#include "librbd/io/AioCompletion.h"
 #include "common/Cond.h"
 #include "common/Throttle.h"
 #include "cls/rbd/cls_rbd_client.h"
@@ -240,3 +242,73 @@ TEST_F(TestObjectMap, DISABLED_StressTest) {
 
   ASSERT_EQ(0, throttle.wait_for_ret());
 }
+
+TEST_F(TestObjectMap, TrimThinImage) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  // fstrim of a mostly empty image: many discards racing for the object
+  // map, so that updates of ranges within the same bit_vector block are
+  // batched together
+  const uint64_t image_size = 1ULL << 37;
+  const uint64_t discard_size = 1ULL << 28;
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, resize(ictx, image_size));
+
+  uint64_t object_size = ictx->layout.object_size;
+  uint64_t object_count = image_size / object_size;
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  for (uint64_t object_no = 0; object_no < object_count; object_no += 64) {
+    ASSERT_EQ(4096, librbd::api::Io<>::write(*ictx, object_no * object_size,
+                                             4096, bufferlist{bl}, 0));
+  }
+
+  // the on-disk object map must match the in-memory one
+  std::string oid = librbd::ObjectMap<>::object_map_name(ictx->id,
+                                                         CEPH_NOSNAP);
+  auto verify_on_disk = [ictx, &oid, object_count]() {
+    ceph::BitVector<2> on_disk_object_map;
+    ASSERT_EQ(0, librbd::cls_client::object_map_load(&ictx->md_ctx, oid,
+                                                    &on_disk_object_map));
+    ASSERT_EQ(object_count, on_disk_object_map.size());
+
+    std::shared_lock image_locker{ictx->image_lock};
+    ASSERT_TRUE(ictx->object_map != nullptr);
+    for (uint64_t object_no = 0; object_no < object_count; ++object_no) {
+      ASSERT_EQ((*ictx->object_map)[object_no],
+                on_disk_object_map[object_no])
+        << "object_no=" << object_no;
+    }
+  };
+  ASSERT_NO_FATAL_FAILURE(verify_on_disk());
+
+  coarse_mono_time start = coarse_mono_clock::now();
+  std::list<C_SaferCond> discard_ctxs;
+  std::list<librbd::io::AioCompletion*> comps;
+  for (uint64_t off = 0; off < image_size; off += discard_size) {
+    auto& ctx = discard_ctxs.emplace_back();
+    auto comp = librbd::io::AioCompletion::create(&ctx);
+    comps.push_back(comp);
+    librbd::api::Io<>::aio_discard(*ictx, comp, off, discard_size, 0, true);
+  }
+  for (auto& ctx : discard_ctxs) {
+    ASSERT_EQ(0, ctx.wait());
+  }
+  for (auto comp : comps) {
+    comp->release();
+  }
+  chrono::duration<double> elapsed = coarse_mono_clock::now() - start;
+  std::cerr << "discarded " << image_size << " bytes in "
+            << discard_ctxs.size() << " requests: " << elapsed.count() << "s"
+            << std::endl;
+
+  ASSERT_NO_FATAL_FAILURE(verify_on_disk());
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    for (uint64_t object_no = 0; object_no < object_count; ++object_no) {
+      ASSERT_EQ(OBJECT_NONEXISTENT, (*ictx->object_map)[object_no])
+        << "object_no=" << object_no;
+    }
+  }
+}
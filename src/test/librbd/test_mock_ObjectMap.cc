@@ -5,6 +5,7 @@
 #include "test/librbd/test_support.h"
 #include "test/librbd/mock/MockImageCtx.h"
 #include "librbd/ObjectMap.h"
+#include "librbd/object_map/BatchUpdateRequest.h"
 #include "librbd/object_map/RefreshRequest.h"
 #include "librbd/object_map/UnlockRequest.h"
 #include "librbd/object_map/UpdateRequest.h"
@@ -92,9 +93,38 @@ struct UpdateRequest<MockTestImageCtx> {
   }
 };
 
+template <>
+struct BatchUpdateRequest<MockTestImageCtx> {
+  typedef std::vector<std::pair<uint64_t, uint64_t>> Ranges;
+
+  Context *on_finish = nullptr;
+  static BatchUpdateRequest *s_instance;
+  static BatchUpdateRequest *create(MockTestImageCtx &image_ctx,
+                                    ceph::shared_mutex*,
+                                    ceph::BitVector<2u> *object_map,
+                                    Ranges&& ranges, uint8_t new_state,
+                                    const boost::optional<uint8_t> &current_state,
+                                    const ZTracer::Trace &parent_trace,
+                                    bool ignore_enoent, Context *on_finish) {
+    ceph_assert(s_instance != nullptr);
+    s_instance->on_finish = on_finish;
+    s_instance->construct(ranges, new_state, current_state, ignore_enoent);
+    return s_instance;
+  }
+
+  MOCK_METHOD4(construct, void(const Ranges& ranges, uint8_t new_state,
+                               const boost::optional<uint8_t> &current_state,
+                               bool ignore_enoent));
+  MOCK_METHOD0(send, void());
+  BatchUpdateRequest() {
+    s_instance = this;
+  }
+};
+
 RefreshRequest<MockTestImageCtx> *RefreshRequest<MockTestImageCtx>::s_instance = nullptr;
 UnlockRequest<MockTestImageCtx> *UnlockRequest<MockTestImageCtx>::s_instance = nullptr;
 UpdateRequest<MockTestImageCtx> *UpdateRequest<MockTestImageCtx>::s_instance = nullptr;
+BatchUpdateRequest<MockTestImageCtx> *BatchUpdateRequest<MockTestImageCtx>::s_instance = nullptr;
 
 } // namespace object_map
 } // namespace librbd
@@ -113,6 +143,8 @@ public:
   typedef object_map::RefreshRequest<MockTestImageCtx> MockRefreshRequest;
   typedef object_map::UnlockRequest<MockTestImageCtx> MockUnlockRequest;
   typedef object_map::UpdateRequest<MockTestImageCtx> MockUpdateRequest;
+  typedef object_map::BatchUpdateRequest<MockTestImageCtx>
+    MockBatchUpdateRequest;
 
   void expect_refresh(MockTestImageCtx &mock_image_ctx,
                       MockRefreshRequest &mock_refresh_request,
@@ -148,6 +180,21 @@ public:
         }));
   }
 
+  void expect_batch_update(MockBatchUpdateRequest &mock_batch_update_request,
+                           const MockBatchUpdateRequest::Ranges &ranges,
+                           uint8_t new_state,
+                           const boost::optional<uint8_t> &current_state,
+                           bool ignore_enoent, Context **on_finish) {
+    EXPECT_CALL(mock_batch_update_request, construct(ranges, new_state,
+                                                     current_state,
+                                                     ignore_enoent))
+      .Times(1);
+    EXPECT_CALL(mock_batch_update_request, send())
+      .WillOnce(Invoke([&mock_batch_update_request, on_finish]() {
+          *on_finish = mock_batch_update_request.on_finish;
+        }));
+  }
+
 };
 
 TEST_F(TestMockObjectMap, NonDetainedUpdate) {
@@ -283,5 +330,81 @@ TEST_F(TestMockObjectMap, DetainedUpdate) {
   ASSERT_EQ(0, close_ctx.wait());
 }
 
+TEST_F(TestMockObjectMap, BatchedUpdate) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ictx->config.set_val("rbd_object_map_max_inflight_updates", "1");
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+
+  InSequence seq;
+  ceph::BitVector<2u> object_map;
+  object_map.resize(8);
+  MockRefreshRequest mock_refresh_request;
+  expect_refresh(mock_image_ctx, mock_refresh_request, object_map, 0);
+
+  MockUpdateRequest mock_update_request;
+  Context *finish_update_1;
+  expect_update(mock_image_ctx, mock_update_request, CEPH_NOSNAP,
+                0, 1, 1, {}, false, &finish_update_1);
+  MockBatchUpdateRequest mock_batch_update_request;
+  Context *finish_update_2 = nullptr;
+  expect_batch_update(mock_batch_update_request, {{4, 6}, {1, 2}}, 1, {},
+                      false, &finish_update_2);
+  Context *finish_update_3 = nullptr;
+  expect_update(mock_image_ctx, mock_update_request, CEPH_NOSNAP,
+                7, 8, 3, {}, false, &finish_update_3);
+
+  MockUnlockRequest mock_unlock_request;
+  expect_unlock(mock_image_ctx, mock_unlock_request, 0);
+
+  MockObjectMap *mock_object_map = new MockObjectMap(mock_image_ctx, CEPH_NOSNAP);
+  BOOST_SCOPE_EXIT(&mock_object_map) {
+    mock_object_map->put();
+  } BOOST_SCOPE_EXIT_END
+
+  C_SaferCond open_ctx;
+  mock_object_map->open(&open_ctx);
+  ASSERT_EQ(0, open_ctx.wait());
+
+  C_SaferCond update_ctx1;
+  C_SaferCond update_ctx2;
+  C_SaferCond update_ctx3;
+  C_SaferCond update_ctx4;
+  {
+    std::shared_lock image_locker{mock_image_ctx.image_lock};
+    mock_object_map->aio_update(CEPH_NOSNAP, 0, 1, 1, {}, {}, false,
+                                &update_ctx1);
+    mock_object_map->aio_update(CEPH_NOSNAP, 4, 6, 1, {}, {}, false,
+                                &update_ctx2);
+    mock_object_map->aio_update(CEPH_NOSNAP, 7, 8, 3, {}, {}, false,
+                                &update_ctx3);
+    mock_object_map->aio_update(CEPH_NOSNAP, 1, 2, 1, {}, {}, false,
+                                &update_ctx4);
+  }
+
+  // updates 2 and 4 are coalesced once update 1 completes
+  ASSERT_EQ(nullptr, finish_update_2);
+  finish_update_1->complete(0);
+  ASSERT_EQ(0, update_ctx1.wait());
+
+  // update 3 has a different transition and waits for the batch
+  ASSERT_NE(nullptr, finish_update_2);
+  ASSERT_EQ(nullptr, finish_update_3);
+  finish_update_2->complete(0);
+  ASSERT_EQ(0, update_ctx2.wait());
+  ASSERT_EQ(0, update_ctx4.wait());
+
+  ASSERT_NE(nullptr, finish_update_3);
+  finish_update_3->complete(0);
+  ASSERT_EQ(0, update_ctx3.wait());
+
+  C_SaferCond close_ctx;
+  mock_object_map->close(&close_ctx);
+  ASSERT_EQ(0, close_ctx.wait());
+}
+
 } // namespace librbd
 
@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <string>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <iostream>
 
 using namespace std;
@@ -173,6 +174,16 @@ void usage(const string &name) {
   cout << "       [ios]: how much messages sent for each client" << std::endl;
   cout << "       [thinktime]: sleep time when do fast dispatching(match client logic)" << std::endl;
   cout << "       [msg length]: message data bytes" << std::endl;
+  cout << "       pass --ms_tcp_zerocopy=true to send data with MSG_ZEROCOPY" << std::endl;
+  cout << "       pass --ms_async_busy_poll_us=<us> to busy poll in messenger workers" << std::endl;
+}
+
+static double cpu_seconds()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0 +
+         ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
 }
 
 int main(int argc, char **argv)
@@ -210,10 +221,22 @@ int main(int argc, char **argv)
 
   client.ready(concurrent, numjobs, ios, len);
   Cycles::init();
+  double cpu_start = cpu_seconds();
   uint64_t start = Cycles::rdtsc();
   client.start();
   uint64_t stop = Cycles::rdtsc();
+  double cpu = cpu_seconds() - cpu_start;
+  double gb = double(ios) * numjobs * len / (1024 * 1024 * 1024);
   cout << " Total op " << (ios * numjobs) << " run time " << Cycles::to_microseconds(stop - start) << "us." << std::endl;
+  // each job keeps `concurrent` ops in flight, so Little's law gives the
+  // mean round trip latency
+  cout << " Avg op latency " << double(Cycles::to_microseconds(stop - start)) * concurrent / ios
+       << "us (busy poll " << g_conf().get_val<uint64_t>("ms_async_busy_poll_us") << "us)" << std::endl;
+  cout << " CPU time " << cpu << "s";
+  if (gb > 0) {
+    cout << ", " << cpu / gb << " CPU s/GiB";
+  }
+  cout << " (zerocopy " << (g_conf()->ms_tcp_zerocopy ? "on" : "off") << ")" << std::endl;
 
   return 0;
 }
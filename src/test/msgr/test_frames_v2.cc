@@ -147,6 +147,19 @@ static bufferlist make_bufferlist(size_t len, char c) {
   return bl;
 }
 
+// same contents as make_bufferlist(), but split into frag_len-sized
+// bufferptrs to exercise the gather paths of the crypto handlers
+static bufferlist make_fragmented_bufferlist(size_t len, char c,
+                                            size_t frag_len) {
+  bufferlist bl;
+  while (len > 0) {
+    size_t l = std::min(len, frag_len);
+    bl.push_back(buffer::copy(std::string(l, c).data(), l));
+    len -= l;
+  }
+  return bl;
+}
+
 bool disassemble_frame(FrameAssembler& frame_asm, bufferlist& frame_bl,
                        Tag& tag, segment_bls_t& segment_bls) {
   bufferlist preamble_bl;
@@ -232,8 +245,14 @@ protected:
                       frame_asm.get_frame_onwire_len());
   }
 
-  void test_round_trip() {
-    auto tx_frame = TestFrame::Encode(m_header, m_front, m_middle, m_data);
+  void test_round_trip(size_t frag_len = 0) {
+    auto tx_frame = frag_len == 0 ?
+      TestFrame::Encode(m_header, m_front, m_middle, m_data) :
+      TestFrame::Encode(
+        make_fragmented_bufferlist(m_header.length(), 'H', frag_len),
+        make_fragmented_bufferlist(m_front.length(), 'F', frag_len),
+        make_fragmented_bufferlist(m_middle.length(), 'M', frag_len),
+        make_fragmented_bufferlist(m_data.length(), 'D', frag_len));
     auto onwire_bl = tx_frame.get_buffer(m_tx_frame_asm);
     check_frame_assembler(m_tx_frame_asm);
     EXPECT_EQ(m_tx_frame_asm.get_frame_onwire_len(), onwire_bl.length());
@@ -279,6 +298,12 @@ TEST_P(RoundTripTest, Reuse) {
   }
 }
 
+TEST_P(RoundTripTest, Fragmented) {
+  for (size_t frag_len : {1, 7, 16, 100}) {
+    test_round_trip(frag_len);
+  }
+}
+
 static const round_trip_instance_t round_trip_instances[] = {
   // first segment is empty
   { 0,   0,   0,   0, 1, {{32,  0,  17,   0,   0,  0},
@@ -436,6 +461,45 @@ TEST_P(RoundTripPerfTest, DISABLED_Basic) {
   }
 }
 
+static double thread_cpu_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Reports assembly (tx) and disassembly (rx) throughput in GB/s per core
+// for each mode, with the payload either contiguous or split into 512-byte
+// fragments as happens with encoded messages.
+TEST_P(RoundTripPerfTest, DISABLED_Throughput) {
+  const auto& [rti, m] = GetParam();
+  const uint64_t frame_len = rti.header_len + rti.front_len +
+                             rti.middle_len + rti.data_len;
+  const int iterations = std::max<uint64_t>(16, (1ull << 30) / frame_len);
+  for (size_t frag_len : {size_t(0), size_t(512)}) {
+    auto data = frag_len == 0 ? m_data :
+      make_fragmented_bufferlist(m_data.length(), 'D', frag_len);
+    double tx_secs = 0, rx_secs = 0;
+    for (int i = 0; i < iterations; i++) {
+      auto tx_frame = TestFrame::Encode(m_header, m_front, m_middle, data);
+      double start = thread_cpu_seconds();
+      auto onwire_bl = tx_frame.get_buffer(m_tx_frame_asm);
+      double mid = thread_cpu_seconds();
+
+      Tag rx_tag;
+      segment_bls_t rx_segment_bls;
+      ASSERT_TRUE(disassemble_frame(m_rx_frame_asm, onwire_bl, rx_tag,
+                                    rx_segment_bls));
+      rx_secs += thread_cpu_seconds() - mid;
+      tx_secs += mid - start;
+    }
+    const double gb = double(frame_len) * iterations / 1e9;
+    std::cout << m << " " << rti
+              << (frag_len ? " fragmented" : " contiguous")
+              << ": tx " << gb / tx_secs << " GB/s/core"
+              << ", rx " << gb / rx_secs << " GB/s/core" << std::endl;
+  }
+}
+
 static const round_trip_instance_t round_trip_perf_instances[] = {
   {41, 250, 0,       0, 2, {{32, 41, 250, 17,       0,  0},
                             {32, 48, 256, 32,       0,  0},
@@ -0,0 +1,93 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "msg/async/zerocopy_pins.h"
+
+#include <gtest/gtest.h>
+
+using ceph::ZeroCopyPins;
+
+static ceph::buffer::list make_bl(char c)
+{
+  ceph::buffer::list bl;
+  bl.append(std::string(4096, c));
+  return bl;
+}
+
+TEST(ZeroCopyPins, complete_in_order)
+{
+  ZeroCopyPins pins;
+  pins.pin(make_bl('a'), 1);
+  pins.pin(make_bl('b'), 2);
+  ASSERT_EQ(2u, pins.size());
+
+  pins.complete(0, 0);
+  ASSERT_EQ(1u, pins.size());
+  pins.complete(1, 1);
+  ASSERT_EQ(1u, pins.size());
+  pins.complete(2, 2);
+  ASSERT_TRUE(pins.empty());
+}
+
+TEST(ZeroCopyPins, complete_out_of_order)
+{
+  ZeroCopyPins pins;
+  pins.pin(make_bl('a'), 2);
+  pins.pin(make_bl('b'), 1);
+
+  // the second pin is done, but is only released with the first
+  pins.complete(2, 2);
+  ASSERT_EQ(2u, pins.size());
+  pins.complete(0, 1);
+  ASSERT_TRUE(pins.empty());
+}
+
+TEST(ZeroCopyPins, complete_range)
+{
+  ZeroCopyPins pins;
+  pins.pin(make_bl('a'), 3);
+  pins.pin(make_bl('b'), 3);
+  pins.pin(make_bl('c'), 3);
+
+  // one notification may cover several pins, partially
+  pins.complete(0, 4);
+  ASSERT_EQ(2u, pins.size());
+  pins.complete(5, 8);
+  ASSERT_TRUE(pins.empty());
+}
+
+TEST(ZeroCopyPins, wraparound)
+{
+  ZeroCopyPins pins(0xfffffffe);
+  pins.pin(make_bl('a'), 2);  // 0xfffffffe..0xffffffff
+  pins.pin(make_bl('b'), 3);  // 0xffffffff + 1 wraps to 0..2
+
+  // a range spanning the wrap covers the end of one pin and the start of
+  // the next
+  pins.complete(0xffffffff, 1);
+  ASSERT_EQ(2u, pins.size());
+  pins.complete(0xfffffffe, 0xfffffffe);
+  ASSERT_EQ(1u, pins.size());
+  pins.complete(2, 2);
+  ASSERT_TRUE(pins.empty());
+}
+
+TEST(ZeroCopyPins, pin_spanning_wrap)
+{
+  ZeroCopyPins pins(0xffffffff);
+  pins.pin(make_bl('a'), 3);  // 0xffffffff, 0, 1
+
+  pins.complete(0, 1);
+  ASSERT_EQ(1u, pins.size());
+  pins.complete(0xffffffff, 0xffffffff);
+  ASSERT_TRUE(pins.empty());
+}
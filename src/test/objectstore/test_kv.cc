@@ -205,6 +205,220 @@ TEST_P(KVTest, BenchCommit) {
   fini();
 }
 
+TEST_P(KVTest, MultiGet) {
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist value;
+    value.append("value");
+    t->set("prefix", "key1", value);
+    t->set("prefix", "key3", bufferlist());
+    t->set("other", "key2", value);
+    db->submit_transaction_sync(t);
+  }
+  std::set<std::string> keys = {"key1", "key2", "key3", "key4"};
+  std::map<std::string, bufferlist> values;
+  ASSERT_EQ(0, db->get("prefix", keys, &values));
+  ASSERT_EQ(2u, values.size());
+  ASSERT_EQ("value", _bl_to_str(values["key1"]));
+  ASSERT_EQ(1u, values.count("key3"));
+  ASSERT_EQ(0u, values["key3"].length());
+
+  values.clear();
+  ASSERT_EQ(0, db->get("prefix", std::set<std::string>{}, &values));
+  ASSERT_TRUE(values.empty());
+  fini();
+}
+
+TEST_P(KVTest, DISABLED_BenchMultiGet) {
+  const int num_keys = 100000;
+  const int batch = 64;
+  const int rounds = 2000;
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    bufferlist data;
+    data.append(gen_random_string(100));
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (int i = 0; i < num_keys; ++i) {
+      t->set("prefix", "key" + stringify(i), data);
+      if (t->get_count() >= 1000) {
+	db->submit_transaction_sync(t);
+	t = db->get_transaction();
+      }
+    }
+    db->submit_transaction_sync(t);
+    db->compact();
+  }
+
+  std::vector<std::set<std::string>> batches(rounds);
+  for (auto& b : batches) {
+    while (b.size() < (size_t)batch) {
+      b.insert("key" + stringify(rand() % num_keys));
+    }
+  }
+
+  utime_t start = ceph_clock_now();
+  for (auto& b : batches) {
+    for (auto& k : b) {
+      bufferlist v;
+      ASSERT_EQ(0, db->get("prefix", k, &v));
+    }
+  }
+  utime_t get_dur = ceph_clock_now() - start;
+
+  start = ceph_clock_now();
+  for (auto& b : batches) {
+    std::map<std::string, bufferlist> values;
+    ASSERT_EQ(0, db->get("prefix", b, &values));
+    ASSERT_EQ(b.size(), values.size());
+  }
+  utime_t batched_dur = ceph_clock_now() - start;
+
+  cout << rounds << " batches of " << batch << " keys: get " << get_dur
+       << ", batched get " << batched_dur << std::endl;
+  fini();
+}
+
+TEST_P(KVTest, DISABLED_BenchBoundedScanOverTombstones) {
+  // A small live key range followed by many deleted keys, as left behind
+  // in an omap after a bulk removal: an unbounded scan of the live range
+  // has to skip every tombstone before it finds the end of the range.
+  const int live = 100;
+  const int dead = 100000;
+  const int rounds = 1000;
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    bufferlist data;
+    data.append(gen_random_string(100));
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (int i = 0; i < live + dead; ++i) {
+      char key[16];
+      snprintf(key, sizeof(key), "%08d", i);
+      t->set("prefix", key, data);
+    }
+    db->submit_transaction_sync(t);
+    t = db->get_transaction();
+    for (int i = live; i < live + dead; ++i) {
+      char key[16];
+      snprintf(key, sizeof(key), "%08d", i);
+      t->rmkey("prefix", key);
+    }
+    db->submit_transaction_sync(t);
+  }
+
+  char tail[16];
+  snprintf(tail, sizeof(tail), "%08d", live);
+  auto scan = [&](KeyValueDB::IteratorBounds bounds) {
+    utime_t start = ceph_clock_now();
+    for (int r = 0; r < rounds; ++r) {
+      auto it = db->get_iterator("prefix", KeyValueDB::ITERATOR_READAHEAD,
+				 bounds);
+      int n = 0;
+      for (it->lower_bound(""); it->valid() && it->key() < tail; it->next()) {
+	++n;
+      }
+      EXPECT_EQ(live, n);
+    }
+    return ceph_clock_now() - start;
+  };
+  utime_t unbounded = scan({});
+  utime_t bounded = scan({std::string(), std::string(tail)});
+  cout << rounds << " scans of " << live << " keys before " << dead
+       << " tombstones: unbounded " << unbounded
+       << ", bounded " << bounded << std::endl;
+  fini();
+}
+
+TEST_P(KVTest, RMRangeKeysBulk) {
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    bufferlist value;
+    value.append("value");
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (auto k : {"a", "b1", "b2", "b3", "c"}) {
+      t->set("prefix", k, value);
+    }
+    db->submit_transaction_sync(t);
+  }
+  {
+    // below the threshold: per-key deletes
+    KeyValueDB::Transaction t = db->get_transaction();
+    ASSERT_FALSE(t->rm_range_keys_bulk("prefix", "b1", "b2", 2));
+    db->submit_transaction_sync(t);
+  }
+  {
+    // at the threshold: a single range delete
+    KeyValueDB::Transaction t = db->get_transaction();
+    ASSERT_TRUE(t->rm_range_keys_bulk("prefix", "b", "c", 2));
+    db->submit_transaction_sync(t);
+  }
+  std::set<std::string> keys;
+  auto it = db->get_iterator("prefix");
+  for (it->seek_to_first(); it->valid(); it->next()) {
+    keys.insert(it->key());
+  }
+  ASSERT_EQ((std::set<std::string>{"a", "c"}), keys);
+  fini();
+}
+
+TEST_P(KVTest, DISABLED_BenchIteratorAfterMassDelete) {
+  // Clears the omap-like key range of a big "object" either key by key or
+  // with a range tombstone (plus compaction), then measures how long it takes
+  // to seek across the cleared range to the next object's keys.
+  const int num_keys = 200000;
+  const int rounds = 1000;
+  bufferlist data;
+  data.append(gen_random_string(100));
+  auto key = [](char obj, int i) {
+    char k[16];
+    snprintf(k, sizeof(k), "%c%08d", obj, i);
+    return std::string(k);
+  };
+  for (bool range_delete : {false, true}) {
+    ASSERT_EQ(0, db->create_and_open(cout));
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (int i = 0; i < num_keys; ++i) {
+      t->set("prefix", key('a', i), data);
+      if (t->get_count() >= 1000) {
+	db->submit_transaction_sync(t);
+	t = db->get_transaction();
+      }
+    }
+    t->set("prefix", key('b', 0), data);
+    db->submit_transaction_sync(t);
+    db->compact();
+
+    t = db->get_transaction();
+    if (range_delete) {
+      ASSERT_TRUE(t->rm_range_keys_bulk("prefix", "a", "b", 1));
+    } else {
+      for (int i = 0; i < num_keys; ++i) {
+	t->rmkey("prefix", key('a', i));
+      }
+    }
+    db->submit_transaction_sync(t);
+    if (range_delete) {
+      db->compact_range("prefix", "a", "b");
+    }
+
+    utime_t start = ceph_clock_now();
+    for (int r = 0; r < rounds; ++r) {
+      auto it = db->get_iterator("prefix");
+      it->seek_to_first();
+      ASSERT_TRUE(it->valid());
+      ASSERT_EQ(key('b', 0), it->key());
+    }
+    utime_t dur = ceph_clock_now() - start;
+    cout << (range_delete ? "range delete + compact" : "per-key delete")
+	 << " of " << num_keys << " keys: avg seek latency "
+	 << (dur / (double)rounds) << std::endl;
+    fini();
+    rm_r("kv_test_temp_dir");
+    ASSERT_EQ(0, ::mkdir("kv_test_temp_dir", 0777));
+    init();
+  }
+}
+
 struct AppendMOP : public KeyValueDB::MergeOperator {
   void merge_nonexistent(
     const char *rdata, size_t rlen, std::string *new_value) override {
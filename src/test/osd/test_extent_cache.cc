@@ -692,4 +692,96 @@ TEST(ECExtentCache, test_invalidate_lru)
     cl.complete_write(*op5);
     op5.reset();
   }
-}
\ No newline at end of file
+}
+
+TEST(ECExtentCache, lru_stats)
+{
+  Client cl(32, 2, 1, 64);
+
+  auto to_write = iset_from_vector({{{0, 10}}, {{0, 10}}}, cl.get_stripe_info());
+
+  /* The first write finds nothing in the LRU and leaves its line there when
+   * the op completes. */
+  {
+    optional op = cl.cache.prepare(cl.oid, nullopt, to_write, 10, 10, false,
+      [&cl](ECExtentCache::OpRef &op)
+      {
+        cl.cache_ready(op->get_hoid(), op->get_result());
+      });
+    cl.cache_execute(*op);
+    cl.complete_write(*op);
+  }
+
+  auto stats = cl.lru.get_stats();
+  ASSERT_EQ(0u, stats.hits);
+  ASSERT_EQ(1u, stats.misses);
+  ASSERT_EQ(0u, stats.evictions);
+  ASSERT_LT(0u, stats.size);
+
+  /* A second write to the same stripe picks the line back up. */
+  {
+    optional op = cl.cache.prepare(cl.oid, nullopt, to_write, 10, 10, false,
+      [&cl](ECExtentCache::OpRef &op)
+      {
+        cl.cache_ready(op->get_hoid(), op->get_result());
+      });
+    cl.cache_execute(*op);
+    cl.complete_write(*op);
+  }
+
+  stats = cl.lru.get_stats();
+  ASSERT_EQ(1u, stats.hits);
+  ASSERT_EQ(1u, stats.misses);
+  ASSERT_LT(0u, stats.size);
+
+  /* Shrinking the budget evicts immediately. */
+  cl.lru.set_max_size(0);
+  stats = cl.lru.get_stats();
+  ASSERT_EQ(1u, stats.evictions);
+  ASSERT_EQ(0u, stats.size);
+  ASSERT_EQ(0u, stats.max_size);
+  ASSERT_TRUE(cl.cache.idle());
+}
+
+TEST(ECExtentCache, lru_pricache)
+{
+  Client cl(32, 2, 1, 64);
+
+  auto to_write = iset_from_vector({{{0, 10}}, {{0, 10}}}, cl.get_stripe_info());
+  {
+    optional op = cl.cache.prepare(cl.oid, nullopt, to_write, 10, 10, false,
+      [&cl](ECExtentCache::OpRef &op)
+      {
+        cl.cache_ready(op->get_hoid(), op->get_result());
+      });
+    cl.cache_execute(*op);
+    cl.complete_write(*op);
+  }
+  uint64_t used = cl.lru.get_stats().size;
+  ASSERT_LT(0u, used);
+
+  /* Without a minimum, everything held is requested at the lowest priority. */
+  ECExtentCache::LRUPriCache pricache({&cl.lru}, 0);
+  ASSERT_EQ(0, pricache.request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  ASSERT_EQ((int64_t)used,
+            pricache.request_cache_bytes(PriorityCache::Priority::LAST, 0));
+
+  /* Up to the minimum is requested at PRI1, less what is already assigned. */
+  pricache.set_min_bytes(used);
+  ASSERT_EQ((int64_t)used,
+            pricache.request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  ASSERT_EQ(0, pricache.request_cache_bytes(PriorityCache::Priority::LAST, 0));
+  pricache.set_cache_bytes(PriorityCache::Priority::PRI1, used);
+  ASSERT_EQ(0, pricache.request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+
+  uint64_t hits, misses;
+  ASSERT_TRUE(pricache.get_hit_stats(&hits, &misses));
+  ASSERT_EQ(0u, hits);
+  ASSERT_EQ(1u, misses);
+
+  /* Committing a size resizes the LRU. */
+  int64_t committed = pricache.commit_cache_size(1ul << 30);
+  ASSERT_EQ(committed, pricache.get_committed_size());
+  ASSERT_EQ((uint64_t)committed, cl.lru.get_stats().max_size);
+  ASSERT_EQ(used, cl.lru.get_stats().size);
+}
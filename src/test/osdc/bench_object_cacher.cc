@@ -0,0 +1,234 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Mixed read/write load on an ObjectCacher from a rising number of
+ * threads.  Every thread works on its own object set (like ceph-fuse
+ * files) and takes the cacher lock around each call, the way the cache
+ * users do.  Writeback goes to an in-memory backend with a configurable
+ * delay, so the numbers show how much the cacher itself and its lock
+ * hold times limit the throughput.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/Cond.h"
+#include "common/ceph_argparse.h"
+#include "common/ceph_mutex.h"
+#include "common/common_init.h"
+#include "common/config.h"
+#include "common/snap_types.h"
+#include "global/global_init.h"
+#include "include/buffer.h"
+#include "include/stringify.h"
+#include "osdc/ObjectCacher.h"
+
+#include "MemWriteback.h"
+
+using namespace std;
+
+namespace {
+
+struct Options {
+  int max_threads = 32;
+  uint64_t ops = 20000;
+  uint64_t objects = 16;
+  uint64_t object_size = 4 << 20;
+  uint64_t io_size = 4096;
+  float read_ratio = 0.7;
+  uint64_t delay_ns = 100000;
+};
+
+ObjectExtent make_extent(const Options& opts, int set, uint64_t object_no,
+			 uint64_t offset)
+{
+  ObjectExtent extent("bench_" + stringify(set) + "." + stringify(object_no),
+		      object_no, offset, opts.io_size, 0);
+  extent.oloc.pool = 0;
+  extent.buffer_extents.push_back(make_pair(0, opts.io_size));
+  return extent;
+}
+
+int run(const Options& opts, int threads)
+{
+  ceph::mutex lock = ceph::make_mutex("bench_object_cacher::lock");
+  MemWriteback writeback(g_ceph_context, &lock, opts.delay_ns);
+  ObjectCacher obc(g_ceph_context, "bench", writeback, lock, nullptr, nullptr,
+		   g_conf()->client_oc_size,
+		   g_conf()->client_oc_max_objects,
+		   g_conf()->client_oc_max_dirty,
+		   g_conf()->client_oc_target_dirty,
+		   g_conf()->client_oc_max_dirty_age,
+		   true);
+  obc.start();
+
+  vector<unique_ptr<ObjectCacher::ObjectSet>> object_sets;
+  for (int t = 0; t < threads; ++t) {
+    object_sets.emplace_back(new ObjectCacher::ObjectSet(nullptr, 0, t));
+  }
+
+  atomic<uint64_t> reads = 0;
+  atomic<uint64_t> read_misses = 0;
+  atomic<int> errors = 0;
+  vector<thread> workers;
+  auto start = chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      mt19937_64 rng(t);
+      uniform_int_distribution<uint64_t> object_dist(0, opts.objects - 1);
+      uniform_int_distribution<uint64_t> block_dist(
+	0, opts.object_size / opts.io_size - 1);
+      bernoulli_distribution read_dist(opts.read_ratio);
+      SnapContext snapc;
+      bufferlist data_bl;
+      data_bl.append(string(opts.io_size, 'a' + t % 26));
+
+      for (uint64_t i = 0; i < opts.ops; ++i) {
+	auto extent = make_extent(opts, t, object_dist(rng),
+				  block_dist(rng) * opts.io_size);
+	if (read_dist(rng)) {
+	  bufferlist bl;
+	  auto rd = obc.prepare_read(CEPH_NOSNAP, &bl, 0);
+	  rd->extents.push_back(extent);
+	  C_SaferCond cond;
+	  lock.lock();
+	  int r = obc.readx(rd, object_sets[t].get(), &cond);
+	  lock.unlock();
+	  if (r == 0) {
+	    ++read_misses;
+	    r = cond.wait();
+	  }
+	  if (r != (int)opts.io_size) {
+	    ++errors;
+	  }
+	  ++reads;
+	} else {
+	  auto wr = obc.prepare_write(snapc, data_bl, ceph::real_clock::zero(),
+				      0, 0);
+	  wr->extents.push_back(extent);
+	  lock.lock();
+	  obc.writex(wr, object_sets[t].get(), nullptr);
+	  lock.unlock();
+	}
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+  C_SaferCond flush_cond;
+  lock.lock();
+  bool flushed = obc.flush_all(&flush_cond);
+  lock.unlock();
+  if (!flushed) {
+    flush_cond.wait();
+  }
+
+  lock.lock();
+  loff_t unclean = 0;
+  for (auto& object_set : object_sets) {
+    unclean += obc.release_set(object_set.get());
+  }
+  lock.unlock();
+  obc.stop();
+
+  uint64_t ops = opts.ops * threads;
+  cout << setw(8) << threads
+       << setw(12) << uint64_t(ops / elapsed.count())
+       << setw(10) << uint64_t(ops * opts.io_size / elapsed.count() /
+			       (1 << 20))
+       << setw(20) << (stringify(read_misses.load()) + "/" +
+		       stringify(reads.load()));
+  if (errors > 0) {
+    cout << "  " << errors << " failed reads";
+  }
+  cout << std::endl;
+
+  if (unclean > 0) {
+    cerr << "unclean buffers left over!" << std::endl;
+    return -EINVAL;
+  }
+  return errors > 0 ? -EIO : 0;
+}
+
+void usage(const char* name)
+{
+  cerr << "usage: " << name << " [--max-threads N] [--ops N] [--objects N]"
+       << " [--object-size BYTES] [--io-size BYTES] [--read-ratio R]"
+       << " [--delay-ns NS]" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  Options opts;
+  long long ops = opts.ops;
+  long long objects = opts.objects;
+  long long object_size = opts.object_size;
+  long long io_size = opts.io_size;
+  long long delay_ns = opts.delay_ns;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &opts.max_threads, err,
+			      "--max-threads", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &ops, err, "--ops", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &objects, err, "--objects",
+			      (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &object_size, err, "--object-size",
+			      (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &io_size, err, "--io-size",
+			      (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &opts.read_ratio, err, "--read-ratio",
+			      (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &delay_ns, err, "--delay-ns",
+			      (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << argv[0] << ": " << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (opts.max_threads < 1 || ops < 1 || objects < 1 || io_size < 1 ||
+      object_size < io_size || object_size % io_size != 0 || delay_ns < 0 ||
+      opts.read_ratio < 0 || opts.read_ratio > 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  opts.ops = ops;
+  opts.objects = objects;
+  opts.object_size = object_size;
+  opts.io_size = io_size;
+  opts.delay_ns = delay_ns;
+
+  cout << opts.io_size << " byte ops, " << opts.read_ratio * 100
+       << "% reads, " << opts.ops << " ops per thread" << std::endl;
+  cout << setw(8) << "threads" << setw(12) << "ops/s" << setw(10) << "MiB/s"
+       << setw(20) << "read misses/reads" << std::endl;
+  for (int threads = 1; threads <= opts.max_threads; threads *= 2) {
+    if (run(opts, threads) < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Replays the locking of Objecter::_op_submit from a number of threads:
+ * the map lock taken shared, a lookup of the target OSD session, the
+ * session lock around registering the op and a global tid counter.  The
+ * map lock is once a std::shared_mutex and once a sharded_shared_mutex,
+ * with an occasional exclusive acquisition standing in for map updates.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/sharded_shared_mutex.h"
+
+using namespace std;
+
+struct Session {
+  std::mutex lock;
+  map<uint64_t, unsigned> ops;
+};
+
+template<typename Mutex>
+static double run(unsigned num_threads, unsigned ops_per_thread,
+		  unsigned num_osds, unsigned map_every)
+{
+  Mutex rwlock;
+  map<int, unique_ptr<Session>> sessions;
+  for (unsigned osd = 0; osd < num_osds; ++osd) {
+    sessions.emplace(osd, make_unique<Session>());
+  }
+  atomic<uint64_t> last_tid = 0;
+  uint64_t epoch = 1;
+
+  auto submit = [&](unsigned i) {
+    std::shared_lock rl{rwlock};
+    // stand-in for _calc_target
+    int osd = (i * 2654435761u + epoch) % num_osds;
+    auto& s = sessions.at(osd);
+    std::lock_guard sl{s->lock};
+    uint64_t tid = ++last_tid;
+    s->ops[tid] = i;
+    return std::make_pair(osd, tid);
+  };
+  auto finish = [&](int osd, uint64_t tid) {
+    std::shared_lock rl{rwlock};
+    auto& s = sessions.at(osd);
+    std::lock_guard sl{s->lock};
+    s->ops.erase(tid);
+  };
+
+  vector<thread> threads;
+  auto start = chrono::steady_clock::now();
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (unsigned i = 0; i < ops_per_thread; ++i) {
+	unsigned n = t * ops_per_thread + i;
+	if (map_every && n % map_every == 0) {
+	  std::unique_lock wl{rwlock};
+	  ++epoch;
+	}
+	auto [osd, tid] = submit(n);
+	finish(osd, tid);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return num_threads * ops_per_thread / elapsed.count();
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  int num_osds = 64;
+  int num_ops = 1000000;
+  int max_threads = 16;
+  int map_every = 100000;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &num_osds, err, "--osds", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &num_ops, err, "--ops", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &max_threads, err, "--threads",
+			      (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &map_every, err, "--map-every",
+			      (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return 1;
+      }
+    } else {
+      cerr << "usage: " << argv[0]
+	   << " [--osds N] [--ops N] [--threads N] [--map-every N]"
+	   << std::endl;
+      return 1;
+    }
+  }
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    unsigned per_thread = num_ops / threads;
+    double shared = run<std::shared_mutex>(threads, per_thread, num_osds,
+					   map_every);
+    double sharded = run<ceph::sharded_shared_mutex>(threads, per_thread,
+						     num_osds, map_every);
+    cout << threads << " threads: shared_mutex " << uint64_t(shared)
+	 << " ops/s, sharded_shared_mutex " << uint64_t(sharded)
+	 << " ops/s (" << sharded / shared << "x)" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Resolves object names to their acting set the way Objecter::_calc_target
+ * does, once with a CRUSH calculation per op and once through the per-epoch
+ * PGMappingCache, from a number of threads.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/common_init.h"
+#include "global/global_init.h"
+#include "osd/OSDMap.h"
+#include "osdc/PGMappingCache.h"
+
+using namespace std;
+
+static void build_map(CephContext *cct, OSDMap *osdmap, int num_osds)
+{
+  uuid_d fsid;
+  // one pool with num_osds << 6 pgs
+  osdmap->build_simple_with_pool(cct, 0, fsid, num_osds, 6, 6);
+  OSDMap::Incremental inc(osdmap->get_epoch() + 1);
+  inc.fsid = osdmap->get_fsid();
+  entity_addrvec_t addrs;
+  addrs.v.push_back(entity_addr_t());
+  for (int i = 0; i < num_osds; ++i) {
+    uuid_d uuid;
+    uuid.generate_random();
+    addrs.v[0].nonce = i;
+    inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+    inc.new_up_client[i] = addrs;
+    inc.new_up_cluster[i] = addrs;
+    inc.new_hb_back_up[i] = addrs;
+    inc.new_hb_front_up[i] = addrs;
+    inc.new_weight[i] = CEPH_OSD_IN;
+    inc.new_uuid[i] = uuid;
+  }
+  osdmap->apply_incremental(inc);
+}
+
+template<typename F>
+static double run(unsigned num_threads, unsigned ops_per_thread, F&& f)
+{
+  vector<thread> threads;
+  atomic<uint64_t> sink = 0;
+  auto start = chrono::steady_clock::now();
+  for (unsigned t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      uint64_t sum = 0;
+      for (unsigned i = 0; i < ops_per_thread; ++i) {
+	sum += f(t * ops_per_thread + i);
+      }
+      sink += sum;
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return num_threads * ops_per_thread / elapsed.count();
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  int num_osds = 64;
+  int num_ops = 1000000;
+  int max_threads = 8;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &num_osds, err, "--osds", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &num_ops, err, "--ops", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &max_threads, err, "--threads",
+			      (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return 1;
+      }
+    } else {
+      cerr << "usage: " << argv[0]
+	   << " [--osds N] [--ops N] [--threads N]" << std::endl;
+      return 1;
+    }
+  }
+
+  OSDMap osdmap;
+  build_map(g_ceph_context, &osdmap, num_osds);
+  int64_t pool = osdmap.get_pools().begin()->first;
+  const pg_pool_t *pi = osdmap.get_pg_pool(pool);
+  cout << num_osds << " osds, " << pi->get_pg_num() << " pgs" << std::endl;
+
+  // rbd-like object names
+  vector<object_t> oids;
+  for (int i = 0; i < 65536; ++i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "rbd_data.1234567890ab.%016x", i);
+    oids.emplace_back(buf);
+  }
+  object_locator_t oloc(pool);
+  auto to_pg = [&](unsigned i) {
+    pg_t pgid;
+    osdmap.object_locator_to_pg(oids[i % oids.size()], oloc, pgid);
+    return pg_t(ceph_stable_mod(pgid.ps(), pi->get_pg_num(),
+				pi->get_pg_num_mask()), pool);
+  };
+
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    unsigned per_thread = num_ops / threads;
+    double crush = run(threads, per_thread, [&](unsigned i) {
+      vector<int> up, acting;
+      int up_primary, acting_primary;
+      osdmap.pg_to_up_acting_osds(to_pg(i), &up, &up_primary, &acting,
+				  &acting_primary);
+      return acting_primary;
+    });
+    PGMappingCache cache;
+    cache.prune(osdmap.get_pools());
+    double cached = run(threads, per_thread, [&](unsigned i) {
+      return cache.get(osdmap, to_pg(i))->acting_primary;
+    });
+    cout << threads << " threads: crush " << uint64_t(crush)
+	 << " ops/s, cached " << uint64_t(cached) << " ops/s ("
+	 << cached / crush << "x)" << std::endl;
+  }
+  return 0;
+}
@@ -131,6 +131,55 @@ TEST(PerfCounters, SinglePerfCounters) {
 
 }
 
+TEST(PerfCounters, ShardedPerfCounters) {
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCountersBuilder bld(g_ceph_context, "test_perfcounter_1",
+	  TEST_PERFCOUNTERS1_ELEMENT_FIRST, TEST_PERFCOUNTERS1_ELEMENT_LAST);
+  bld.set_sharded(true);
+  bld.add_u64_counter(TEST_PERFCOUNTERS1_ELEMENT_1, "element1");
+  bld.add_time(TEST_PERFCOUNTERS1_ELEMENT_2, "element2");
+  bld.add_time_avg(TEST_PERFCOUNTERS1_ELEMENT_3, "element3");
+  PerfCounters* fake_pf = bld.create_perf_counters();
+  coll->add(fake_pf);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([fake_pf] {
+      for (int i = 0; i < 1000; ++i) {
+	fake_pf->inc(TEST_PERFCOUNTERS1_ELEMENT_1);
+	fake_pf->tinc(TEST_PERFCOUNTERS1_ELEMENT_3, utime_t(0, 1000));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  fake_pf->tset(TEST_PERFCOUNTERS1_ELEMENT_2, utime_t(0, 500000000));
+  ASSERT_EQ(8000u, fake_pf->get(TEST_PERFCOUNTERS1_ELEMENT_1));
+  ASSERT_EQ(std::make_pair(8000000ul, 8000ul),
+	    fake_pf->get_tavg_ns(TEST_PERFCOUNTERS1_ELEMENT_3));
+
+  // the output does not depend on how the values are stored
+  AdminSocketClient client(get_rand_socket_path());
+  std::string msg;
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_1\":{\"element1\":8000,"
+	    "\"element2\":0.500000000,\"element3\":{\"avgcount\":8000,\"sum\":0.008000000,\"avgtime\":0.000001000}}}"), msg);
+
+  // set overrides whatever the shards hold
+  fake_pf->set(TEST_PERFCOUNTERS1_ELEMENT_1, 5);
+  ASSERT_EQ(5u, fake_pf->get(TEST_PERFCOUNTERS1_ELEMENT_1));
+  fake_pf->inc(TEST_PERFCOUNTERS1_ELEMENT_1);
+  ASSERT_EQ(6u, fake_pf->get(TEST_PERFCOUNTERS1_ELEMENT_1));
+
+  fake_pf->reset();
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_1\":{\"element1\":0,"
+	    "\"element2\":0.000000000,\"element3\":{\"avgcount\":0,\"sum\":0.000000000,\"avgtime\":0.000000000}}}"), msg);
+  coll->clear();
+}
+
 enum {
   TEST_PERFCOUNTERS2_ELEMENT_FIRST = 400,
   TEST_PERFCOUNTERS2_ELEMENT_FOO,
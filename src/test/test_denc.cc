@@ -545,6 +545,129 @@ TEST(denc, array)
   }
 }
 
+// encoded field by field
+struct fields_t {
+  uint64_t a = 0;
+  uint32_t b = 0;
+  DENC(fields_t, v, p) {
+    denc(v.a, p);
+    denc(v.b, p);
+  }
+};
+WRITE_CLASS_DENC_BOUNDED(fields_t)
+
+// same encoding, but copied from memory; the padding is not encoded
+struct raw_t {
+  uint64_t a = 0;
+  uint32_t b = 0;
+  uint32_t pad = 0;
+  DENC(raw_t, v, p) {
+    denc(v.a, p);
+    denc(v.b, p);
+  }
+  friend bool operator==(const raw_t& l, const raw_t& r) {
+    return l.a == r.a && l.b == r.b;
+  }
+};
+WRITE_CLASS_DENC_RAW(raw_t, sizeof(uint64_t) + sizeof(uint32_t))
+
+// no padding: containers of it are copied in bulk
+struct raw_packed_t {
+  uint32_t a = 0;
+  uint32_t b = 0;
+  DENC(raw_packed_t, v, p) {
+    denc(v.a, p);
+    denc(v.b, p);
+  }
+  friend bool operator==(const raw_packed_t& l, const raw_packed_t& r) {
+    return l.a == r.a && l.b == r.b;
+  }
+};
+WRITE_CLASS_DENC_RAW(raw_packed_t, sizeof(raw_packed_t))
+
+static_assert(!_denc::bulk_copyable<raw_t>);
+static_assert(!_denc::bulk_copyable<bool>);
+static_assert(!_denc::bulk_copyable<std::string>);
+static_assert(std::endian::native != std::endian::little ||
+              (_denc::bulk_copyable<raw_packed_t> &&
+               _denc::bulk_copyable<uint32_t> &&
+               _denc::bulk_copyable<ceph_le64>));
+
+TEST(denc, raw)
+{
+  raw_t r;
+  r.a = 0x0102030405060708ull;
+  r.b = 0x090a0b0c;
+  r.pad = 0xffffffff;
+  test_denc(r);
+  ASSERT_EQ(12u, ceph::encoded_sizeof_bounded<raw_t>());
+
+  fields_t f;
+  f.a = r.a;
+  f.b = r.b;
+  bufferlist rbl, fbl;
+  encode(r, rbl);
+  encode(f, fbl);
+  ASSERT_EQ(fbl, rbl);
+
+  // decoding from a segmented bufferlist
+  bufferlist seg;
+  seg.append(rbl.c_str(), 5);
+  seg.append(rbl.c_str() + 5, rbl.length() - 5);
+  auto p = seg.cbegin();
+  raw_t out;
+  decode(out, p);
+  ASSERT_EQ(r, out);
+}
+
+TEST(denc, raw_containers)
+{
+  std::vector<raw_packed_t> v(100);
+  std::vector<fields_t> fv(100);
+  for (uint32_t i = 0; i < v.size(); ++i) {
+    v[i].a = fv[i].a = i;
+    v[i].b = fv[i].b = ~i;
+  }
+  test_denc(v);
+  test_denc(std::vector<raw_packed_t>());
+  test_denc(std::vector<raw_t>(3));
+
+  std::array<raw_packed_t, 3> a = { v[1], v[2], v[3] };
+  test_denc(a);
+
+  // same bytes as if encoded element by element
+  bufferlist bl;
+  encode(v, bl);
+  bufferlist expected;
+  encode(uint32_t(v.size()), expected);
+  for (auto& e : v) {
+    encode(e.a, expected);
+    encode(e.b, expected);
+  }
+  ASSERT_EQ(expected, bl);
+
+  std::vector<uint64_t> u(37);
+  std::iota(u.begin(), u.end(), 1000);
+  test_denc(u);
+}
+
+TEST(denc, raw_containers_truncated)
+{
+  std::vector<uint32_t> v = {1, 2, 3, 4};
+  bufferlist bl;
+  encode(v, bl);
+  bufferlist truncated;
+  truncated.substr_of(bl, 0, bl.length() - 1);
+
+  std::vector<uint32_t> out;
+  auto p = truncated.cbegin();
+  ASSERT_THROW(decode(out, p), ceph::buffer::end_of_buffer);
+
+  truncated.rebuild();
+  auto bpi = truncated.front().begin();
+  ASSERT_THROW(denc(out, bpi), ceph::buffer::end_of_buffer);
+}
+
 TEST(denc, tuple)
 {
   {
@@ -0,0 +1,257 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/debug.h"
+#include "FrequencyPolicy.h"
+
+#include <algorithm>
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_immutable_obj_cache
+#undef dout_prefix
+#define dout_prefix *_dout << "ceph::cache::FrequencyPolicy: " << this << " " \
+                           << __func__ << ": "
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+namespace {
+
+// counters are halved after this many lookups per tracked history entry
+const uint64_t AGING_PERIOD_FACTOR = 8;
+
+} // anonymous namespace
+
+FrequencyPolicy::FrequencyPolicy(CephContext *cct, uint64_t cache_size,
+                                 uint64_t max_inflight, double watermark)
+  : cct(cct), m_watermark(watermark), m_max_inflight_ops(max_inflight),
+    m_max_cache_size(cache_size),
+    // remember about one uncached object per MiB of cache
+    m_max_history(std::max<uint64_t>(1024, cache_size >> 20)) {
+  ldout(cct, 20) << "max cache size= " << m_max_cache_size
+                 << " ,watermark= " << m_watermark
+                 << " ,max inflight ops= " << m_max_inflight_ops
+                 << " ,max history= " << m_max_history << dendl;
+}
+
+FrequencyPolicy::~FrequencyPolicy() {
+  ldout(cct, 20) << dendl;
+}
+
+bool FrequencyPolicy::admit(uint32_t frequency) {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+
+  if (m_cache_size >= m_max_cache_size ||
+      m_inflight_ops >= m_max_inflight_ops) {
+    return false;
+  }
+  if (m_cache_size < m_max_cache_size * m_watermark) {
+    return true;
+  }
+
+  // above the watermark something will have to be evicted for this
+  // object: only take it if it is hotter than the coldest cached object
+  auto it = m_promoted.begin();
+  return it == m_promoted.end() || frequency > std::get<0>(*it);
+}
+
+void FrequencyPolicy::touch(Entry* entry) {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+
+  bool promoted = (entry->status == OBJ_CACHE_PROMOTED ||
+                   entry->status == OBJ_CACHE_DNE) && !entry->evicting;
+  if (promoted) {
+    m_promoted.erase(rank(entry));
+  }
+  ++entry->frequency;
+  entry->last_access = m_access;
+  if (promoted) {
+    m_promoted.insert(rank(entry));
+  }
+}
+
+void FrequencyPolicy::age() {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+  ldout(cct, 20) << dendl;
+
+  std::set<Rank> promoted;
+  for (auto& [entry_freq, last_access, entry] : m_promoted) {
+    entry->frequency /= 2;
+    promoted.emplace(rank(entry));
+  }
+  m_promoted.swap(promoted);
+  for (auto& it : m_cache_map) {
+    if (it.second.status == OBJ_CACHE_SKIP || it.second.evicting) {
+      it.second.frequency /= 2;
+    }
+  }
+
+  for (auto it = m_history.begin(); it != m_history.end();) {
+    it->second /= 2;
+    if (it->second == 0) {
+      it = m_history.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  m_accesses_since_aging = 0;
+}
+
+cache_status_t FrequencyPolicy::lookup_object(std::string file_name) {
+  ldout(cct, 20) << "lookup: " << file_name << dendl;
+
+  std::lock_guard locker{m_lock};
+  ++m_access;
+  if (++m_accesses_since_aging >= m_max_history * AGING_PERIOD_FACTOR) {
+    age();
+  }
+
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it != m_cache_map.end()) {
+    touch(&entry_it->second);
+    return entry_it->second.status;
+  }
+
+  auto history_it = m_history.find(file_name);
+  if (history_it == m_history.end()) {
+    if (m_history.size() >= m_max_history) {
+      age();
+      if (m_history.size() >= m_max_history) {
+        m_history.clear();
+      }
+    }
+    history_it = m_history.emplace(file_name, 0).first;
+  }
+  uint32_t frequency = ++history_it->second;
+
+  if (!admit(frequency)) {
+    ldout(cct, 20) << "not admitted: " << file_name << " frequency="
+                   << frequency << dendl;
+    return OBJ_CACHE_SKIP;
+  }
+
+  m_history.erase(history_it);
+  auto& entry = m_cache_map[file_name];
+  entry.file_name = file_name;
+  entry.status = OBJ_CACHE_SKIP;
+  entry.frequency = frequency;
+  entry.last_access = m_access;
+  ++m_inflight_ops;
+  return OBJ_CACHE_NONE;  // start promotion request
+}
+
+void FrequencyPolicy::update_status(std::string file_name,
+                                    cache_status_t new_status, uint64_t size) {
+  ldout(cct, 20) << "update status for: " << file_name
+                 << " new status = " << new_status << dendl;
+
+  std::lock_guard locker{m_lock};
+
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it == m_cache_map.end()) {
+    return;
+  }
+
+  Entry* entry = &entry_it->second;
+
+  // promoting done
+  if (entry->status == OBJ_CACHE_SKIP && (new_status == OBJ_CACHE_PROMOTED ||
+                                          new_status == OBJ_CACHE_DNE)) {
+    entry->status = new_status;
+    entry->size = size;
+    m_cache_size += size;
+    --m_inflight_ops;
+    m_promoted.insert(rank(entry));
+    return;
+  }
+
+  // promoting failed
+  if (entry->status == OBJ_CACHE_SKIP && new_status == OBJ_CACHE_NONE) {
+    --m_inflight_ops;
+    m_cache_map.erase(entry_it);
+    return;
+  }
+
+  // to evict
+  if ((entry->status == OBJ_CACHE_PROMOTED || entry->status == OBJ_CACHE_DNE) &&
+      new_status == OBJ_CACHE_NONE) {
+    if (!entry->evicting) {
+      m_promoted.erase(rank(entry));
+    }
+    m_cache_size -= entry->size;
+    m_cache_map.erase(entry_it);
+    return;
+  }
+}
+
+int FrequencyPolicy::evict_entry(std::string file_name) {
+  ldout(cct, 20) << "to evict: " << file_name << dendl;
+
+  update_status(file_name, OBJ_CACHE_NONE);
+
+  return 0;
+}
+
+cache_status_t FrequencyPolicy::get_status(std::string file_name) {
+  ldout(cct, 20) << file_name << dendl;
+
+  std::lock_guard locker{m_lock};
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it == m_cache_map.end()) {
+    return OBJ_CACHE_NONE;
+  }
+
+  return entry_it->second.status;
+}
+
+void FrequencyPolicy::get_evict_list(std::list<std::string>* obj_list) {
+  ldout(cct, 20) << dendl;
+
+  std::lock_guard locker{m_lock};
+  if ((double)m_cache_size <= m_max_cache_size * m_watermark) {
+    return;
+  }
+
+  // make room for another 10% of the cache below the watermark
+  double target = std::max(0.0, m_max_cache_size * (m_watermark - 0.1));
+  uint64_t remaining = m_cache_size;
+  while (remaining > target && !m_promoted.empty()) {
+    Entry* entry = std::get<2>(*m_promoted.begin());
+    m_promoted.erase(m_promoted.begin());
+    entry->evicting = true;
+    remaining -= entry->size;
+    obj_list->push_back(entry->file_name);
+  }
+}
+
+// for unit test
+uint64_t FrequencyPolicy::get_free_size() {
+  std::lock_guard locker{m_lock};
+  return m_max_cache_size - m_cache_size;
+}
+
+uint64_t FrequencyPolicy::get_promoting_entry_num() {
+  std::lock_guard locker{m_lock};
+  return m_inflight_ops;
+}
+
+uint64_t FrequencyPolicy::get_promoted_entry_num() {
+  std::lock_guard locker{m_lock};
+  return m_promoted.size();
+}
+
+uint32_t FrequencyPolicy::get_frequency(const std::string& file_name) {
+  std::lock_guard locker{m_lock};
+  auto entry_it = m_cache_map.find(file_name);
+  if (entry_it != m_cache_map.end()) {
+    return entry_it->second.frequency;
+  }
+  auto history_it = m_history.find(file_name);
+  if (history_it != m_history.end()) {
+    return history_it->second;
+  }
+  return 0;
+}
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
@@ -0,0 +1,94 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_CACHE_FREQUENCY_POLICY_H
+#define CEPH_CACHE_FREQUENCY_POLICY_H
+
+#include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
+#include "Policy.h"
+
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+/**
+ * Frequency-aware cache policy.
+ *
+ * Lookups are counted both for cached objects and (in a bounded history)
+ * for objects that are not cached.  While the cache is below its
+ * watermark every missed object is promoted like in SimplePolicy; above
+ * it an object is only promoted once it has been looked up more often
+ * than the coldest cached object, so a scan over many objects that are
+ * read once does not push out the hot ones.  Eviction picks the least
+ * frequently used objects, the least recently used first among equals.
+ * All counters are halved periodically so that objects which were hot a
+ * long time ago age out.
+ */
+class FrequencyPolicy : public Policy {
+ public:
+  FrequencyPolicy(CephContext *cct, uint64_t cache_size,
+                  uint64_t max_inflight, double watermark);
+  ~FrequencyPolicy();
+
+  cache_status_t lookup_object(std::string file_name) override;
+  cache_status_t get_status(std::string file_name) override;
+
+  void update_status(std::string file_name,
+                     cache_status_t new_status,
+                     uint64_t size = 0) override;
+
+  int evict_entry(std::string file_name) override;
+
+  void get_evict_list(std::list<std::string>* obj_list) override;
+
+  uint64_t get_free_size();
+  uint64_t get_promoting_entry_num();
+  uint64_t get_promoted_entry_num();
+  uint32_t get_frequency(const std::string& file_name);
+
+ private:
+  struct Entry {
+    std::string file_name;
+    cache_status_t status = OBJ_CACHE_NONE;
+    uint64_t size = 0;
+    uint32_t frequency = 0;
+    uint64_t last_access = 0;
+    bool evicting = false;
+  };
+
+  // (frequency, last access, entry): coldest entry first
+  typedef std::tuple<uint32_t, uint64_t, Entry*> Rank;
+
+  CephContext* cct;
+  double m_watermark;
+  uint64_t m_max_inflight_ops;
+  uint64_t m_max_cache_size;
+  uint64_t m_max_history;
+
+  ceph::mutex m_lock =
+    ceph::make_mutex("ceph::cache::FrequencyPolicy::m_lock");
+  std::unordered_map<std::string, Entry> m_cache_map;
+  std::set<Rank> m_promoted;
+  std::unordered_map<std::string, uint32_t> m_history;
+  uint64_t m_cache_size = 0;
+  uint64_t m_inflight_ops = 0;
+  uint64_t m_access = 0;
+  uint64_t m_accesses_since_aging = 0;
+
+  bool admit(uint32_t frequency);
+  void touch(Entry* entry);
+  void age();
+
+  static Rank rank(Entry* entry) {
+    return {entry->frequency, entry->last_access, entry};
+  }
+};
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
+#endif  // CEPH_CACHE_FREQUENCY_POLICY_H
@@ -0,0 +1,163 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "MappedFileCache.h"
+#include "common/debug.h"
+#include "common/deleter.h"
+#include "common/errno.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_immutable_obj_cache
+#undef dout_prefix
+#define dout_prefix *_dout << "ceph::cache::MappedFileCache: " << this << " " \
+                           << __func__ << ": "
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+MappedFileCache::MappedFile::~MappedFile() {
+  if (addr != nullptr) {
+    ::munmap(addr, length);
+  }
+}
+
+MappedFileCache::MappedFileCache(CephContext* cct, uint64_t max_size)
+  : m_cct(cct), m_max_size(max_size) {
+  ldout(m_cct, 20) << "max size= " << m_max_size << dendl;
+}
+
+MappedFileCache::~MappedFileCache() {
+  clear();
+}
+
+int MappedFileCache::map_file(const std::string& file_path,
+                              MappedFileRef* mapped_file) {
+  int fd = TEMP_FAILURE_RETRY(::open(file_path.c_str(), O_RDONLY|O_CLOEXEC));
+  if (fd < 0) {
+    int r = -errno;
+    ldout(m_cct, 5) << "failed to open " << file_path << ": "
+                    << cpp_strerror(r) << dendl;
+    return r;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int r = -errno;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    ldout(m_cct, 5) << "failed to stat " << file_path << ": "
+                    << cpp_strerror(r) << dendl;
+    return r;
+  }
+
+  auto file = std::make_shared<MappedFile>();
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    // private and writable so that a reader modifying the returned buffer
+    // in place only gets its own copy of the page
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      int r = -errno;
+      VOID_TEMP_FAILURE_RETRY(::close(fd));
+      ldout(m_cct, 5) << "failed to map " << file_path << ": "
+                      << cpp_strerror(r) << dendl;
+      return r;
+    }
+    file->addr = static_cast<char*>(addr);
+    file->length = st.st_size;
+  }
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+
+  *mapped_file = std::move(file);
+  return 0;
+}
+
+MappedFileCache::MappedFileRef MappedFileCache::get_file(
+    const std::string& file_path) {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+
+  auto it = m_files.find(file_path);
+  if (it == m_files.end()) {
+    return nullptr;
+  }
+  m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+  return it->second.first;
+}
+
+void MappedFileCache::trim() {
+  ceph_assert(ceph_mutex_is_locked_by_me(m_lock));
+
+  // the most recently used file stays mapped even if it is too large
+  while (m_mapped_size > m_max_size && m_lru.size() > 1) {
+    auto it = m_files.find(m_lru.back());
+    ceph_assert(it != m_files.end());
+    ldout(m_cct, 20) << "unmapping " << it->first << dendl;
+    m_mapped_size -= it->second.first->length;
+    m_files.erase(it);
+    m_lru.pop_back();
+  }
+}
+
+int MappedFileCache::read(const std::string& file_path, uint64_t offset,
+                          uint64_t length, ceph::bufferlist* bl) {
+  ldout(m_cct, 20) << "file path: " << file_path << " " << offset << "~"
+                   << length << dendl;
+
+  MappedFileRef file;
+  {
+    std::lock_guard locker{m_lock};
+    file = get_file(file_path);
+  }
+
+  if (!file) {
+    int r = map_file(file_path, &file);
+    if (r < 0) {
+      return r;
+    }
+
+    std::lock_guard locker{m_lock};
+    auto existing = get_file(file_path);
+    if (existing) {
+      // mapped by a concurrent read
+      file = existing;
+    } else {
+      m_lru.push_front(file_path);
+      m_files.emplace(file_path, std::make_pair(file, m_lru.begin()));
+      m_mapped_size += file->length;
+      trim();
+    }
+  }
+
+  if (offset >= file->length) {
+    return 0;
+  }
+  length = std::min<uint64_t>(length, file->length - offset);
+  // the buffer holds a reference to the mapping
+  bl->append(ceph::buffer::ptr(ceph::buffer::claim_buffer(
+    length, file->addr + offset, make_deleter([file] {}))));
+  return length;
+}
+
+void MappedFileCache::clear() {
+  std::lock_guard locker{m_lock};
+  m_files.clear();
+  m_lru.clear();
+  m_mapped_size = 0;
+}
+
+uint64_t MappedFileCache::get_mapped_size() {
+  std::lock_guard locker{m_lock};
+  return m_mapped_size;
+}
+
+uint64_t MappedFileCache::get_mapped_file_num() {
+  std::lock_guard locker{m_lock};
+  return m_files.size();
+}
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
@@ -0,0 +1,74 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_CACHE_MAPPED_FILE_CACHE_H
+#define CEPH_CACHE_MAPPED_FILE_CACHE_H
+
+#include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace ceph {
+namespace immutable_obj_cache {
+
+/**
+ * Client side cache of memory mapped cache files.
+ *
+ * The cache daemon only ever writes a cache file once, before it reports
+ * the object as promoted, and evicts it by unlinking the file.  A file
+ * can therefore be mapped once and shared by all later reads of the
+ * object: reads return bufferlists pointing into the mapping, which stays
+ * valid (and keeps the data) until the last of them is released, even if
+ * the daemon evicts the file in the meantime.  Mappings are dropped in
+ * LRU order once more than max_size bytes are mapped.
+ */
+class MappedFileCache {
+ public:
+  MappedFileCache(CephContext* cct, uint64_t max_size);
+  ~MappedFileCache();
+
+  MappedFileCache(const MappedFileCache&) = delete;
+  MappedFileCache& operator=(const MappedFileCache&) = delete;
+
+  /// read up to length bytes at offset (short at the end of the file)
+  int read(const std::string& file_path, uint64_t offset, uint64_t length,
+           ceph::bufferlist* bl);
+
+  void clear();
+
+  uint64_t get_mapped_size();
+  uint64_t get_mapped_file_num();
+
+ private:
+  struct MappedFile {
+    char* addr = nullptr;
+    size_t length = 0;
+
+    ~MappedFile();
+  };
+  typedef std::shared_ptr<MappedFile> MappedFileRef;
+  typedef std::list<std::string> FileLRU;
+
+  CephContext* m_cct;
+  uint64_t m_max_size;
+
+  ceph::mutex m_lock =
+    ceph::make_mutex("ceph::cache::MappedFileCache::m_lock");
+  std::unordered_map<std::string,
+                     std::pair<MappedFileRef, FileLRU::iterator>> m_files;
+  FileLRU m_lru;     // most recently used first
+  uint64_t m_mapped_size = 0;
+
+  int map_file(const std::string& file_path, MappedFileRef* mapped_file);
+  MappedFileRef get_file(const std::string& file_path);
+  void trim();
+};
+
+}  // namespace immutable_obj_cache
+}  // namespace ceph
+#endif  // CEPH_CACHE_MAPPED_FILE_CACHE_H
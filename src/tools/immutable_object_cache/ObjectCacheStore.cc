@@ -87,8 +87,15 @@ ObjectCacheStore::ObjectCacheStore(CephContext *cct)
     lderr(m_cct) << "Invalid water mark provided, set it to default." << dendl;
     cache_watermark = 0.9;
   }
-  m_policy = new SimplePolicy(m_cct, cache_max_size, max_inflight_ops,
-                              cache_watermark);
+  auto policy =
+    m_cct->_conf.get_val<std::string>("immutable_object_cache_policy");
+  if (policy == "frequency") {
+    m_policy = new FrequencyPolicy(m_cct, cache_max_size, max_inflight_ops,
+                                   cache_watermark);
+  } else {
+    m_policy = new SimplePolicy(m_cct, cache_max_size, max_inflight_ops,
+                                cache_watermark);
+  }
 }
 
 ObjectCacheStore::~ObjectCacheStore() {
@@ -11,6 +11,7 @@
 #include "common/Cond.h"
 #include "include/rados/librados.hpp"
 
+#include "FrequencyPolicy.h"
 #include "SimplePolicy.h"
 
 
@@ -55,6 +55,8 @@ static const std::string DEST_SNAPSHOT_NAME("dest-snap");
 static const std::string PATH("path");
 static const std::string FROM_SNAPSHOT_NAME("from-snap");
 static const std::string WHOLE_OBJECT("whole-object");
+static const std::string DIFF_FORMAT("diff-format");
+static const std::string DIFF_COMPRESSION("compression");
 
 // encryption arguments
 static const std::string ENCRYPTION_FORMAT("encryption-format");
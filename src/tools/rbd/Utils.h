@@ -40,6 +40,7 @@ static const size_t RBD_DEFAULT_SPARSE_SIZE = 4096;
 static const std::string RBD_IMAGE_BANNER_V2 ("rbd image v2\n");
 static const std::string RBD_IMAGE_DIFFS_BANNER_V2 ("rbd image diffs v2\n");
 static const std::string RBD_DIFF_BANNER_V2 ("rbd diff v2\n");
+static const std::string RBD_DIFF_BANNER_V3 ("rbd diff v3\n");
 
 #define RBD_DIFF_FROM_SNAP	'f'
 #define RBD_DIFF_TO_SNAP	't'
@@ -47,6 +48,7 @@ static const std::string RBD_DIFF_BANNER_V2 ("rbd diff v2\n");
 #define RBD_DIFF_WRITE		'w'
 #define RBD_DIFF_ZERO		'z'
 #define RBD_DIFF_END		'e'
+#define RBD_DIFF_COMPRESSED	'c'
 
 #define RBD_SNAP_PROTECTION_STATUS     'p'
 
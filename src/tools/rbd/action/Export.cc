@@ -8,10 +8,15 @@
 #include "include/Context.h"
 #include "common/errno.h"
 #include "common/Throttle.h"
+#include "common/ceph_mutex.h"
+#include "compressor/Compressor.h"
 #include "include/encoding.h"
 #include <iostream>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <map>
+#include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
 #include <boost/scope_exit.hpp>
 
@@ -122,9 +127,219 @@ private:
 };
 
 
+/*
+ * Diff format 3: the image is split into batches of object sets which are
+ * diffed, read and encoded by up to rbd_concurrent_management_ops worker
+ * threads.  The changes within an object set are encoded as one chunk of
+ * v2 data records, optionally compressed into a single record, and chunks
+ * are appended to the stream as soon as they are ready.  Data records are
+ * therefore not ordered by offset, but never overlap.
+ */
+class DiffChunkExporter {
+public:
+  DiffChunkExporter(librbd::Image &image, const char *fromsnapname,
+                    bool whole_object, int fd, uint64_t image_size,
+                    uint64_t object_set_size, const std::string &compression,
+                    bool no_progress)
+    : m_image(image), m_fromsnapname(fromsnapname),
+      m_whole_object(whole_object), m_fd(fd), m_image_size(image_size),
+      m_object_set_size(object_set_size), m_compression(compression),
+      m_pc("Exporting image", no_progress) {
+  }
+
+  int run(uint64_t max_workers) {
+    // a diff is started per batch and (with fast-diff) loads the object
+    // map each time: keep the batches large, but leave a few per worker
+    // to balance the load
+    uint64_t object_sets = (m_image_size + m_object_set_size - 1) /
+                           m_object_set_size;
+    max_workers = std::max<uint64_t>(1, max_workers);
+    m_batch_size = m_object_set_size * std::max<uint64_t>(
+      MIN_OBJECT_SETS_PER_BATCH,
+      (object_sets + max_workers * BATCHES_PER_WORKER - 1) /
+        (max_workers * BATCHES_PER_WORKER));
+    uint64_t batches = (m_image_size + m_batch_size - 1) / m_batch_size;
+    uint64_t workers = std::max<uint64_t>(
+      1, std::min<uint64_t>(max_workers, batches));
+
+    std::vector<std::thread> threads;
+    for (uint64_t i = 1; i < workers; ++i) {
+      threads.emplace_back([this]() { worker(); });
+    }
+    worker();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    if (m_ret < 0) {
+      m_pc.fail();
+    }
+    return m_ret;
+  }
+
+  void finish() {
+    m_pc.finish();
+  }
+
+private:
+  static const uint64_t MIN_OBJECT_SETS_PER_BATCH = 16;
+  static const uint64_t BATCHES_PER_WORKER = 8;
+
+  struct Extent {
+    uint64_t offset;
+    uint64_t length;
+    bool exists;
+  };
+
+  librbd::Image &m_image;
+  const char *m_fromsnapname;
+  bool m_whole_object;
+  int m_fd;
+  uint64_t m_image_size;
+  uint64_t m_object_set_size;
+  std::string m_compression;
+  uint64_t m_batch_size = 0;
+
+  ceph::mutex m_lock = ceph::make_mutex("DiffChunkExporter::m_lock");
+  uint64_t m_next_offset = 0;
+  uint64_t m_exported = 0;
+  int m_ret = 0;
+  utils::ProgressContext m_pc;
+
+  struct DiffBatch {
+    uint64_t object_set_size;
+    std::map<uint64_t, std::vector<Extent>> chunks;
+  };
+
+  static int diff_cb(uint64_t offset, size_t length, int exists, void *arg) {
+    auto batch = reinterpret_cast<DiffBatch *>(arg);
+    // all extents of an object set are encoded into the same chunk
+    batch->chunks[offset / batch->object_set_size].push_back(
+      {offset, length, exists != 0});
+    return 0;
+  }
+
+  void worker() {
+    CompressorRef compressor;
+    if (!m_compression.empty()) {
+      compressor = Compressor::create(g_ceph_context, m_compression);
+      ceph_assert(compressor);
+    }
+
+    while (true) {
+      uint64_t offset;
+      uint64_t length;
+      {
+        std::lock_guard locker{m_lock};
+        if (m_ret < 0 || m_next_offset >= m_image_size) {
+          return;
+        }
+        offset = m_next_offset;
+        length = std::min(m_batch_size, m_image_size - offset);
+        m_next_offset += length;
+      }
+
+      int r = export_batch(compressor, offset, length);
+
+      std::lock_guard locker{m_lock};
+      if (r < 0) {
+        if (m_ret == 0) {
+          m_ret = r;
+        }
+        return;
+      }
+      m_exported += length;
+      m_pc.update_progress(m_exported, m_image_size);
+    }
+  }
+
+  int export_batch(CompressorRef compressor, uint64_t offset,
+                   uint64_t length) {
+    DiffBatch batch{m_object_set_size, {}};
+    int r = m_image.diff_iterate2(m_fromsnapname, offset, length, true,
+                                  m_whole_object, &diff_cb, &batch);
+    if (r < 0) {
+      std::cerr << "rbd: failed to diff image at offset " << offset << ": "
+                << cpp_strerror(r) << std::endl;
+      return r;
+    }
+
+    for (auto &[object_set, extents] : batch.chunks) {
+      r = export_chunk(compressor, extents);
+      if (r < 0) {
+        return r;
+      }
+    }
+    return 0;
+  }
+
+  int export_chunk(CompressorRef compressor,
+                   const std::vector<Extent> &extents) {
+    bufferlist chunk_bl;
+    for (auto &extent : extents) {
+      bufferlist data;
+      bool exists = extent.exists;
+      if (exists) {
+        ssize_t r = m_image.read2(extent.offset, extent.length, data,
+                                  LIBRADOS_OP_FLAG_FADVISE_NOCACHE);
+        if (r < 0) {
+          std::cerr << "rbd: error reading from source image at offset "
+                    << extent.offset << ": " << cpp_strerror(r)
+                    << std::endl;
+          return r;
+        }
+        if (data.length() < extent.length) {
+          data.append_zero(extent.length - data.length());
+        }
+        exists = !data.is_zero();
+      }
+
+      __u8 tag = exists ? RBD_DIFF_WRITE : RBD_DIFF_ZERO;
+      uint64_t len = 8 + 8 + (exists ? extent.length : 0);
+      encode(tag, chunk_bl);
+      encode(len, chunk_bl);
+      encode(extent.offset, chunk_bl);
+      encode(extent.length, chunk_bl);
+      if (exists) {
+        chunk_bl.claim_append(data);
+      }
+    }
+
+    if (compressor && chunk_bl.length() > 0) {
+      bufferlist compressed_bl;
+      std::optional<int32_t> compressor_message;
+      int r = compressor->compress(chunk_bl, compressed_bl,
+                                   compressor_message);
+      // incompressible chunks are stored as they are
+      if (r == 0 && compressed_bl.length() < chunk_bl.length()) {
+        bufferlist payload_bl;
+        encode(m_compression, payload_bl);
+        encode(static_cast<uint64_t>(chunk_bl.length()), payload_bl);
+        encode(compressor_message, payload_bl);
+        payload_bl.claim_append(compressed_bl);
+
+        __u8 tag = RBD_DIFF_COMPRESSED;
+        uint64_t len = payload_bl.length();
+        chunk_bl.clear();
+        encode(tag, chunk_bl);
+        encode(len, chunk_bl);
+        chunk_bl.claim_append(payload_bl);
+      }
+    }
+
+    if (chunk_bl.length() == 0) {
+      return 0;
+    }
+
+    std::lock_guard locker{m_lock};
+    return chunk_bl.write_fd(m_fd);
+  }
+};
+
 int do_export_diff_fd(librbd::Image& image, const char *fromsnapname,
 		   const char *endsnapname, bool whole_object,
-		   int fd, bool no_progress, int export_format)
+		   int fd, bool no_progress, int export_format,
+		   const std::string &compression)
 {
   int r;
   librbd::image_info_t info;
@@ -138,8 +353,10 @@ int do_export_diff_fd(librbd::Image& image, const char *fromsnapname,
     bufferlist bl;
     if (export_format == 1)
       bl.append(utils::RBD_DIFF_BANNER);
-    else
+    else if (export_format == 2)
       bl.append(utils::RBD_DIFF_BANNER_V2);
+    else
+      bl.append(utils::RBD_DIFF_BANNER_V3);
 
     __u8 tag;
     uint64_t len = 0;
@@ -147,7 +364,7 @@ int do_export_diff_fd(librbd::Image& image, const char *fromsnapname,
       tag = RBD_DIFF_FROM_SNAP;
       encode(tag, bl);
       std::string from(fromsnapname);
-      if (export_format == 2) {
+      if (export_format >= 2) {
 	len = from.length() + 4;
 	encode(len, bl);
       }
@@ -158,7 +375,7 @@ int do_export_diff_fd(librbd::Image& image, const char *fromsnapname,
       tag = RBD_DIFF_TO_SNAP;
       encode(tag, bl);
       std::string to(endsnapname);
-      if (export_format == 2) {
+      if (export_format >= 2) {
         len = to.length() + 4;
         encode(len, bl);
       }
@@ -181,7 +398,7 @@ int do_export_diff_fd(librbd::Image& image, const char *fromsnapname,
     tag = RBD_DIFF_IMAGE_SIZE;
     encode(tag, bl);
     uint64_t endsize = info.size;
-    if (export_format == 2) {
+    if (export_format >= 2) {
       len = 8;
       encode(len, bl);
     }
@@ -192,6 +409,27 @@ int do_export_diff_fd(librbd::Image& image, const char *fromsnapname,
       return r;
     }
   }
+  if (export_format == 3) {
+    uint64_t object_set_size = info.obj_size * image.get_stripe_count();
+    DiffChunkExporter exporter(image, fromsnapname, whole_object, fd,
+                               info.size, object_set_size, compression,
+                               no_progress);
+    r = exporter.run(
+      g_conf().get_val<uint64_t>("rbd_concurrent_management_ops"));
+    if (r < 0) {
+      return r;
+    }
+
+    __u8 tag = RBD_DIFF_END;
+    bufferlist bl;
+    encode(tag, bl);
+    r = bl.write_fd(fd);
+    if (r == 0) {
+      exporter.finish();
+    }
+    return r;
+  }
+
   ExportDiffContext edc(&image, fd, info.size,
                         g_conf().get_val<uint64_t>("rbd_concurrent_management_ops"),
                         no_progress, export_format);
@@ -224,7 +462,8 @@ out:
 
 int do_export_diff(librbd::Image& image, const char *fromsnapname,
                 const char *endsnapname, bool whole_object,
-                const char *path, bool no_progress)
+                const char *path, bool no_progress, int diff_format,
+                const std::string &compression)
 {
   int r;
   int fd;
@@ -236,7 +475,8 @@ int do_export_diff(librbd::Image& image, const char *fromsnapname,
   if (fd < 0)
     return -errno;
 
-  r = do_export_diff_fd(image, fromsnapname, endsnapname, whole_object, fd, no_progress, 1);
+  r = do_export_diff_fd(image, fromsnapname, endsnapname, whole_object, fd,
+                        no_progress, diff_format, compression);
 
   if (fd != 1)
     close(fd);
@@ -260,7 +500,12 @@ void get_arguments_diff(po::options_description *positional,
   options->add_options()
     (at::FROM_SNAPSHOT_NAME.c_str(), po::value<std::string>(),
      "snapshot starting point")
-    (at::WHOLE_OBJECT.c_str(), po::bool_switch(), "compare whole object");
+    (at::WHOLE_OBJECT.c_str(), po::bool_switch(), "compare whole object")
+    (at::DIFF_FORMAT.c_str(), po::value<uint64_t>(),
+     "format of the diff file [1 (default) or 3]")
+    (at::DIFF_COMPRESSION.c_str(), po::value<std::string>(),
+     "compression algorithm for the diff (zstd, lz4, snappy or zlib; "
+     "requires diff format 3)");
   at::add_no_progress_option(options);
 }
 
@@ -290,6 +535,30 @@ int execute_diff(const po::variables_map &vm,
     from_snap_name = vm[at::FROM_SNAPSHOT_NAME].as<std::string>();
   }
 
+  uint64_t diff_format = 1;
+  if (vm.count(at::DIFF_FORMAT)) {
+    diff_format = vm[at::DIFF_FORMAT].as<uint64_t>();
+    if (diff_format != 1 && diff_format != 3) {
+      std::cerr << "rbd: unsupported diff format " << diff_format
+                << std::endl;
+      return -EINVAL;
+    }
+  }
+
+  std::string compression;
+  if (vm.count(at::DIFF_COMPRESSION)) {
+    compression = vm[at::DIFF_COMPRESSION].as<std::string>();
+    if (diff_format != 3) {
+      std::cerr << "rbd: compression requires diff format 3" << std::endl;
+      return -EINVAL;
+    }
+    if (!Compressor::create(g_ceph_context, compression)) {
+      std::cerr << "rbd: unsupported compression algorithm '" << compression
+                << "'" << std::endl;
+      return -EINVAL;
+    }
+  }
+
   librados::Rados rados;
   librados::IoCtx io_ctx;
   librbd::Image image;
@@ -303,7 +572,7 @@ int execute_diff(const po::variables_map &vm,
                      from_snap_name.empty() ? nullptr : from_snap_name.c_str(),
                      snap_name.empty() ? nullptr : snap_name.c_str(),
                      vm[at::WHOLE_OBJECT].as<bool>(), path.c_str(),
-                     vm[at::NO_PROGRESS].as<bool>());
+                     vm[at::NO_PROGRESS].as<bool>(), diff_format, compression);
   if (r < 0) {
     std::cerr << "rbd: export-diff error: " << cpp_strerror(r) << std::endl;
     return r;
@@ -501,7 +770,8 @@ static int do_export_v2(librbd::Image& image, librbd::image_info_t &info, int fd
   const char *last_snap = NULL;
   for (size_t i = 0; i < snaps.size(); ++i) {
     utils::snap_set(image, snaps[i].name.c_str());
-    r = do_export_diff_fd(image, last_snap, snaps[i].name.c_str(), false, fd, true, 2);
+    r = do_export_diff_fd(image, last_snap, snaps[i].name.c_str(), false, fd, true, 2,
+                          "");
     if (r < 0) {
       return r;
     }
@@ -509,7 +779,7 @@ static int do_export_v2(librbd::Image& image, librbd::image_info_t &info, int fd
     last_snap = snaps[i].name.c_str();
   }
   utils::snap_set(image, std::string(""));
-  r = do_export_diff_fd(image, last_snap, nullptr, false, fd, true, 2);
+  r = do_export_diff_fd(image, last_snap, nullptr, false, fd, true, 2, "");
   if (r < 0) {
     return r;
   }
@@ -9,12 +9,18 @@
 #include "common/debug.h"
 #include "common/errno.h"
 #include "common/Throttle.h"
+#include "common/ceph_mutex.h"
+#include "compressor/Compressor.h"
 #include "include/compat.h"
 #include "include/encoding.h"
 #include "common/debug.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
+#include <deque>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
 #include <boost/program_options.hpp>
 #include <boost/scoped_ptr.hpp>
 #include "include/ceph_assert.h"
@@ -37,12 +43,10 @@ struct ImportDiffContext {
   OrderedThrottle throttle;
   uint64_t last_offset;
 
-  ImportDiffContext(librbd::Image *image, int fd, size_t size, bool no_progress)
+  ImportDiffContext(librbd::Image *image, int fd, size_t size, bool no_progress,
+                    uint64_t max_ops)
     : image(image), fd(fd), size(size), pc("Importing image diff", no_progress),
-      throttle((fd == STDIN_FILENO) ? 1 :
-                  g_conf().get_val<uint64_t>("rbd_concurrent_management_ops"),
-               false),
-      last_offset(0) {
+      throttle(max_ops, false), last_offset(0) {
   }
 
   void update_size(size_t new_size)
@@ -239,33 +243,12 @@ static int do_image_resize(ImportDiffContext *idiffctx)
   return 0;
 }
 
-static int do_image_io(ImportDiffContext *idiffctx, bool write_zeroes,
-                       size_t sparse_size)
+static int queue_image_io(ImportDiffContext *idiffctx, bool write_zeroes,
+                          size_t sparse_size, uint64_t image_offset,
+                          uint64_t buffer_length, const bufferptr &bp)
 {
-  int r;
-  char buf[16];
-  r = safe_read_exact(idiffctx->fd, buf, sizeof(buf));
-  if (r < 0) {
-    std::cerr << "rbd: failed to decode IO length" << std::endl;
-    return r;
-  }
-
-  bufferlist bl;
-  bl.append(buf, sizeof(buf));
-  auto p = bl.cbegin();
-
-  uint64_t image_offset, buffer_length;
-  decode(image_offset, p);
-  decode(buffer_length, p);
-
+  int r = 0;
   if (!write_zeroes) {
-    bufferptr bp = buffer::create(buffer_length);
-    r = safe_read_exact(idiffctx->fd, bp.c_str(), buffer_length);
-    if (r < 0) {
-      std::cerr << "rbd: failed to decode write data" << std::endl;
-      return r;
-    }
-
     size_t buffer_offset = 0;
     while (buffer_offset < buffer_length) {
       size_t write_length = 0;
@@ -300,6 +283,238 @@ static int do_image_io(ImportDiffContext *idiffctx, bool write_zeroes,
   return r;
 }
 
+static int do_image_io(ImportDiffContext *idiffctx, bool write_zeroes,
+                       size_t sparse_size)
+{
+  int r;
+  char buf[16];
+  r = safe_read_exact(idiffctx->fd, buf, sizeof(buf));
+  if (r < 0) {
+    std::cerr << "rbd: failed to decode IO length" << std::endl;
+    return r;
+  }
+
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  auto p = bl.cbegin();
+
+  uint64_t image_offset, buffer_length;
+  decode(image_offset, p);
+  decode(buffer_length, p);
+
+  bufferptr bp;
+  if (!write_zeroes) {
+    bp = buffer::create(buffer_length);
+    r = safe_read_exact(idiffctx->fd, bp.c_str(), buffer_length);
+    if (r < 0) {
+      std::cerr << "rbd: failed to decode write data" << std::endl;
+      return r;
+    }
+  }
+
+  return queue_image_io(idiffctx, write_zeroes, sparse_size, image_offset,
+                        buffer_length, bp);
+}
+
+/*
+ * Compressed chunks of a v3 diff are decompressed and applied by a few
+ * worker threads while the stream is still being read.  Data records of
+ * a v3 diff never overlap, so chunks (and the writes within them) may be
+ * applied in any order.
+ */
+class DiffChunkDecoder {
+public:
+  DiffChunkDecoder(ImportDiffContext *idiffctx, size_t sparse_size,
+                   uint64_t max_workers)
+    : m_idiffctx(idiffctx), m_sparse_size(sparse_size),
+      m_max_workers(std::max<uint64_t>(1, max_workers)) {
+  }
+
+  ~DiffChunkDecoder() {
+    ceph_assert(m_workers.empty());
+  }
+
+  int queue(bufferlist &&chunk_bl) {
+    std::unique_lock locker{m_lock};
+    if (m_workers.empty()) {
+      for (uint64_t i = 0; i < m_max_workers; ++i) {
+        m_workers.emplace_back([this]() { worker(); });
+      }
+    }
+
+    // bound the memory held by chunks that are read but not yet applied
+    m_cond.wait(locker, [this]() {
+      return m_ret < 0 || m_queue.size() < 2 * m_max_workers;
+    });
+    if (m_ret < 0) {
+      return m_ret;
+    }
+    m_queue.push_back(std::move(chunk_bl));
+    m_cond.notify_all();
+    return 0;
+  }
+
+  int wait() {
+    {
+      std::lock_guard locker{m_lock};
+      m_stopping = true;
+      m_cond.notify_all();
+    }
+    for (auto &worker : m_workers) {
+      worker.join();
+    }
+    m_workers.clear();
+    return m_ret;
+  }
+
+private:
+  ImportDiffContext *m_idiffctx;
+  size_t m_sparse_size;
+  uint64_t m_max_workers;
+
+  ceph::mutex m_lock = ceph::make_mutex("DiffChunkDecoder::m_lock");
+  ceph::condition_variable m_cond;
+  std::deque<bufferlist> m_queue;
+  std::vector<std::thread> m_workers;
+  bool m_stopping = false;
+  int m_ret = 0;
+
+  void worker() {
+    std::map<std::string, CompressorRef> compressors;
+    std::unique_lock locker{m_lock};
+    while (true) {
+      m_cond.wait(locker, [this]() {
+        return m_stopping || m_ret < 0 || !m_queue.empty();
+      });
+      if (m_ret < 0 || m_queue.empty()) {
+        return;
+      }
+
+      bufferlist chunk_bl = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_cond.notify_all();
+
+      locker.unlock();
+      int r = apply_chunk(&compressors, chunk_bl);
+      locker.lock();
+      if (r < 0 && m_ret == 0) {
+        m_ret = r;
+        m_cond.notify_all();
+      }
+    }
+  }
+
+  int apply_chunk(std::map<std::string, CompressorRef> *compressors,
+                  bufferlist &chunk_bl) {
+    std::string algorithm;
+    uint64_t raw_length;
+    std::optional<int32_t> compressor_message;
+    bufferlist raw_bl;
+    try {
+      auto p = chunk_bl.cbegin();
+      decode(algorithm, p);
+      decode(raw_length, p);
+      decode(compressor_message, p);
+
+      auto &compressor = (*compressors)[algorithm];
+      if (!compressor) {
+        compressor = Compressor::create(g_ceph_context, algorithm);
+        if (!compressor) {
+          std::cerr << "rbd: unsupported compression algorithm '"
+                    << algorithm << "'" << std::endl;
+          return -EINVAL;
+        }
+      }
+
+      int r = compressor->decompress(p, p.get_remaining(), raw_bl,
+                                     compressor_message);
+      if (r < 0 || raw_bl.length() != raw_length) {
+        std::cerr << "rbd: failed to decompress diff chunk" << std::endl;
+        return r < 0 ? r : -EBADMSG;
+      }
+    } catch (const buffer::error &err) {
+      std::cerr << "rbd: failed to decode diff chunk" << std::endl;
+      return -EBADMSG;
+    }
+
+    // the records point into the decompressed buffer
+    raw_bl.rebuild();
+    try {
+      auto p = raw_bl.cbegin();
+      while (p.get_remaining() > 0) {
+        __u8 tag;
+        uint64_t length;
+        decode(tag, p);
+        decode(length, p);
+        if (tag != RBD_DIFF_WRITE && tag != RBD_DIFF_ZERO) {
+          p += length;
+          continue;
+        }
+
+        uint64_t image_offset, buffer_length;
+        decode(image_offset, p);
+        decode(buffer_length, p);
+        bufferptr bp;
+        if (tag == RBD_DIFF_WRITE) {
+          if (buffer_length > p.get_remaining()) {
+            return -EBADMSG;
+          }
+          bp = bufferptr(raw_bl.front(), p.get_off(), buffer_length);
+          p += buffer_length;
+        }
+
+        int r = queue_image_io(m_idiffctx, (tag == RBD_DIFF_ZERO),
+                               m_sparse_size, image_offset, buffer_length, bp);
+        if (r < 0) {
+          return r;
+        }
+      }
+    } catch (const buffer::error &err) {
+      std::cerr << "rbd: failed to decode diff chunk" << std::endl;
+      return -EBADMSG;
+    }
+    return 0;
+  }
+};
+
+static int do_compressed_chunk(ImportDiffContext *idiffctx,
+                               DiffChunkDecoder *decoder, uint64_t length)
+{
+  bufferptr bp = buffer::create(length);
+  int r = safe_read_exact(idiffctx->fd, bp.c_str(), length);
+  if (r < 0) {
+    std::cerr << "rbd: failed to read compressed diff chunk" << std::endl;
+    return r;
+  }
+
+  bufferlist bl;
+  bl.push_back(std::move(bp));
+  return decoder->queue(std::move(bl));
+}
+
+static int read_diff_banner(int fd, int *format)
+{
+  // v1 and v3 banners have the same length
+  ceph_assert(utils::RBD_DIFF_BANNER.size() ==
+              utils::RBD_DIFF_BANNER_V3.size());
+  std::string banner(utils::RBD_DIFF_BANNER.size(), '\0');
+  int r = safe_read_exact(fd, banner.data(), banner.size());
+  if (r < 0) {
+    std::cerr << "rbd: failed to decode diff banner" << std::endl;
+    return r;
+  }
+
+  if (banner == utils::RBD_DIFF_BANNER) {
+    *format = 1;
+  } else if (banner == utils::RBD_DIFF_BANNER_V3) {
+    *format = 3;
+  } else {
+    std::cerr << "rbd: invalid or unexpected diff banner" << std::endl;
+    return -EINVAL;
+  }
+  return 0;
+}
+
 static int validate_banner(int fd, std::string banner)
 {
   int r;
@@ -360,7 +575,7 @@ static int read_tag(int fd, __u8 end_tag, int format, __u8 *tag, uint64_t *readl
   }
 
   *tag = read_tag;
-  if (read_tag != end_tag && format == 2) {
+  if (read_tag != end_tag && format >= 2) {
     char buf[sizeof(uint64_t)];
     r = safe_read_exact(fd, buf, sizeof(buf));
     if (r < 0) {
@@ -394,8 +609,12 @@ int do_import_diff_fd(librados::Rados &rados, librbd::Image &image, int fd,
     size = (uint64_t)stat_buf.st_size;
   }
 
-  r = validate_banner(fd, (format == 1 ? utils::RBD_DIFF_BANNER :
-                           utils::RBD_DIFF_BANNER_V2));
+  if (format == 1) {
+    // a standalone diff file is either v1 or v3
+    r = read_diff_banner(fd, &format);
+  } else {
+    r = validate_banner(fd, utils::RBD_DIFF_BANNER_V2);
+  }
   if (r < 0) {
     return r;
   }
@@ -403,7 +622,11 @@ int do_import_diff_fd(librados::Rados &rados, librbd::Image &image, int fd,
   // begin image import
   std::string tosnap;
   bool is_protected = false;
-  ImportDiffContext idiffctx(&image, fd, size, no_progress);
+  uint64_t max_ops = g_conf().get_val<uint64_t>(
+    "rbd_concurrent_management_ops");
+  ImportDiffContext idiffctx(&image, fd, size, no_progress,
+                             (from_stdin && format != 3) ? 1 : max_ops);
+  DiffChunkDecoder decoder(&idiffctx, sparse_size, max_ops);
   while (r == 0) {
     __u8 tag;
     uint64_t length = 0;
@@ -423,6 +646,8 @@ int do_import_diff_fd(librados::Rados &rados, librbd::Image &image, int fd,
       r = do_image_resize(&idiffctx);
     } else if (tag == RBD_DIFF_WRITE || tag == RBD_DIFF_ZERO) {
       r = do_image_io(&idiffctx, (tag == RBD_DIFF_ZERO), sparse_size);
+    } else if (tag == RBD_DIFF_COMPRESSED && format == 3) {
+      r = do_compressed_chunk(&idiffctx, &decoder, length);
     } else {
       std::cerr << "unrecognized tag byte " << (int)tag << " in stream; skipping"
                 << std::endl;
@@ -430,8 +655,10 @@ int do_import_diff_fd(librados::Rados &rados, librbd::Image &image, int fd,
     }
   }
 
-  int temp_r = idiffctx.throttle.wait_for_ret();
+  int temp_r = decoder.wait();
   r = (r < 0) ? r : temp_r; // preserve original error
+  temp_r = idiffctx.throttle.wait_for_ret();
+  r = (r < 0) ? r : temp_r;
   if (r == 0 && tosnap.length()) {
     r = idiffctx.image->snap_create(tosnap.c_str());
     if (r == 0 && is_protected) {